@@ -0,0 +1,653 @@
+/* benchmark for dirty json parser
+ * Avinfors, O.Nikitin
+ *
+ * Упоротость и отвага!
+*/
+
+/* Замеры производительности: пропускная способность и задержки
+ * Корпус - синтетический грязный json (генератор ниже, детерминированный от -r) и реальный документ
+ * (contract-hypothec-1.json из тестов). На каждом документе замеряются:
+ *  - parse			jsonParser + clearFlatJsonObj: МБ/с, токенов/с, выделений памяти на разбор
+ *  - reparse		jsonDocParse в один и тот же документ (токены переиспользуются)
+ *  - xpath			xPath по всем путям к скалярам документа (пути без массивов)
+ *  - getstr		getJsonStr (+ free)
+ *  - getint		getJsonInt
+ *  - asstring		jsonAsString
+ * Задержки - перцентили по отдельным вызовам (p50/p90/p99/max, нс), вместе с накладными расходами таймера
+ *
+ *	./jsbench								// отчёт в stdout
+ *	./jsbench -o base.jsonl					// и результаты по строке json'а на замер
+ *	./jsbench -o new.jsonl ... && ./jsbench -c base.jsonl new.jsonl	// сравнение двух сборок по p50
+ *	./jsbench -g comments -s 4096 > c.json	// только сгенерировать документ (4 Мб)
+ *
+ * Выделения памяти считаются, если сборка с -DJSBENCH_WRAP_MALLOC и -Wl,--wrap=malloc,... (см. make.sh),
+ * иначе в отчёте -1
+*/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "../lib/json/json.h"
+
+#define				JSBENCH_SAMPLES		(int)	(1 << 20)	// максимум замеров задержки на случай
+#define				JSBENCH_MIN_ITER	(int)	5			// минимум итераций разбора
+#define				JSBENCH_PATHS		(int)	4096		// максимум путей на документ
+#define				JSBENCH_PATH_LEN	(int)	256
+
+// счётчик выделений памяти (ld --wrap), на один поток
+static long long	allocCount = 0;
+
+#ifdef JSBENCH_WRAP_MALLOC
+void*	__real_malloc(size_t size);
+void*	__real_calloc(size_t n, size_t size);
+void*	__real_realloc(void *p, size_t size);
+
+void* __wrap_malloc(size_t size)
+{
+	allocCount++;
+	return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t n, size_t size)
+{
+	allocCount++;
+	return __real_calloc(n, size);
+}
+
+void* __wrap_realloc(void *p, size_t size)
+{
+	allocCount++;
+	return __real_realloc(p, size);
+}
+#define				JSBENCH_ALLOCS		true
+#else
+#define				JSBENCH_ALLOCS		false
+#endif
+
+// буфер генератора
+typedef struct
+{
+	char			*p;
+	size_t			len;
+	size_t			size;
+} _benchBuf_t;
+
+// результат одного замера
+typedef struct
+{
+	const char		*name;
+	const char		*corpus;
+	size_t			bytes;				// размер документа
+	_jsonOff_t		tokens;
+	long long		iter;				// вызовов
+	double			mbs;				// по медиане, 0 - не применимо
+	double			tps;				// токенов/с по медиане, 0 - не применимо
+	long long		p50, p90, p99, max;	// нс
+	double			allocs;				// выделений на вызов, -1 - не считалось
+} _benchRes_t;
+
+static unsigned long long	rnd = 1;
+static double				budget = 0.3;		// секунд на замер
+static FILE					*out = NULL;		// машиночитаемые результаты
+
+static unsigned int nextRnd()
+{
+	// xorshift64*
+	rnd ^= rnd >> 12;
+	rnd ^= rnd << 25;
+	rnd ^= rnd >> 27;
+	return (unsigned int)((rnd * 2685821657736338717ULL) >> 32);
+}
+
+static inline long long nowNs()
+{
+	struct timespec		ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void bufPrintf(_benchBuf_t *buf, const char *fmt, ...)
+{
+	va_list		ap;
+	int			n;
+
+	for(;;) {
+		va_start(ap, fmt);
+		n = vsnprintf(buf->p + buf->len, buf->size - buf->len, fmt, ap);
+		va_end(ap);
+		if((size_t)n < buf->size - buf->len) {
+			buf->len += n;
+			return;
+		}
+		buf->size = buf->size * 2 + n;
+		buf->p = (char*)realloc(buf->p, buf->size);
+		if(buf->p == NULL) {
+			fprintf(stderr, "out of memory\n");
+			exit(2);
+		}
+	}
+}
+
+/* Генератор
+ * Каждый вид наращивает документ элементами, пока он не дорастёт до size
+*/
+
+// комментарии, ключи без кавычек, запятая перед закрывающей скобкой
+static void genComments(_benchBuf_t *buf, size_t size)
+{
+	int			i;
+
+	bufPrintf(buf, "/* generated: comments */\n{\n");
+	for(i=0; buf->len < size; i++) {
+		bufPrintf(buf, "\t// item %d\n\titem%d: {\n\t\tid: %d, /* inline */ name: \"value %u\",\n"
+			"\t\tflag: %s, // trailing\n\t\tlist: [%u, %u, %u,],\n\t},\n",
+			i, i, i, nextRnd(), (i & 1) ? "true" : "false", nextRnd() % 1000, nextRnd() % 1000, nextRnd() % 1000);
+	}
+	bufPrintf(buf, "}\n");
+}
+
+// одинарные кавычки вперемешку с двойными
+static void genQuotes(_benchBuf_t *buf, size_t size)
+{
+	int			i;
+
+	bufPrintf(buf, "{");
+	for(i=0; buf->len < size; i++) {
+		bufPrintf(buf, "%s'key%d': {'code': 'CODE_%u', \"name\": 'Имя \\'%d\\'', 'desc': \"it's \\\"%u\\\"\", 'tags': ['a', \"b\", 'c']}",
+			(i > 0) ? ",\n" : "\n", i, nextRnd(), i, nextRnd());
+	}
+	bufPrintf(buf, "\n}\n");
+}
+
+// глубокая вложенность: цепочки объект/массив глубиной depth
+static void genDeep(_benchBuf_t *buf, size_t size)
+{
+	const int	depth = 128;
+	int			i, j;
+
+	bufPrintf(buf, "[");
+	for(i=0; buf->len < size; i++) {
+		bufPrintf(buf, (i > 0) ? ",\n" : "\n");
+		for(j=0; j<depth; j++) {
+			bufPrintf(buf, (j & 1) ? "[" : "{\"l%d\":", j);
+		}
+		bufPrintf(buf, "%u", nextRnd());
+		for(j=depth - 1; j>=0; j--) {
+			bufPrintf(buf, (j & 1) ? "]" : "}");
+		}
+	}
+	bufPrintf(buf, "\n]\n");
+}
+
+// один широкий объект
+static void genWide(_benchBuf_t *buf, size_t size)
+{
+	int			i;
+
+	bufPrintf(buf, "{");
+	for(i=0; buf->len < size; i++) {
+		if(i & 1) {
+			bufPrintf(buf, "%s\"k%d\": \"v%u\"", (i > 0) ? ", " : "", i, nextRnd());
+		} else {
+			bufPrintf(buf, "%s\"k%d\": %u", (i > 0) ? ", " : "", i, nextRnd());
+		}
+	}
+	bufPrintf(buf, "}\n");
+}
+
+// длинные строки с экранированием
+static void genStrings(_benchBuf_t *buf, size_t size)
+{
+	int			i, n, j;
+
+	bufPrintf(buf, "{\"list\": [");
+	for(i=0; buf->len < size; i++) {
+		bufPrintf(buf, (i > 0) ? ",\n\"" : "\n\"");
+		n = 4096 + nextRnd() % 28672;
+		for(j=0; j<n; j += 64) {
+			bufPrintf(buf, (nextRnd() & 7) ? "Lorem ipsum dolor sit amet, consectetur adipiscing elit sed do e" :
+				"quoted \\\"text\\\" with \\\\ backslash and \\n newline and \\t tab..");
+		}
+		bufPrintf(buf, "\"");
+	}
+	bufPrintf(buf, "\n]}\n");
+}
+
+// массивы чисел: целые, отрицательные, дробные (у парсера нет экспоненты)
+static void genNumbers(_benchBuf_t *buf, size_t size)
+{
+	int			i, j;
+
+	bufPrintf(buf, "{\"rows\": [");
+	for(i=0; buf->len < size; i++) {
+		bufPrintf(buf, (i > 0) ? ",\n[" : "\n[");
+		for(j=0; j<16; j++) {
+			switch(nextRnd() % 3) {
+				case 0:
+					bufPrintf(buf, "%s%u", (j > 0) ? ", " : "", nextRnd());
+					break;
+				case 1:
+					bufPrintf(buf, "%s-%u", (j > 0) ? ", " : "", nextRnd() % 100000);
+					break;
+				default:
+					bufPrintf(buf, "%s%u.%04u", (j > 0) ? ", " : "", nextRnd() % 1000000, nextRnd() % 10000);
+			}
+		}
+		bufPrintf(buf, "]");
+	}
+	bufPrintf(buf, "\n]}\n");
+}
+
+static const struct
+{
+	const char		*name;
+	void			(*gen)(_benchBuf_t*, size_t);
+} generators[] = {
+	{"comments", genComments},
+	{"quotes", genQuotes},
+	{"deep", genDeep},
+	{"wide", genWide},
+	{"strings", genStrings},
+	{"numbers", genNumbers},
+	{NULL, NULL}
+};
+
+static char* generate(const char *name, size_t size)
+{
+	_benchBuf_t		buf = {NULL, 0, 0};
+	int				i;
+
+	for(i=0; generators[i].name != NULL; i++) {
+		if(strcmp(generators[i].name, name) == 0) {
+			generators[i].gen(&buf, size);
+			return buf.p;
+		}
+	}
+	return NULL;
+}
+
+static char* readFile(const char *fileName)
+{
+	FILE		*f = fopen(fileName, "rb");
+	long		size;
+	char		*str;
+
+	if(f == NULL) {
+		return NULL;
+	}
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	str = (char*)malloc(size + 1);
+	if((str != NULL) && (fread(str, 1, size, f) != (size_t)size)) {
+		free(str);
+		str = NULL;
+	}
+	if(str != NULL) {
+		str[size] = 0;
+	}
+	fclose(f);
+	return str;
+}
+
+/* Замеры
+*/
+
+static int cmpLL(const void *a, const void *b)
+{
+	long long	x = *(const long long*)a, y = *(const long long*)b;
+
+	return (x > y) - (x < y);
+}
+
+// перцентили по замерам (замеры сортируются)
+static void percentiles(_benchRes_t *res, long long *ns, long long n)
+{
+	qsort(ns, n, sizeof(long long), cmpLL);
+	res->p50 = ns[n * 50 / 100];
+	res->p90 = ns[n * 90 / 100];
+	res->p99 = ns[n * 99 / 100];
+	res->max = ns[n - 1];
+}
+
+static void report(const _benchRes_t *res)
+{
+	printf("%-9s %-9s %10zu %9lld %8lld", res->name, res->corpus, res->bytes, (long long)res->tokens, res->iter);
+	if(res->mbs > 0) {
+		printf(" %9.1f MB/s %8.2f Mtok/s", res->mbs, res->tps / 1e6);
+	} else {
+		printf(" %27s", "");
+	}
+	printf(" p50 %9lld p90 %9lld p99 %9lld max %10lld ns", res->p50, res->p90, res->p99, res->max);
+	if(res->allocs >= 0) {
+		printf(" allocs %.1f", res->allocs);
+	}
+	printf("\n");
+	if(out != NULL) {
+		fprintf(out, "{\"case\": \"%s\", \"corpus\": \"%s\", \"bytes\": %zu, \"tokens\": %lld, \"iter\": %lld, "
+			"\"mb_s\": %.3f, \"tokens_s\": %.0f, \"p50_ns\": %lld, \"p90_ns\": %lld, \"p99_ns\": %lld, \"max_ns\": %lld, "
+			"\"allocs\": %.2f}\n",
+			res->name, res->corpus, res->bytes, (long long)res->tokens, res->iter, res->mbs, res->tps,
+			res->p50, res->p90, res->p99, res->max, res->allocs);
+	}
+}
+
+// разбор: jsonParser с нуля (reuse == false) или jsonDocParse в тот же документ
+static bool benchParse(const char *corpus, char *str, bool reuse, long long *ns)
+{
+	_benchRes_t		res = {reuse ? "reparse" : "parse", corpus, strlen(str), 0, 0, 0, 0, 0, 0, 0, 0, -1};
+	_jsonObj_t		*jsonObj = NULL, doc;
+	long long		t, start, allocs = 0;
+	int				rc;
+
+	jsonDocInit(&doc, NULL);
+	if(jsonDocParse(&doc, str, res.bytes, jsonDefaultCtx()) != 0) {
+		_jsonErr_t *err = getLastError();
+		fprintf(stderr, "%s: line %d, col %d: %s\n", corpus, err->line, err->col, err->message);
+		jsonDocFree(&doc);
+		return false;
+	}
+	res.tokens = doc.count;
+	start = nowNs();
+	while((res.iter < JSBENCH_MIN_ITER) || ((nowNs() - start < budget * 1e9) && (res.iter < JSBENCH_SAMPLES))) {
+		allocs -= allocCount;
+		t = nowNs();
+		if(reuse) {
+			rc = jsonDocParse(&doc, str, res.bytes, jsonDefaultCtx());
+		} else {
+			rc = jsonParser(str, &jsonObj, res.bytes);
+			clearFlatJsonObj(&jsonObj);
+		}
+		ns[res.iter++] = nowNs() - t;
+		allocs += allocCount;
+		(void)rc;
+	}
+	jsonDocFree(&doc);
+	percentiles(&res, ns, res.iter);
+	res.mbs = (double)res.bytes / res.p50 * 1e9 / (1 << 20);
+	res.tps = (double)res.tokens / res.p50 * 1e9;
+	if(JSBENCH_ALLOCS) {
+		res.allocs = (double)allocs / res.iter;
+	}
+	report(&res);
+	return true;
+}
+
+// пути ко всем скалярам документа, до которых можно дойти по ключам (xPath не ходит в массивы)
+static void collectPaths(_jsonObj_t *jsonObj, _jsonToken_t *object, char *path, int pathLen, char **paths, int *count)
+{
+	_jsonOff_t		id;
+	_jsonToken_t	*key, *value;
+	int				len;
+
+	for(id = jsonTokenFChild(jsonObj, object); (id != 0) && (*count < JSBENCH_PATHS); id = key->nextToken) {
+		key = jsonObj->token + id;
+		if((key->type != JSON_KEY) || (jsonTokenFChild(jsonObj, key) == 0)) {
+			continue;
+		}
+		len = key->end - key->start;
+		if((len <= 0) || (pathLen + len + 2 > JSBENCH_PATH_LEN) || (memchr(jsonObj->json + key->start, '.', len) != NULL)) {
+			continue;
+		}
+		if(pathLen > 0) {
+			path[pathLen] = '.';
+		}
+		memcpy(path + pathLen + (pathLen > 0), jsonObj->json + key->start, len);
+		path[pathLen + (pathLen > 0) + len] = 0;
+		value = jsonObj->token + jsonTokenFChild(jsonObj, key);
+		if(value->type == JSON_OBJECT) {
+			collectPaths(jsonObj, value, path, pathLen + (pathLen > 0) + len, paths, count);
+		} else if(value->type == JSON_VALUE) {
+			paths[(*count)++] = strdup(path);
+		}
+	}
+}
+
+#define				JSBENCH_XPATH		(int)	0
+#define				JSBENCH_GETSTR		(int)	1
+#define				JSBENCH_GETINT		(int)	2
+
+// поиск по путям: каждый вызов замеряется отдельно, пути перебираются по кругу
+static void benchLookup(const char *corpus, _jsonObj_t *jsonObj, char **paths, int count, int what, long long *ns)
+{
+	static const char	*names[] = {"xpath", "getstr", "getint"};
+	_benchRes_t			res = {names[what], corpus, strlen(jsonObj->json), jsonObj->count, 0, 0, 0, 0, 0, 0, 0, -1};
+	long long			t, start, allocs = 0;
+	volatile long long	sink = 0;
+	char				*str;
+	int					i;
+
+	start = nowNs();
+	while((res.iter < count) || ((nowNs() - start < budget * 1e9) && (res.iter + count <= JSBENCH_SAMPLES))) {
+		for(i=0; i<count; i++) {
+			allocs -= allocCount;
+			t = nowNs();
+			switch(what) {
+				case JSBENCH_XPATH:
+					sink += (xPath(paths[i], jsonObj) != NULL);
+					break;
+				case JSBENCH_GETSTR:
+					str = getJsonStr(paths[i], jsonObj);
+					free(str);
+					break;
+				default:
+					sink += getJsonInt(paths[i], jsonObj);
+			}
+			ns[res.iter++] = nowNs() - t;
+			allocs += allocCount;
+		}
+	}
+	(void)sink;
+	percentiles(&res, ns, res.iter);
+	if(JSBENCH_ALLOCS) {
+		res.allocs = (double)allocs / res.iter;
+	}
+	report(&res);
+}
+
+// сериализация
+static void benchAsString(const char *corpus, _jsonObj_t *jsonObj, long long *ns)
+{
+	_benchRes_t		res = {"asstring", corpus, 0, jsonObj->count, 0, 0, 0, 0, 0, 0, 0, -1};
+	long long		t, start, allocs = 0;
+	char			*str;
+
+	start = nowNs();
+	while((res.iter < JSBENCH_MIN_ITER) || ((nowNs() - start < budget * 1e9) && (res.iter < JSBENCH_SAMPLES))) {
+		allocs -= allocCount;
+		t = nowNs();
+		str = jsonAsString(jsonObj);
+		ns[res.iter++] = nowNs() - t;
+		allocs += allocCount;
+		res.bytes = (str != NULL) ? strlen(str) : 0;
+	}
+	percentiles(&res, ns, res.iter);
+	res.mbs = (double)res.bytes / res.p50 * 1e9 / (1 << 20);
+	res.tps = (double)res.tokens / res.p50 * 1e9;
+	if(JSBENCH_ALLOCS) {
+		res.allocs = (double)allocs / res.iter;
+	}
+	report(&res);
+}
+
+static void benchCorpus(const char *corpus, char *str, long long *ns)
+{
+	_jsonObj_t		*jsonObj;
+	char			*paths[JSBENCH_PATHS], path[JSBENCH_PATH_LEN];
+	int				count = 0, i;
+
+	if(!benchParse(corpus, str, false, ns) || !benchParse(corpus, str, true, ns)) {
+		return;
+	}
+	if(jsonParser(str, &jsonObj, strlen(str)) != 0) {
+		return;
+	}
+	if(jsonObj->token->type == JSON_OBJECT) {
+		collectPaths(jsonObj, jsonObj->token, path, 0, paths, &count);
+	}
+	if(count > 0) {
+		benchLookup(corpus, jsonObj, paths, count, JSBENCH_XPATH, ns);
+		benchLookup(corpus, jsonObj, paths, count, JSBENCH_GETSTR, ns);
+		benchLookup(corpus, jsonObj, paths, count, JSBENCH_GETINT, ns);
+	}
+	benchAsString(corpus, jsonObj, ns);
+	for(i=0; i<count; i++) {
+		free(paths[i]);
+	}
+	clearFlatJsonObj(&jsonObj);
+}
+
+/* Сравнение двух файлов результатов (-o) по p50
+ * Замеры сопоставляются по case + corpus + bytes (документы другого размера не сравниваются); медленнее более чем на threshold процентов - регрессия
+ * return:			кол-во регрессий
+*/
+
+typedef struct
+{
+	char			key[96];
+	double			p50;
+} _benchLine_t;
+
+static int loadResults(const char *fileName, _benchLine_t **lines)
+{
+	FILE			*f = fopen(fileName, "r");
+	char			line[1024], *name, *corpus;
+	_jsonObj_t		*jsonObj;
+	int				count = 0;
+
+	*lines = NULL;
+	if(f == NULL) {
+		fprintf(stderr, "%s: cannot open\n", fileName);
+		return -1;
+	}
+	while(fgets(line, sizeof(line), f) != NULL) {
+		if(jsonParser(line, &jsonObj, strlen(line)) != 0) {
+			continue;
+		}
+		name = getJsonStr("case", jsonObj);
+		corpus = getJsonStr("corpus", jsonObj);
+		if((name != NULL) && (corpus != NULL)) {
+			*lines = (_benchLine_t*)realloc(*lines, sizeof(_benchLine_t) * (count + 1));
+			snprintf((*lines)[count].key, sizeof((*lines)[count].key), "%s %s %lld", name, corpus, getJsonInt("bytes", jsonObj));
+			(*lines)[count].p50 = (double)getJsonDouble("p50_ns", jsonObj);
+			count++;
+		}
+		free(name);
+		free(corpus);
+		clearFlatJsonObj(&jsonObj);
+	}
+	fclose(f);
+	return count;
+}
+
+static int compare(const char *baseName, const char *newName, double threshold)
+{
+	_benchLine_t	*base, *cur;
+	int				baseCount = loadResults(baseName, &base), curCount = loadResults(newName, &cur), i, j, regress = 0;
+	double			diff;
+
+	for(i=0; i<curCount; i++) {
+		for(j=0; (j < baseCount) && (strcmp(base[j].key, cur[i].key) != 0); j++);
+		if((j == baseCount) || (base[j].p50 <= 0)) {
+			printf("%-30s %12s %12.0f  new\n", cur[i].key, "-", cur[i].p50);
+			continue;
+		}
+		diff = (cur[i].p50 - base[j].p50) / base[j].p50 * 100;
+		printf("%-30s %12.0f %12.0f %+7.1f%%%s\n", cur[i].key, base[j].p50, cur[i].p50, diff,
+			(diff > threshold) ? "  REGRESSION" : "");
+		if(diff > threshold) {
+			regress++;
+		}
+	}
+	free(base);
+	free(cur);
+	return regress;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-s KB] [-t sec] [-r seed] [-f file.json] [-o results.jsonl]\n"
+		"       %s -g comments|quotes|deep|wide|strings|numbers [-s KB] [-r seed]\n"
+		"       %s -c base.jsonl new.jsonl [-p percent]\n", name, name, name);
+}
+
+int main(int argc, char **argv)
+{
+	const char		*realFile = "../test/contract-hypothec-1.json", *genName = NULL, *outName = NULL;
+	size_t			size = 1024 << 10;
+	double			threshold = 5;
+	long long		*ns;
+	char			*str;
+	int				opt, i;
+	bool			cmp = false;
+
+	while((opt = getopt(argc, argv, "s:t:r:f:o:g:cp:h")) != -1) {
+		switch(opt) {
+			case 's': size = (size_t)atol(optarg) << 10; break;
+			case 't': budget = atof(optarg); break;
+			case 'r': rnd = strtoull(optarg, NULL, 10) | 1; break;
+			case 'f': realFile = optarg; break;
+			case 'o': outName = optarg; break;
+			case 'g': genName = optarg; break;
+			case 'c': cmp = true; break;
+			case 'p': threshold = atof(optarg); break;
+			default:
+				usage(argv[0]);
+				return 2;
+		}
+	}
+	if(cmp) {
+		if(argc - optind != 2) {
+			usage(argv[0]);
+			return 2;
+		}
+		return (compare(argv[optind], argv[optind + 1], threshold) > 0) ? 1 : 0;
+	}
+	if(genName != NULL) {
+		str = generate(genName, size);
+		if(str == NULL) {
+			usage(argv[0]);
+			return 2;
+		}
+		fputs(str, stdout);
+		free(str);
+		return 0;
+	}
+
+	if(outName != NULL) {
+		out = fopen(outName, "w");
+		if(out == NULL) {
+			fprintf(stderr, "%s: cannot create\n", outName);
+			return 2;
+		}
+	}
+	ns = (long long*)malloc(sizeof(long long) * JSBENCH_SAMPLES);
+	if(out != NULL) {
+		// параметры сборки: без corpus, при сравнении пропускается
+		fprintf(out, "{\"case\": \"build\", \"token_size\": %zu, \"offset_size\": %zu, \"size_kb\": %zu, \"seed\": %llu, \"budget\": %.3f}\n",
+			sizeof(_jsonToken_t), sizeof(_jsonOff_t), size >> 10, rnd, budget);
+	}
+	printf("%-9s %-9s %10s %9s %8s\n", "case", "corpus", "bytes", "tokens", "iter");
+
+	str = readFile(realFile);
+	if(str != NULL) {
+		benchCorpus("hypothec", str, ns);
+		free(str);
+	} else {
+		fprintf(stderr, "%s: cannot read, skipped\n", realFile);
+	}
+	for(i=0; generators[i].name != NULL; i++) {
+		str = generate(generators[i].name, size);
+		benchCorpus(generators[i].name, str, ns);
+		free(str);
+	}
+
+	free(ns);
+	if(out != NULL) {
+		fclose(out);
+	}
+	return 0;
+}
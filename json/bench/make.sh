@@ -0,0 +1,59 @@
+#!/bin/sh
+
+# сборка замеров: всегда с оптимизацией, компилятор и префикс - из окружения
+# ./make.sh [параметры jsbench], например ./make.sh -o base.jsonl
+
+if [ "$CC" = "" ]; then
+ CC=cc
+fi
+
+if [ "$PREFIX" = "" ]; then
+ PREFIX="/usr/local"
+fi
+
+OUT=jsbench
+rm -f $OUT
+
+LDFLAGS="-L$PREFIX/lib $LDFLAGS"
+
+# счётчик выделений памяти (см. JSBENCH_WRAP_MALLOC)
+WRAP="-DJSBENCH_WRAP_MALLOC -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc"
+
+__PARAM="-O2 -Wall -Wextra -std=gnu99 -D_REENTRANT"
+
+$CC ${__PARAM} \
+	${WRAP} \
+	-I${PREFIX}/include \
+	$CPPFLAGS \
+	$CFLAGS \
+	$LDFLAGS \
+	-o $OUT ./$OUT.c \
+	../lib/json/json.c \
+	../lib/json/jsonScan.c \
+	../lib/json/jsonArena.c \
+	../lib/json/jsonIndex.c \
+	../lib/json/jsonPath.c \
+	../lib/json/jsonCursor.c \
+	../lib/json/jsonStream.c \
+	../lib/json/jsonBatch.c \
+	../lib/json/jsonFile.c \
+	../lib/json/jsonNumber.c \
+	../lib/json/jsonString.c \
+	../lib/json/jsonWrite.c \
+	../lib/json/jsonTranscode.c \
+	../lib/json/jsonSax.c \
+	../lib/json/jsonExtract.c \
+	../lib/json/jsonValidate.c \
+	../lib/json/jsonEdit.c \
+	../lib/json/jsonReparse.c \
+	../lib/json/jsonSnapshot.c \
+	../lib/json/jsonCache.c \
+	../lib/json/jsonStats.c \
+	../lib/json/jsonBind.c \
+	../lib/string2/string2.c \
+	-lrt \
+	-lpthread \
+	-lm || exit 1
+
+chmod 755 ./$OUT
+./$OUT "$@"
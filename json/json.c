@@ -8,7 +8,10 @@
 */
 
 #include "json.h"
+#include "jsonScan.h"
 #include <stdio.h>
+#include <pthread.h>
+#include <sys/mman.h>
 
 const char* JSON_ERROR_LIST[] = {
 	"No error",
@@ -17,17 +20,50 @@ const char* JSON_ERROR_LIST[] = {
 	"Unexpected end of json",
 	"String value not in quotas",
 	"Illegal symbol",			// not in [0-9, -, .], повторная точка в числе
-	"Unexpected symbol"
+	"Unexpected symbol",
+	"Out of memory",
+	"File read error",
+	"Output error",
+	"Invalid snapshot",
+	"Value type mismatch",		// jsonBind: тип значения не подходит полю
+	"Required value missing",
+	"Value does not fit"		// jsonBind: строка длиннее буфера, число вне диапазона, массив больше поля
 };
 
-_jsonErr_t	error;
-char		cErr[256];
-_string2_t	*jsonString = NULL;
+// контекст по умолчанию: свой у каждого потока, освобождается при завершении потока
+static __thread _jsonCtx_t	*defaultCtx = NULL;
+static pthread_key_t		defaultCtxKey;
+static pthread_once_t		defaultCtxOnce = PTHREAD_ONCE_INIT;
 
 
-/* основная функция парсера
+/* основная функция парсера (контекст потока по умолчанию)
+ * см. jsonParser_r
+*/
+int jsonParser(char *str, _jsonObj_t **jsonObj, _jsonLen_t jsonLen)
+{
+	return jsonParser_r(str, jsonObj, jsonLen, jsonDefaultCtx());
+}
+
+/* основная функция парсера, реентерабельный вариант
  * str				IN  строка содержащая json
  * jsonObj			OUT неинициализированный указатель на _jsonObj_t
+ * jsonLen			IN  длина json'а (0 - до завершающего нуля)
+ * ctx				IN  контекст: ошибка и рабочие буферы. Один контекст - один поток
+ *
+ * _jsonObj_t распределяется через malloc, освобождается clearFlatJsonObj
+ * Для повторного использования памяти между разборами см. jsonDocInit/jsonDocParse
+*/
+int jsonParser_r(char *str, _jsonObj_t **jsonObj, _jsonLen_t jsonLen, _jsonCtx_t *ctx)
+{
+	*jsonObj = (_jsonObj_t*)malloc(sizeof(_jsonObj_t));
+	jsonDocInit(*jsonObj, NULL);
+	return jsonDocParse(*jsonObj, str, jsonLen, ctx);
+}
+
+/* разбор json'а в ранее инициализированный (jsonDocInit) документ
+ * doc				IN/OUT документ. Массив токенов предыдущего разбора переиспользуется
+ *					(если документ работает через арену - токены берутся из арены)
+ * str, jsonLen, ctx	см. jsonParser_r
  *
  * возврат:
  * 0 - успех
@@ -65,37 +101,209 @@ _string2_t	*jsonString = NULL;
  *  его можно получить вызвав getLastError()
  *
 */
-int jsonParser(char *str, _jsonObj_t **jsonObj, unsigned int jsonLen)
+int jsonDocParse(_jsonObj_t *doc, char *str, _jsonLen_t jsonLen, _jsonCtx_t *ctx)
 {
-	// start - признак того, что мы находимся внутри имени токена, или внутри его значения
-	bool				inQuotes = false, start = false;
-	unsigned int		i, len;
-	int					maxNesting = 0, level = 0, parentCount = 8;		// первоначально предполагаем глубину вложенности не более 8
-	int					*parent = (int*)malloc(sizeof(int*) * parentCount);		// массив указателей индексов родительских токенов
-	int					line = 1, col = 0, expectTokenCount;
-	char				lastControlSymbol;
-	_jsonToken_t		*token;
-	_jsonQuota_t		quotaType;
+	_jsonParseState_t	st;
+	_jsonLen_t			len = (jsonLen == 0) ? strlen(str) : jsonLen;
+	_jsonOff_t			expect;
+	int					res;
 
-	len = (jsonLen == 0) ? strlen(str) : jsonLen;
+	// документ не помещается в смещения токенов (см. JSON_OFFSET_64)
+	if(len > (_jsonLen_t)JSON_OFF_MAX) {
+		setError(ctx, 1, 1, '.', JSON_ERR_NO_MEMORY);
+		return 1;
+	}
+	// ожидаемое кол-во токенов в json'е (считаем, что токен в среднем 16 байт)
+	expect = (len < 2048) ? 64 : (len >> 4);
+	JSON_STATS_START(t);
+	if(jsonParseBegin(doc, &st, str, expect, ctx) != 0) {
+		return 1;
+	}
+	JSON_STATS_PHASE(ctx, JSON_STATS_ALLOC, t);
+#ifdef JSON_STATS
+	_jsonOff_t			capacity = doc->capacity;
+#endif
+	res = jsonParseRun(doc, &st, str, len, true, ctx);
+	JSON_STATS_PHASE(ctx, JSON_STATS_PARSE, t);
+#ifdef JSON_STATS
+	jsonStatsParse(ctx, doc, &st, len, expect, capacity, res);
+#endif
+	return res;
+}
 
-	expectTokenCount = (len < 2048) ? 64 : (len >> 4);		// ожидаемое кол-во токенов в json'е (считаем, что токен в среднем 16 байт)
+/* подготовка документа и состояния к разбору
+ * внутренняя ф-ция
+ * expectTokenCount	ожидаемое кол-во токенов (начальный размер массива токенов)
+*/
+int jsonParseBegin(_jsonObj_t *doc, _jsonParseState_t *st, const char *str, _jsonOff_t expectTokenCount, _jsonCtx_t *ctx)
+{
+	_jsonObj_t			**jsonObj = &doc;
+	_jsonToken_t		*tokens;
+
+	memset(st, 0, sizeof(_jsonParseState_t));
+	st->line = 1;
+
+	if(ctx->parent == NULL) {
+		// первоначально предполагаем глубину вложенности не более 8
+		ctx->parentCount = 8;
+		ctx->parent = (_jsonOff_t*)malloc(sizeof(_jsonOff_t) * ctx->parentCount);
+	}
+	ctx->parent[0] = 0;
 
-	*jsonObj = (_jsonObj_t*)malloc(sizeof(_jsonObj_t));
 	(*jsonObj)->count = (*jsonObj)->nesting = 0;
-	token = (*jsonObj)->token = (_jsonToken_t*)malloc(sizeof(_jsonToken_t) * expectTokenCount);
+	(*jsonObj)->json = str;
+	(*jsonObj)->len = 0;
+	if((*jsonObj)->arena != NULL) {
+		// арена: токены всегда распределяются заново, освобождение - сбросом арены
+		(*jsonObj)->token = NULL;
+		(*jsonObj)->capacity = 0;
+		(*jsonObj)->index = NULL;
+		(*jsonObj)->num = NULL;
+		(*jsonObj)->edit = NULL;
+	}
+	if(jsonTokensMapped(*jsonObj)) {
+		// токены снимка только для чтения: новый массив
+		(*jsonObj)->token = NULL;
+		(*jsonObj)->capacity = 0;
+	}
+	jsonFreeIndex(*jsonObj);
+	jsonFreeNumbers(*jsonObj);
+	jsonEditFree(*jsonObj);
+	if((*jsonObj)->capacity < expectTokenCount) {
+		tokens = (_jsonToken_t*)jsonObjRealloc(*jsonObj, (*jsonObj)->token,
+			sizeof(_jsonToken_t) * (*jsonObj)->capacity, sizeof(_jsonToken_t) * expectTokenCount);
+		if(tokens == NULL) {
+			setError(ctx, st->line, st->col, '.', JSON_ERR_NO_MEMORY);
+			return 1;
+		}
+		(*jsonObj)->token = tokens;
+		(*jsonObj)->capacity = expectTokenCount;
+	}
 	(*jsonObj)->token->start = (*jsonObj)->token->end = 0;
-	(*jsonObj)->token->id = 0;
 	(*jsonObj)->token->parent = 0;
+#ifndef JSON_COMPACT_TOKENS
+	(*jsonObj)->token->id = 0;
 	(*jsonObj)->token->fChild = 0;
 	(*jsonObj)->token->lChild = 0;
+#endif
 	(*jsonObj)->token->nextToken = 0;
 	(*jsonObj)->token->valueType = 0;
+	(*jsonObj)->token->type = 0;
+	(*jsonObj)->token->escaped = 0;
+	return 0;
+}
+
+/* нужны ли для обработки символа str[i] данные за пределами len
+ * внутренняя ф-ция, используется при разборе по частям (см. jsonParseRun)
+ * Заглядывание вперёд есть только у комментариев и у значений без кавычек (числа, null, true, false)
+*/
+static bool jsonNeedMore(_jsonParseState_t *st, const char *str, _jsonLen_t i, _jsonLen_t len, bool inQuotes, bool start)
+{
+	_jsonLen_t		j;
+
+	if(inQuotes) {
+		return false;
+	}
+	// поиск продолжается с места, где остановились в прошлый раз
+	j = ((st->waitPos == i) && (st->waitScan > i)) ? st->waitScan : i;
+	st->waitPos = i;
+	switch(str[i]) {
+		case '/':
+			if(i + 1 >= len) {
+				return true;
+			}
+			if(str[i+1] == '/') {
+				for(j=(j < i+2) ? i+2 : j; j<len; j++) {
+					if((str[j] == '\r') || (str[j] == '\n')) {
+						return false;
+					}
+				}
+				st->waitScan = j;
+				return true;
+			}
+			if(str[i+1] == '*') {
+				for(j=(j < i+2) ? i+2 : j; j+1<len; j++) {
+					if((str[j] == '*') && (str[j+1] == '/')) {
+						return false;
+					}
+				}
+				st->waitScan = j;
+				return true;
+			}
+			return false;
+		case ' ': case '\t': case '\r': case '\n':
+		case '[': case '{': case ':': case ',': case '}': case ']':
+		case '"': case '\'':
+			return false;
+		default:
+			if(start) {
+				return false;
+			}
+			// конец числа/литерала и ещё 2 символа (проверка на начало комментария)
+			for(; j<len; j++) {
+				switch(str[j]) {
+					case ' ': case '\t': case '\r': case '\n':
+					case '[': case '{': case ':': case ',': case '}': case ']':
+					case '"': case '\'': case '/':
+						return (j + 2 >= len);
+				}
+			}
+			st->waitScan = j;
+			return true;
+	}
+}
+
+/* основной цикл разбора
+ * внутренняя ф-ция
+ * st				состояние разбора (jsonParseBegin), сохраняется между вызовами
+ * str, len			json (len - сколько байт уже доступно)
+ * final			признак того, что данных больше не будет
+ *
+ * возврат:
+ * 0 - успех
+ * 1 - invalid json
+ * JSON_PARSE_MORE - (только при final == false) обработаны все доступные данные, нужны ещё
+ *
+ * При final == false разбор останавливается перед символом, для обработки которого нужно заглянуть
+ * за пределы доступных данных. Позиции токенов - смещения от начала str, поэтому str при следующем
+ * вызове может указывать на другой (увеличенный) буфер с тем же началом
+*/
+int jsonParseRun(_jsonObj_t *doc, _jsonParseState_t *st, const char *str, _jsonLen_t len, bool final, _jsonCtx_t *ctx)
+{
+	_jsonObj_t			**jsonObj = &doc;
+	// start - признак того, что мы находимся внутри имени токена, или внутри его значения
+	bool				inQuotes = st->inQuotes, start = st->start;
+	_jsonLen_t			i = st->i, j, comment;
+	int					maxNesting = st->maxNesting, level = st->level;
+	_jsonOff_t			*parent = ctx->parent;		// массив индексов родительских токенов (живёт в контексте между вызовами)
+	int					line = st->line, col = st->col;
+	char				lastControlSymbol = st->lastControlSymbol;
+	_jsonToken_t		*token = (*jsonObj)->token + st->token;
+	_jsonQuota_t		quotaType = st->quotaType;
+	_jsonScan_t			scan;
 
 	(*jsonObj)->json = str;
-	parent[0] = 0;
+	(*jsonObj)->len = len;
+	jsonScanInit(&scan, str, len);
 
-	for(i=0; i<len; i++) {
+	for(; i<len; i++) {
+		// пропуск байт, не меняющих состояние парсера (по структурному индексу):
+		// содержимое строки, хвост имени без кавычек, отступы
+		if(start) {
+			j = jsonScanNext(&scan, i, (inQuotes) ? JSON_SCAN_QUOTE : JSON_SCAN_DELIM);
+		} else if(!inQuotes) {
+			j = jsonScanNext(&scan, i, JSON_SCAN_SPACE);
+		} else {
+			j = i;
+		}
+		col += j - i;
+		i = j;
+		if(i == len) {
+			break;
+		}
+		if(!final && jsonNeedMore(st, str, i, len, inQuotes, start)) {
+			break;
+		}
 		col++;
 		switch(str[i]) {
 			// исключение комментариев
@@ -109,25 +317,31 @@ int jsonParser(char *str, _jsonObj_t **jsonObj, unsigned int jsonLen)
 					}
 				}
 				if(str[i+1] == '/') {
-					// однострочный
-					i+=2;
+					// однострочный (в статистику - длина законченного комментария)
+					comment = i;
+					i = jsonScanNext(&scan, i+2, JSON_SCAN_COMMENT);
 					while((str[i] != '\r') && (str[i] != '\n')) {
 						// не вышли из комментария!
 						if(i == len)
 							return 1;
-						i++;
+						i = jsonScanNext(&scan, i+1, JSON_SCAN_COMMENT);
 					}
+					st->commentBytes += i - comment;
 					col = 0;
 					break;
 				}
 				if(str[i+1] == '*') {
 					// многострочный
+					comment = i;
 					i+=2;
 					while((str[i] != '*') || (str[i+1] != '/')) {
 						// не вышли из комментария!
 						if(i == len)
 							return 1;
-						i++;
+						// до ближайшего '*' или переноса строки
+						j = jsonScanNext(&scan, i+1, JSON_SCAN_COMMENT);
+						col += j - i - 1;
+						i = j;
 						if(str[i] == '\n') {
 							line++;
 							col = 0;
@@ -136,20 +350,25 @@ int jsonParser(char *str, _jsonObj_t **jsonObj, unsigned int jsonLen)
 						}
 					}
 					i++;
+					st->commentBytes += i + 1 - comment;
 					break;
 				}
 				// подавление "warning: this statement may fall through [-Wimplicit-fallthrough=]"
 				__attribute__ ((fallthrough));
 
 			case '"':
-				if(str[i-1] != '\\') {
+				if((i == 0) || (str[i-1] != '\\')) {
 					if(!inQuotes) {
 						quotaType = JSON_QUOTA_DOUBLE;
 						inQuotes = !inQuotes;
 					} else if(quotaType == JSON_QUOTA_DOUBLE) {
 						// обработка пустых кавычек
-						if((str[i-1] == '\"') && (str[i-2] != '\\')) {
-							token = assignNewToken(jsonObj, &expectTokenCount, i, parent[level]);
+						if((str[i-1] == '\"') && ((i < 2) || (str[i-2] != '\\'))) {
+							token = assignNewToken(jsonObj, i, parent[level]);
+							if(token == NULL) {
+								setError(ctx, line, col, '.', JSON_ERR_NO_MEMORY);
+								return 1;
+							}
 							token->type = JSON_VALUE;
 							lastControlSymbol = 0;
 							token->valueType = JSON_VALUE_STRING;
@@ -160,7 +379,11 @@ int jsonParser(char *str, _jsonObj_t **jsonObj, unsigned int jsonLen)
 					} else if((quotaType == JSON_QUOTA_SINGLE) && (start == false)) {
 						// обработка варианта '"..... (двойная сразу после одинарной)
 						start = true;
-						token = assignNewToken(jsonObj, &expectTokenCount, i, parent[level]);
+						token = assignNewToken(jsonObj, i, parent[level]);
+						if(token == NULL) {
+							setError(ctx, line, col, '.', JSON_ERR_NO_MEMORY);
+							return 1;
+						}
 						token->type = JSON_VALUE;
 						lastControlSymbol = 0;
 						token->valueType = JSON_VALUE_STRING;
@@ -168,14 +391,18 @@ int jsonParser(char *str, _jsonObj_t **jsonObj, unsigned int jsonLen)
 				}
 				break;
 			case '\'':
-				if(str[i-1] != '\\') {
+				if((i == 0) || (str[i-1] != '\\')) {
 					if(!inQuotes) {
 						quotaType = JSON_QUOTA_SINGLE;
 						inQuotes = !inQuotes;
 					} else if(quotaType == JSON_QUOTA_SINGLE) {
 						// обработка пустых кавычек
-						if((str[i-1] == '\'') && (str[i-2] != '\\')) {
-							token = assignNewToken(jsonObj, &expectTokenCount, i, parent[level]);
+						if((str[i-1] == '\'') && ((i < 2) || (str[i-2] != '\\'))) {
+							token = assignNewToken(jsonObj, i, parent[level]);
+							if(token == NULL) {
+								setError(ctx, line, col, '.', JSON_ERR_NO_MEMORY);
+								return 1;
+							}
 							token->type = JSON_VALUE;
 							lastControlSymbol = 0;
 							token->valueType = JSON_VALUE_STRING;
@@ -186,7 +413,11 @@ int jsonParser(char *str, _jsonObj_t **jsonObj, unsigned int jsonLen)
 					} else if((quotaType == JSON_QUOTA_DOUBLE) && (start == false)) {
 						// обработка варианта "'..... (одинарная сразу после двойной)
 						start = true;
-						token = assignNewToken(jsonObj, &expectTokenCount, i, parent[level]);
+						token = assignNewToken(jsonObj, i, parent[level]);
+						if(token == NULL) {
+							setError(ctx, line, col, '.', JSON_ERR_NO_MEMORY);
+							return 1;
+						}
 						token->type = JSON_VALUE;
 						lastControlSymbol = 0;
 						token->valueType = JSON_VALUE_STRING;
@@ -221,7 +452,7 @@ int jsonParser(char *str, _jsonObj_t **jsonObj, unsigned int jsonLen)
 						((lastControlSymbol == '[') && ((str[i] == '}') || (str[i] == ':') || (str[i] == ','))) ||	// [	[ "}",":","," ]
 						(((lastControlSymbol == ':') || (lastControlSymbol == ',')) && ((str[i] == ':') || (str[i] == ','))))	// :	: , и ,	: ,
 					{
-						setError(line, col, str[i], JSON_ERR_UNEXPECTED_SYMBOL, &parent);
+						setError(ctx, line, col, str[i], JSON_ERR_UNEXPECTED_SYMBOL);
 						return 1;
 					}
 					lastControlSymbol = str[i];
@@ -233,20 +464,29 @@ int jsonParser(char *str, _jsonObj_t **jsonObj, unsigned int jsonLen)
 								if(str[i] == '{') {
 									if(token->type != JSON_KEY) {
 										if(((*jsonObj)->token + parent[level])->type == JSON_OBJECT) {
-											setError(line, col, '.', JSON_ERR_OBJ_IN_OBJ, &parent);
+											setError(ctx, line, col, '.', JSON_ERR_OBJ_IN_OBJ);
 											return 1;
 										}
 									}
 								}
 								// объекты и массивы
-								token = assignNewToken(jsonObj, &expectTokenCount, i, parent[level]);
+								token = assignNewToken(jsonObj, i, parent[level]);
+								if(token == NULL) {
+									setError(ctx, line, col, '.', JSON_ERR_NO_MEMORY);
+									return 1;
+								}
+							} else if((*jsonObj)->sax != NULL) {
+								// корневой контейнер - токен 0, его событие уходит перед первым потомком
+								(*jsonObj)->saxPending = 0;
 							}
 							token->type = (str[i]=='{')? JSON_OBJECT:JSON_ARRAY;
 							token->start = i;
 							token->end = i+1;
 							level++;
-							if(parentCount == level)
-								parent = (int*)realloc(parent, sizeof(int*) * (parentCount <<= 1));
+							if(ctx->parentCount == level) {
+								parent = ctx->parent = (_jsonOff_t*)realloc(parent, sizeof(_jsonOff_t) * (ctx->parentCount <<= 1));
+								JSON_STATS_ADD(ctx, parentReallocs, 1);
+							}
 							parent[level] = (*jsonObj)->count;
 							if(level > maxNesting)
 								maxNesting = level;
@@ -255,13 +495,13 @@ int jsonParser(char *str, _jsonObj_t **jsonObj, unsigned int jsonLen)
 							// ВАЛИДАЦИЯ: Ключ без значения (JSON_ERR_SINGLE_KEY)
 							if((str[i] == '}') || (str[i] == ',')) {
 								if((token->type == JSON_KEY) && (((*jsonObj)->token + token->parent)->type == JSON_OBJECT)) {
-									setError(line, col, '.', JSON_ERR_SINGLE_KEY, &parent);
+									setError(ctx, line, col, '.', JSON_ERR_SINGLE_KEY);
 									return 1;
 								}
 							}
 							// ВАЛИДАЦИЯ: В массиве не может быть ":" (JSON_ERR_UNEXPECTED_SYMBOL)
 							if((str[i] == ':') && (((*jsonObj)->token + token->parent)->type == JSON_ARRAY)) {
-								setError(line, col, ':', JSON_ERR_UNEXPECTED_SYMBOL, &parent);
+								setError(ctx, line, col, ':', JSON_ERR_UNEXPECTED_SYMBOL);
 								return 1;
 							}
 							if(token->end == 0) {
@@ -270,13 +510,18 @@ int jsonParser(char *str, _jsonObj_t **jsonObj, unsigned int jsonLen)
 							if((str[i] == '}') || (str[i] == ']')) {
 								// Проверка на корректное закрытие массива/объекта
 								_jsonType_t ParentType = ((*jsonObj)->token + parent[level])->type;
+								// закрывающая скобка без открытого контейнера (после корня) - тоже неожиданный символ
 								if(
+									(level == 0) ||
 									((ParentType == JSON_OBJECT) && (str[i] == ']')) ||
 									((ParentType == JSON_ARRAY) && (str[i] == '}')))
 								{
-									setError(line, col, str[i], JSON_ERR_UNEXPECTED_SYMBOL, &parent);
+									setError(ctx, line, col, str[i], JSON_ERR_UNEXPECTED_SYMBOL);
 									return 1;
 								}
+								if(((*jsonObj)->sax != NULL) && !jsonSaxClose(*jsonObj, ParentType, i)) {
+									return JSON_PARSE_STOP;
+								}
 								level--;
 							}
 							break;
@@ -291,7 +536,11 @@ int jsonParser(char *str, _jsonObj_t **jsonObj, unsigned int jsonLen)
 				// Обработка ключей и значений
 				if(!start) {
 					start = true;
-					token = assignNewToken(jsonObj, &expectTokenCount, i, parent[level]);
+					token = assignNewToken(jsonObj, i, parent[level]);
+					if(token == NULL) {
+						setError(ctx, line, col, '.', JSON_ERR_NO_MEMORY);
+						return 1;
+					}
 					// Ключ может быть только в объектах!
 					token->type = (((*jsonObj)->token + token->parent)->type == JSON_OBJECT) ? JSON_KEY : JSON_VALUE;
 
@@ -299,7 +548,7 @@ int jsonParser(char *str, _jsonObj_t **jsonObj, unsigned int jsonLen)
 						// ВАЛИДАЦИЯ: неожиданный символ (JSON_ERR_UNEXPECTED_SYMBOL)
 						if(((lastControlSymbol == ']') || (lastControlSymbol == '}')) && ((str[i] != ']') && (str[i] != '}'))) {
 							// для ] и }	неожиданно всё, кроме ] и }
-							setError(line, col, str[i], JSON_ERR_UNEXPECTED_SYMBOL, &parent);
+							setError(ctx, line, col, str[i], JSON_ERR_UNEXPECTED_SYMBOL);
 							return 1;
 						}
 						lastControlSymbol = 0;
@@ -324,7 +573,7 @@ int jsonParser(char *str, _jsonObj_t **jsonObj, unsigned int jsonLen)
 											token->valueType = JSON_VALUE_FLOAT;
 										} else {
 											// Проверка на вторую "." в числе
-											setError(line, col, str[i], JSON_ERR_ILLEGAL_SYMBOL, &parent);
+											setError(ctx, line, col, str[i], JSON_ERR_ILLEGAL_SYMBOL);
 											return 1;
 										}
 									}
@@ -349,7 +598,7 @@ int jsonParser(char *str, _jsonObj_t **jsonObj, unsigned int jsonLen)
 									col--;
 									break;
 								} else {
-									setError(line, col, str[i], JSON_ERR_ILLEGAL_SYMBOL, &parent);
+									setError(ctx, line, col, str[i], JSON_ERR_ILLEGAL_SYMBOL);
 									return 1;
 								}
 							} else if(
@@ -417,7 +666,7 @@ int jsonParser(char *str, _jsonObj_t **jsonObj, unsigned int jsonLen)
 								break;
 							} else {
 								// ВАЛИДАЦИЯ: строковое значение без кавычек (JSON_ERR_STRING_WITHOUT_QUOTA)
-								setError(line, col, '.', JSON_ERR_STRING_WITHOUT_QUOTA, &parent);
+								setError(ctx, line, col, '.', JSON_ERR_STRING_WITHOUT_QUOTA);
 								return 1;
 							}
 						}
@@ -426,15 +675,35 @@ int jsonParser(char *str, _jsonObj_t **jsonObj, unsigned int jsonLen)
 						lastControlSymbol = 0;
 					}
 				}
+				// escape-последовательность в строке: отмечается в токене (см. jsonTokenString)
+				if(inQuotes && (str[i] == '\\')) {
+					token->escaped = 1;
+				}
 		}
 	}
+	if(!final) {
+		st->i = i;
+		st->inQuotes = inQuotes;
+		st->start = start;
+		st->maxNesting = maxNesting;
+		st->level = level;
+		st->line = line;
+		st->col = col;
+		st->lastControlSymbol = lastControlSymbol;
+		st->token = token - (*jsonObj)->token;
+		st->quotaType = quotaType;
+		return JSON_PARSE_MORE;
+	}
+
 	// ВАЛИДАЦИЯ: Unexpected end of json (JSON_ERR_UNEXPECTED_END)
 	if(level > 0) {
-		setError(line, col, '.', JSON_ERR_UNEXPECTED_END, &parent);
+		setError(ctx, line, col, '.', JSON_ERR_UNEXPECTED_END);
 		return 1;
 	}
+	if(((*jsonObj)->sax != NULL) && !jsonSaxFlush(*jsonObj)) {
+		return JSON_PARSE_STOP;
+	}
 
-	free(parent);
 	if((*jsonObj)->count > 0) {
 		(*jsonObj)->count++;
 		(*jsonObj)->nesting = maxNesting;
@@ -445,25 +714,51 @@ int jsonParser(char *str, _jsonObj_t **jsonObj, unsigned int jsonLen)
 /* перемещение указателя текущего элемента на новый элемент, или распределение памяти для порции новых элементов
  * внутренняя ф-ция
 */
-_jsonToken_t* assignNewToken(_jsonObj_t **jsonObj, int *expectTokenCount, int pos, int parent)
+_jsonToken_t* assignNewToken(_jsonObj_t **jsonObj, _jsonOff_t pos, _jsonOff_t parent)
 {
 	_jsonToken_t	*parentToken;	// родительский токен
+#ifdef JSON_COMPACT_TOKENS
+	_jsonOff_t		prev;			// предыдущий токен того же уровня
+#endif
+	_jsonToken_t	*tokens;
 
+	if((*jsonObj)->sax != NULL) {
+		return jsonSaxToken(*jsonObj, pos, parent);
+	}
 	(*jsonObj)->count++;			// ID текущего токена
-	if((*jsonObj)->count == *((int*)expectTokenCount)) {
-		(*jsonObj)->token = (_jsonToken_t*)realloc((*jsonObj)->token, sizeof(_jsonToken_t) * (*((int*)expectTokenCount) <<= 1));
+	if((*jsonObj)->count == (*jsonObj)->capacity) {
+		tokens = (_jsonToken_t*)jsonObjRealloc(*jsonObj, (*jsonObj)->token,
+			sizeof(_jsonToken_t) * (*jsonObj)->capacity, sizeof(_jsonToken_t) * ((*jsonObj)->capacity << 1));
+		if(tokens == NULL) {
+			(*jsonObj)->count--;
+			return NULL;
+		}
+		(*jsonObj)->token = tokens;
+		(*jsonObj)->capacity <<= 1;
 	}
 	_jsonToken_t *token = ((*jsonObj)->token + (*jsonObj)->count);
-	token->id = (*jsonObj)->count;	// ID текущего токена
 	// если предыдущий токен - ключ, то это родитель
 	// иначе, родителем может быть массив или объект
 	token->parent = ((token-1)->type == JSON_KEY)?((*jsonObj)->count-1):parent;
 	token->start = pos;
 	token->end = 0;
-	token->fChild = 0;
-	token->lChild = 0;
 	token->nextToken = 0;
 	token->valueType = 0;
+	token->escaped = 0;
+
+#ifdef JSON_COMPACT_TOKENS
+	// lChild не хранится: предыдущий сосед - предок предыдущего токена, прямой потомок того же родителя
+	// (предыдущий токен всегда лежит в поддереве родителя, подъём - не глубже текущей вложенности)
+	for(prev=(*jsonObj)->count-1; (prev > token->parent) && (((*jsonObj)->token + prev)->parent != token->parent);
+		prev=((*jsonObj)->token + prev)->parent);
+	if(prev > token->parent) {
+		((*jsonObj)->token + prev)->nextToken = (*jsonObj)->count;
+	}
+	(void)parentToken;
+#else
+	token->id = (*jsonObj)->count;	// ID текущего токена
+	token->fChild = 0;
+	token->lChild = 0;
 
 	parentToken = (*jsonObj)->token+token->parent;
 	// сохранение id 1го дочернего элемента в родительском токене
@@ -476,125 +771,225 @@ _jsonToken_t* assignNewToken(_jsonObj_t **jsonObj, int *expectTokenCount, int po
 		((*jsonObj)->token+parentToken->lChild)->nextToken = (*jsonObj)->count;
 	}
 	parentToken->lChild = (*jsonObj)->count;
+#endif
 
 	return token;
 }
 
-void setError(int line, int col, char ch, int errNum, int **parent)
+void setError(_jsonCtx_t *ctx, int line, int col, char ch, int errNum)
 {
 	char cCh[2];
 
-	error.line = line;
-	error.col = col-1;
-	error.code = errNum;
+	ctx->error.line = line;
+	ctx->error.col = col-1;
+	ctx->error.code = errNum;
+	JSON_STATS_ADD(ctx, errors, 1);
 	switch(errNum) {
 		case JSON_ERR_UNEXPECTED_SYMBOL:
 		case JSON_ERR_ILLEGAL_SYMBOL:
 			cCh[0] = ch;
 			cCh[1] = 0;
-			strcpy(cErr, JSON_ERROR_LIST[errNum]);
-			strcat(cErr, ": \"");
-			strcat(cErr, cCh);
-			strcat(cErr, "\"");
-			error.message = cErr;
+			strcpy(ctx->cErr, JSON_ERROR_LIST[errNum]);
+			strcat(ctx->cErr, ": \"");
+			strcat(ctx->cErr, cCh);
+			strcat(ctx->cErr, "\"");
+			ctx->error.message = ctx->cErr;
 			break;
 		default:
-			error.message = JSON_ERROR_LIST[errNum];
+			ctx->error.message = JSON_ERROR_LIST[errNum];
 	}
-	free(*parent);
 }
 
 _jsonErr_t* getLastError()
 {
-	return &error;
+	return getLastError_r(jsonDefaultCtx());
+}
+
+_jsonErr_t* getLastError_r(_jsonCtx_t *ctx)
+{
+	return &ctx->error;
+}
+
+/* Контекст парсера/сериализатора
+ * Содержит всё изменяемое состояние: последнюю ошибку, стек родителей, выходной буфер jsonAsString_r
+ * Один контекст не должен использоваться одновременно из нескольких потоков
+*/
+void jsonCtxInit(_jsonCtx_t *ctx)
+{
+	memset(ctx, 0, sizeof(_jsonCtx_t));
+	ctx->error.message = JSON_ERROR_LIST[JSON_ERR_NO_ERROR];
+}
+
+void jsonCtxFree(_jsonCtx_t *ctx)
+{
+	if(ctx->parent != NULL) {
+		free(ctx->parent);
+		ctx->parent = NULL;
+	}
+	if(ctx->jsonString != NULL) {
+		strfree2(&ctx->jsonString);
+		ctx->jsonString = NULL;
+	}
+}
+
+static void defaultCtxDestroy(void *ctx)
+{
+	jsonCtxFree((_jsonCtx_t*)ctx);
+	free(ctx);
+}
+
+static void defaultCtxKeyCreate()
+{
+	pthread_key_create(&defaultCtxKey, defaultCtxDestroy);
+}
+
+// контекст по умолчанию текущего потока (используется не-_r функциями)
+_jsonCtx_t* jsonDefaultCtx()
+{
+	if(defaultCtx == NULL) {
+		pthread_once(&defaultCtxOnce, defaultCtxKeyCreate);
+		defaultCtx = (_jsonCtx_t*)malloc(sizeof(_jsonCtx_t));
+		jsonCtxInit(defaultCtx);
+		pthread_setspecific(defaultCtxKey, defaultCtx);
+	}
+	return defaultCtx;
 }
 
 // очистка занятой памяти, после того, как разобранный json уже не нужен
 void clearFlatJsonObj(_jsonObj_t **jsonObj)
 {
 	if(jsonObj != NULL) {
-		if((*jsonObj)->token != NULL) {
-			free((*jsonObj)->token);
-			(*jsonObj)->token = NULL;
-		}
+		jsonDocFree(*jsonObj);
 		free((*jsonObj));
 		*jsonObj = NULL;
 	}
 }
 
+/* Документ для многократного разбора
+ * doc				IN  память под _jsonObj_t (на стеке, в структуре клиента, в арене...)
+ * arena			IN  арена, из которой берётся вся память разбора, или NULL (malloc)
+ * Без арены массив токенов сохраняется между вызовами jsonDocParse и только растёт.
+ * С ареной каждый разбор берёт токены из арены; освобождается всё разом через jsonArenaReset
+*/
+void jsonDocInit(_jsonObj_t *doc, _jsonArena_t *arena)
+{
+	memset(doc, 0, sizeof(_jsonObj_t));
+	doc->arena = arena;
+}
+
+// освобождение памяти документа (сам _jsonObj_t не освобождается)
+void jsonDocFree(_jsonObj_t *doc)
+{
+	jsonFreeIndex(doc);
+	jsonFreeNumbers(doc);
+	jsonEditFree(doc);
+	if((doc->token != NULL) && !jsonTokensMapped(doc)) {
+		jsonObjFree(doc, doc->token);
+	}
+	doc->token = NULL;
+	if(doc->own != NULL) {
+		free(doc->own);
+		doc->own = NULL;
+	}
+	if(doc->map != NULL) {
+		munmap(doc->map, doc->mapSize);
+		doc->map = NULL;
+	}
+	doc->capacity = 0;
+	doc->count = 0;
+}
+
+/* распределение памяти документа: из арены, если она задана, иначе - malloc
+ * внутренние ф-ции
+*/
+void* jsonObjAlloc(_jsonObj_t *jsonObj, size_t size)
+{
+	return (jsonObj->arena != NULL) ? jsonArenaAlloc(jsonObj->arena, size) : malloc(size);
+}
+
+void* jsonObjRealloc(_jsonObj_t *jsonObj, void *p, size_t oldSize, size_t size)
+{
+	return (jsonObj->arena != NULL) ? jsonArenaRealloc(jsonObj->arena, p, oldSize, size) : realloc(p, size);
+}
+
+void jsonObjFree(_jsonObj_t *jsonObj, void *p)
+{
+	if(jsonObj->arena == NULL) {
+		free(p);
+	}
+}
+
 /* получение значение элемента json'a по пути
  * внутренняя ф-ция
+ * return:			токен значения (только JSON_VALUE) или 0
 */
 _jsonToken_t* xPath(const char *path, _jsonObj_t *jsonObj)
 {
-	int				pathElem[jsonObj->nesting][2];		// [смещение, длина]
-	int				len = strlen(path);
-	int				i, pathCount = 0;
-	_jsonToken_t	*token;
+	_jsonToken_t	*token = xPathNode(path, jsonObj);
 
-	if(jsonObj->nesting == 0)
-		return (_jsonToken_t*) (0);
+	if(token == (_jsonToken_t*)(0)) {
+		return token;
+	}
+	if(token->type == JSON_OBJECT) {
+		token = jsonObj->token + jsonTokenFChild(jsonObj, token);
+	}
+	return (token->type == JSON_VALUE) ? token : (_jsonToken_t*)(0);	// ACHTUNG! нормальное описание ошибки !!!
+}
 
-	pathElem[0][0] = pathElem[0][1] = 0;
-	for(i=0; i<len; i++) {
-		if(path[i] == '.') {
-			pathElem[pathCount+1][0] = i+1;
-			pathElem[++pathCount][1] = 0;
-		}
-		else
-			pathElem[pathCount][1]++;
-	}
-	if(pathCount == 0) {
-		pathElem[0][1] = len;
-	}
-	if((pathCount > jsonObj->nesting) || (pathElem[0][1] == 0))
-		return (_jsonToken_t*) (0);						// ACHTUNG! нормальное описание ошибки !!!
-
-	pathCount++;
-	token = jsonObj->token + jsonObj->token->fChild;
-
-	for(i=0; i<pathCount; i++) {
-		// Ищем начиная с первого дочернего токена корневого элемента
-		if((token->end - token->start) == pathElem[i][1]) {
-			while (strncmp(path + pathElem[i][0], jsonObj->json + token->start, pathElem[i][1]) != 0) {
-				if(token->nextToken > 0) {
-					token = jsonObj->token + token->nextToken;
-					if(token->type == JSON_OBJECT) {
-						token = jsonObj->token + token->fChild;
-					}
-				} else {
-					return (_jsonToken_t*)(0);			// ACHTUNG! нормальное описание ошибки !!!
-				}
-			}
+// поиск узла по пути (см. xPathNode)
+static inline _jsonToken_t* findNode(const char *path, _jsonObj_t *jsonObj)
+{
+	const char		*elem = path, *dot;
+	_jsonLen_t		len;
+	_jsonToken_t	*token = jsonObj->token;
 
-			if(i == (pathCount-1)) {
-				token = jsonObj->token + token->fChild;
-				if(token->type == JSON_OBJECT) {
-					token = jsonObj->token + token->fChild;
-				}
-				if(token->type == JSON_VALUE) {
-					return token;
-				} else {
-					return (_jsonToken_t*)(0);			// ACHTUNG! нормальное описание ошибки !!!
-				}
-			} else {
-				token = jsonObj->token + token->fChild;
-				if(token->type == JSON_OBJECT) {
-					token = jsonObj->token + token->fChild;
-				}
-				continue;
-			}
-		}
+	if(jsonObj->count == 0)
+		return (_jsonToken_t*) (0);
+
+	// путь разбирается на месте: элемент - от начала (или точки) до следующей точки
+	// поиск ключа - через индекс документа, если он построен (jsonBuildIndex)
+	while(1) {
+		dot = strchr(elem, '.');
+		len = (dot == NULL) ? (_jsonLen_t)strlen(elem) : (_jsonLen_t)(dot - elem);
+		if(len == 0)
+			return (_jsonToken_t*) (0);					// ACHTUNG! нормальное описание ошибки !!!
+		token = jsonFindKey(jsonObj, token, elem, len);
+		if((token == NULL) || (jsonTokenFChild(jsonObj, token) == 0))
+			return (_jsonToken_t*) (0);					// ACHTUNG! нормальное описание ошибки !!!
+		token = jsonObj->token + jsonTokenFChild(jsonObj, token);
+		if(dot == NULL)
+			return token;
+		elem = dot + 1;
 	}
-	return (_jsonToken_t*) (0);						// ACHTUNG! нормальное описание ошибки !!!
+}
+
+/* получение узла json'a по пути: значение ключа любого типа (значение, объект, массив)
+ * внутренняя ф-ция (контекст потока по умолчанию), см. xPathNode_r
+*/
+_jsonToken_t* xPathNode(const char *path, _jsonObj_t *jsonObj)
+{
+	return xPathNode_r(path, jsonObj, jsonDefaultCtx());
+}
+
+/* получение узла по пути
+ * ctx				контекст для статистики поиска (см. jsonStats_r)
+*/
+_jsonToken_t* xPathNode_r(const char *path, _jsonObj_t *jsonObj, _jsonCtx_t *ctx)
+{
+	_jsonToken_t	*token;
+
+	JSON_STATS_START(t);
+	token = findNode(path, jsonObj);
+	JSON_STATS_PHASE(ctx, JSON_STATS_LOOKUP, t);
+	return token;
 }
 
 /* получение указателя на значение элемента json'a по пути
  * внутренняя ф-ция
 */
 void* getJsonVal(const char *key, _jsonObj_t *jsonObj) {
-	void	*value;
-	int		len;
+	void		*value;
+	_jsonOff_t	len;
 
 	_jsonToken_t *token = xPath(key, jsonObj);
 	if(token != (_jsonToken_t*)(0)) {
@@ -607,6 +1002,153 @@ void* getJsonVal(const char *key, _jsonObj_t *jsonObj) {
 	return NULL;
 }
 
+/* получение значения элемента json'a по пути без копирования
+ * key				cтрока содержащая путь к элементу
+ * jsonObj			указатель на _jsonObj_t, возвращённый предварительным вызовом jsonParser
+ * view				OUT указатель на значение внутри jsonObj->json, его длина и тип
+ * return:			false - значение не найдено
+ * Значение не завершается нулём! Действительно, пока жива исходная строка json'а
+*/
+bool getJsonView(const char *key, _jsonObj_t *jsonObj, _jsonView_t *view)
+{
+	_jsonToken_t *token = xPath(key, jsonObj);
+
+	if(token == (_jsonToken_t*)(0)) {
+		return false;
+	}
+	return jsonTokenView(jsonObj, token, view);
+}
+
+/* получение исходного текста узла json'a по пути (объект или массив целиком, включая скобки)
+ * Для пересылки части документа без копирования и повторной сериализации
+*/
+bool getJsonRaw(const char *key, _jsonObj_t *jsonObj, _jsonView_t *view)
+{
+	_jsonToken_t *token = xPathNode(key, jsonObj);
+
+	if(token == (_jsonToken_t*)(0)) {
+		return false;
+	}
+	return jsonTokenView(jsonObj, token, view);
+}
+
+/* представление токена в виде указателя в исходную строку
+ * для ключей и значений - имя/значение токена (без кавычек)
+ * для объектов и массивов - весь исходный текст узла [start, end)
+*/
+bool jsonTokenView(_jsonObj_t *jsonObj, _jsonToken_t *token, _jsonView_t *view)
+{
+	_jsonOff_t	start, end;
+
+	view->type = token->type;
+	view->valueType = token->valueType;
+	if((token->type == JSON_OBJECT) || (token->type == JSON_ARRAY)) {
+		if(!jsonTokenSpan(jsonObj, token, &start, &end)) {
+			return false;
+		}
+	} else {
+		start = token->start;
+		end = token->end;
+	}
+	view->ptr = jsonObj->json + start;
+	view->len = end - start;
+	return true;
+}
+
+/* индекс токена, следующего за поддеревом token (в массиве токенов поддерево непрерывно)
+ * для корня - кол-во токенов
+*/
+_jsonOff_t jsonSubtreeEnd(_jsonObj_t *jsonObj, _jsonToken_t *token)
+{
+	while(token->nextToken == 0) {
+		if(token == jsonObj->token) {
+			return jsonObj->count;
+		}
+		token = jsonObj->token + token->parent;
+	}
+	return token->nextToken;
+}
+
+/* исходный диапазон байт токена [start, end)
+ * для строковых значений - вместе с кавычками, для объектов и массивов - от открывающей до закрывающей скобки
+ * Закрывающая скобка в токене не хранится: она ищется от конца последнего потомка, между ними
+ * могут быть только пробелы, запятые, комментарии и закрывающие скобки вложенных узлов
+*/
+bool jsonTokenSpan(_jsonObj_t *jsonObj, _jsonToken_t *token, _jsonOff_t *start, _jsonOff_t *end)
+{
+	const char		*str = jsonObj->json;
+	_jsonToken_t	*last = token, *t;
+	_jsonOff_t		pos;
+	int				brackets = 0;
+
+	*start = token->start;
+	if(token->type == JSON_VALUE) {
+		*end = token->end;
+		if(token->valueType == JSON_VALUE_STRING) {
+			(*start)--;
+			(*end)++;
+		}
+		return true;
+	}
+	if(token->type == JSON_KEY) {
+		*end = token->end;
+		return true;
+	}
+
+	// последний потомок и кол-во незакрытых над ним скобок
+	if(jsonSubtreeEnd(jsonObj, token) - 1 > jsonTokenId(jsonObj, token)) {
+		last = jsonObj->token + jsonSubtreeEnd(jsonObj, token) - 1;
+	}
+	for(t=last; ; t=jsonObj->token + t->parent) {
+		if((t->type == JSON_OBJECT) || (t->type == JSON_ARRAY)) {
+			brackets++;
+		}
+		if(t == token) {
+			break;
+		}
+	}
+	pos = last->end;
+	if((last->type != JSON_OBJECT) && (last->type != JSON_ARRAY) && ((str[pos] == '"') || (str[pos] == '\''))) {
+		pos++;
+	}
+
+	while(brackets > 0) {
+		switch(str[pos]) {
+			case ' ': case '\t': case '\r': case '\n': case ',':
+				pos++;
+				break;
+			case '}': case ']':
+				brackets--;
+				pos++;
+				break;
+			case '/':
+				if(str[pos+1] == '/') {
+					pos += 2;
+					while((str[pos] != '\n') && (str[pos] != 0)) {
+						pos++;
+					}
+					break;
+				}
+				if(str[pos+1] == '*') {
+					pos += 2;
+					while((str[pos] != 0) && ((str[pos] != '*') || (str[pos+1] != '/'))) {
+						pos++;
+					}
+					if(str[pos] == 0) {
+						return false;
+					}
+					pos += 2;
+					break;
+				}
+				return false;
+			default:
+				return false;
+		}
+	}
+	*end = pos;
+	return true;
+}
+
 /* получение строкового значение элемента json'a
  * json				cтрока содержащая путь к элементу, значение которого необходимо вернуть в виде СТРОКИ
  * jsonObj			указатель на _jsonObj_t, возвращённый предварительным вызовом jsonParser
@@ -626,8 +1168,26 @@ char* getJsonStr(const char *key, _jsonObj_t *jsonObj)
 */
 long long getJsonInt(const char *key, _jsonObj_t *jsonObj)
 {
-	char		*p = NULL;
-	long long	ret;
+	char				buff[64];
+	char				*p = NULL;
+	long long			ret;
+	_jsonView_t			view;
+	_jsonToken_t		*token = xPath(key, jsonObj);
+	_jsonNum_t			num;
+
+	if((token == (_jsonToken_t*)(0)) || !jsonTokenView(jsonObj, token, &view)) {
+		return 0;
+	}
+	// число - из кеша документа или на стек (см. jsonTokenDecode), строка - как раньше через atoll
+	if(jsonTokenDecode(jsonObj, token, &num)) {
+		return num.i;
+	}
+	if(view.len < (int)sizeof(buff)) {
+		// значение копируется на стек только ради завершающего нуля
+		memcpy(buff, view.ptr, view.len);
+		buff[view.len] = 0;
+		return atoll(buff);
+	}
 	p = (char*)getJsonVal(key, jsonObj);
 	ret = (p == NULL)?0:atoll(p);
 	free(p);
@@ -642,8 +1202,19 @@ long long getJsonInt(const char *key, _jsonObj_t *jsonObj)
 */
 long double getJsonDouble(const char *key, _jsonObj_t *jsonObj)
 {
+	char		buff[64];
 	char		*p = NULL;
 	long double	ret;
+	_jsonView_t	view;
+
+	if(!getJsonView(key, jsonObj, &view)) {
+		return 0;
+	}
+	if(view.len < (int)sizeof(buff)) {
+		memcpy(buff, view.ptr, view.len);
+		buff[view.len] = 0;
+		return strtold(buff, NULL);
+	}
 	p = (char*)getJsonVal(key, jsonObj);
 	ret = (p == NULL)?0:strtold(p, NULL);
 	free(p);
@@ -706,28 +1277,41 @@ void processToken(_jsonObj_t *jsonObj, _jsonToken_t *token, int level, int leftK
 
 	name[token->end - token->start] = 0;
 	snprintf(name, token->end - token->start + 1, "%s", (char*)(jsonObj->json + token->start));
-	printf("id %d pId %d cId %d nId %d name %s type %d valueType %d\n",
-		token->id, token->parent, token->fChild, token->nextToken, name, token->type, token->valueType);
+	printf("id %lld pId %lld cId %lld nId %lld name %s type %d valueType %d\n",
+		(long long)jsonTokenId(jsonObj, token), (long long)token->parent, (long long)jsonTokenFChild(jsonObj, token), (long long)token->nextToken,
+		name, token->type, token->valueType);
 
-	if(token->fChild != 0) {
-		tokenRecursive(jsonObj, jsonObj->token + token->fChild, level+1, ((token->type == JSON_KEY) ? 1 : 0));
+	if(jsonTokenFChild(jsonObj, token) != 0) {
+		tokenRecursive(jsonObj, jsonObj->token + jsonTokenFChild(jsonObj, token), level+1, ((token->type == JSON_KEY) ? 1 : 0));
 	}
 }
 
 
-/* Построение дерева в строку
+/* Построение дерева в строку (контекст потока по умолчанию)
+ * Результат действителен до следующего вызова в этом же потоке
 */
 char* jsonAsString(_jsonObj_t *jsonObj)
 {
-	if(jsonString != NULL) {
-		strfree2(&jsonString);
-	}
-	strinit2(&jsonString, 2048);
+	return jsonAsString_r(jsonObj, jsonDefaultCtx());
+}
 
-	// 4й параметр: уровень, с которого строится дерево
-	// 5й параметр: признак необходимости отрисовки отступа слева
-	tokenRecursive1(jsonObj, jsonObj->token, &jsonString, 0, 0, false);
-	return jsonString->buff;
+/* Построение дерева в строку, реентерабельный вариант
+ * Результат живёт в буфере контекста до следующего вызова с этим контекстом
+*/
+char* jsonAsString_r(_jsonObj_t *jsonObj, _jsonCtx_t *ctx)
+{
+	_jsonWriteOpt_t	opt = {2, ' '};
+	JSON_STATS_START(t);
+	size_t			size = jsonWriteSize(jsonObj, &opt);
+
+	if(ctx->jsonString != NULL) {
+		strfree2(&ctx->jsonString);
+	}
+	// размер известен заранее: один буфер и один проход без дозаписи (см. jsonWrite.c)
+	strinit2(&ctx->jsonString, size + 1);
+	ctx->jsonString->strLen = (int)jsonWriteTo(jsonObj, &opt, ctx->jsonString->buff);
+	JSON_STATS_PHASE(ctx, JSON_STATS_WRITE, t);
+	return ctx->jsonString->buff;
 }
 
 void tokenRecursive1(_jsonObj_t *jsonObj, _jsonToken_t *token, _string2_t **res, int level, int leftKey, bool nextToken)
@@ -769,9 +1353,9 @@ void processToken1(_jsonObj_t *jsonObj, _jsonToken_t *token, _string2_t **res, i
 		strncat2(res, (char*)NULL, 1, '\n');
 	}
 
-	if(token->fChild != 0) {
+	if(jsonTokenFChild(jsonObj, token) != 0) {
 		int level2 = (leftKey == 1) ? level : level + 1;
-		tokenRecursive1(jsonObj, jsonObj->token + token->fChild, res, level2, ((token->type == JSON_KEY) ? 1 : 0), nextToken);
+		tokenRecursive1(jsonObj, jsonObj->token + jsonTokenFChild(jsonObj, token), res, level2, ((token->type == JSON_KEY) ? 1 : 0), nextToken);
 	}
 
 	// отрисовка json'a
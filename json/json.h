@@ -2,11 +2,27 @@
 #define __json_h
 
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdbool.h>
+#include <limits.h>
 
 #include "../string2/string2.h"
 
+/* Смещения в строке json'а и индексы токенов
+ * По умолчанию - 32 бита (документ до 2 Гб). Для многогигабайтных выгрузок: сборка с -DJSON_OFFSET_64
+ * (токен при этом занимает вдвое больше памяти). Библиотека и её клиенты должны собираться с одним значением!
+*/
+#ifdef JSON_OFFSET_64
+typedef long long			_jsonOff_t;
+typedef unsigned long long	_jsonLen_t;
+#define				JSON_OFF_MAX		LLONG_MAX
+#else
+typedef int					_jsonOff_t;
+typedef unsigned int		_jsonLen_t;
+#define				JSON_OFF_MAX		INT_MAX
+#endif
+
 // Описание ошибок
 #define				JSON_ERR_NO_ERROR				(int)	0
 #define				JSON_ERR_OBJ_IN_OBJ				(int)	1
@@ -15,6 +31,13 @@
 #define				JSON_ERR_STRING_WITHOUT_QUOTA	(int)	4
 #define				JSON_ERR_ILLEGAL_SYMBOL			(int)	5
 #define				JSON_ERR_UNEXPECTED_SYMBOL		(int)	6
+#define				JSON_ERR_NO_MEMORY				(int)	7
+#define				JSON_ERR_FILE					(int)	8
+#define				JSON_ERR_OUTPUT					(int)	9
+#define				JSON_ERR_SNAPSHOT				(int)	10
+#define				JSON_ERR_BIND_TYPE				(int)	11
+#define				JSON_ERR_BIND_MISSING			(int)	12
+#define				JSON_ERR_BIND_OVERFLOW			(int)	13
 
 // типы кавычек
 typedef enum {
@@ -41,18 +64,37 @@ typedef enum {
 } _jsonValueType_t;
 
 // элементы (узлы) разбираемого json'a
+#ifdef JSON_COMPACT_TOKENS
+/* Компактный токен (сборка с -DJSON_COMPACT_TOKENS): 20 байт вместо 32
+ * id - это индекс в массиве (jsonTokenId), первый потомок всегда следует сразу за родителем (jsonTokenFChild),
+ * lChild нужен только при разборе. Типы упакованы в биты
+ * Поля id, fChild, lChild в этом режиме недоступны: только через jsonTokenId/jsonTokenFChild
+*/
+typedef struct
+{
+	_jsonOff_t			start;			// начало наименования токена
+	_jsonOff_t			end;			// конец наименования токена
+	_jsonOff_t			parent;			// индекс родителя
+	_jsonOff_t			nextToken;		// следующий по порядку токен этого же уровня
+	_jsonType_t			type : 4;		// тип токена
+	_jsonValueType_t	valueType : 4;	// тип значения (только для type == JSON_VALUE!)
+	unsigned int		escaped : 1;	// в строке есть escape-последовательности (см. jsonTokenString)
+} _jsonToken_t;
+#else
 typedef struct
 {
-	int					id;				// ID токена, используется для отладки и отрисовки деревьев
-	int					start;			// начало наименования токена
-	int					end;			// конец наименования токена
-	int					parent;			// индекс родителя
-	int					fChild;			// индекс первого дочернего узла
-	int					lChild;			// индекс последнего дочернего узла
-	int					nextToken;		// следующий по порядку токен этого же уровня
-	_jsonType_t			type;			// тип токена
-	_jsonValueType_t	valueType;		// тип значения (только для type == JSON_VALUE!)
+	_jsonOff_t			id;				// ID токена, используется для отладки и отрисовки деревьев
+	_jsonOff_t			start;			// начало наименования токена
+	_jsonOff_t			end;			// конец наименования токена
+	_jsonOff_t			parent;			// индекс родителя
+	_jsonOff_t			fChild;			// индекс первого дочернего узла
+	_jsonOff_t			lChild;			// индекс последнего дочернего узла
+	_jsonOff_t			nextToken;		// следующий по порядку токен этого же уровня
+	_jsonType_t			type : 8;		// тип токена
+	_jsonValueType_t	valueType : 8;	// тип значения (только для type == JSON_VALUE!)
+	unsigned int		escaped : 1;	// в строке есть escape-последовательности (см. jsonTokenString)
 } _jsonToken_t;
+#endif
 
 // описание ошибки
 typedef struct
@@ -63,31 +105,529 @@ typedef struct
 	const char		*message;
 } _jsonErr_t;
 
+// арена: память из буфера клиента, выделение сдвигом, освобождение всего разом (jsonArenaReset)
+typedef struct
+{
+	char			*buff;
+	size_t			size;
+	size_t			used;
+	size_t			last;			// смещение последнего выделенного блока (его можно расширить на месте)
+} _jsonArena_t;
+
+// значение без копирования: указатель в исходную строку json'а (НЕ завершается нулём)
+typedef struct
+{
+	const char			*ptr;
+	_jsonOff_t			len;
+	_jsonType_t			type;
+	_jsonValueType_t	valueType;
+} _jsonView_t;
+
+// индекс дочерних узлов (см. jsonBuildIndex)
+typedef struct
+{
+	_jsonOff_t		*table;			// для каждого токена: смещение его таблицы в data (-1 - таблицы нет)
+	_jsonOff_t		*size;			// массив - кол-во элементов, объект - размер хэш-таблицы
+	_jsonOff_t		*data;			// id элементов массивов / хэш-таблицы id ключей объектов
+} _jsonIndex_t;
+
+// декодированное число (см. jsonTokenNumber)
+typedef struct
+{
+	long long		i;				// целая часть (при переполнении - LLONG_MAX/LLONG_MIN, как у atoll)
+	double			d;				// значение, корректно округлённое до double
+	int				flags;			// JSON_NUM_*
+} _jsonNum_t;
+
+#define				JSON_NUM_DECODED				(int)	1		// значение декодировано
+#define				JSON_NUM_INT_OVERFLOW			(int)	2		// целая часть не помещается в long long
+#define				JSON_NUM_PRECISION_LOSS			(int)	4		// значащих цифр больше, чем точно хранит double
+
+// параметры сериализации (см. jsonWrite)
+typedef struct
+{
+	int				indent;			// отступ на уровень вложенности (0 - компактный вывод в одну строку)
+	char			indentChar;		// символ отступа (0 - пробел)
+} _jsonWriteOpt_t;
+
+// операции скомпилированного пути (см. jsonPathCompile)
+typedef enum {
+	JSON_PATH_KEY = 1,				// ключ объекта
+	JSON_PATH_INDEX = 2,			// элемент массива по номеру
+	JSON_PATH_ANY_KEY = 3,			// все значения объекта (*)
+	JSON_PATH_ANY_INDEX = 4			// все элементы массива ([*])
+} _jsonPathOp_t;
+
+typedef struct
+{
+	_jsonPathOp_t	op;
+	int				key;			// смещение имени ключа в _jsonPath_t.keys
+	int				len;			// длина имени ключа / номер элемента массива
+} _jsonPathStep_t;
+
+// скомпилированный путь
+typedef struct
+{
+	_jsonPathStep_t	*step;
+	char			*keys;			// имена ключей всех шагов
+	int				count;			// кол-во шагов
+} _jsonPath_t;
+
+// операции правки документа (см. jsonEditSet)
+#define				JSON_EDIT_SET			(int)	1		// замена узла текстом
+#define				JSON_EDIT_INSERT		(int)	2		// новый ключ объекта
+#define				JSON_EDIT_APPEND		(int)	3		// новый элемент массива
+#define				JSON_EDIT_REMOVE		(int)	4		// удаление ключа/элемента
+
+typedef struct
+{
+	int				op;				// JSON_EDIT_*
+	_jsonOff_t		token;			// заменяемый узел, контейнер (вставка) или удаляемый ключ/элемент
+	size_t			key;			// имя нового ключа: смещение в _jsonEdit_t.pool
+	size_t			keyLen;
+	size_t			text;			// текст json'а значения: смещение в _jsonEdit_t.pool
+	size_t			len;
+} _jsonEditOp_t;
+
+// правки поверх массива токенов (см. jsonEditSet): сам json и токены не меняются
+typedef struct
+{
+	_jsonEditOp_t	*op;			// правки в порядке внесения
+	int				count;
+	int				capacity;
+	char			*pool;			// тексты правок
+	size_t			poolSize;
+	size_t			poolUsed;
+} _jsonEdit_t;
+
+/* обработчики событий разбора без дерева токенов (см. jsonParseSax)
+ * Любой обработчик может быть NULL. false из обработчика - остановить разбор
+ * pos - позиция скобки в json'е, token - ключ/значение: start/end, valueType, escaped (см. jsonTokenString/jsonUnescape)
+*/
+typedef struct
+{
+	void			*arg;
+	bool			(*objectStart)(void *arg, _jsonOff_t pos);
+	bool			(*objectEnd)(void *arg, _jsonOff_t pos);
+	bool			(*arrayStart)(void *arg, _jsonOff_t pos);
+	bool			(*arrayEnd)(void *arg, _jsonOff_t pos);
+	bool			(*key)(void *arg, const char *json, const _jsonToken_t *token);
+	bool			(*value)(void *arg, const char *json, const _jsonToken_t *token);
+} _jsonSax_t;
+
 // json-объект
 typedef struct
 {
 	const char		*json;			// исходный json
+	_jsonLen_t		len;			// его длина: при разборе с явной длиной (jsonParseBatch...) нуля в конце может не быть
 	_jsonToken_t	*token;
-	int				count;
+	_jsonOff_t		count;
 	int				nesting;
+	_jsonOff_t		capacity;		// размер распределённого массива токенов
+	_jsonArena_t	*arena;			// источник памяти (NULL - malloc)
+	_jsonIndex_t	*index;			// индекс дочерних узлов (NULL - не построен)
+	_jsonNum_t		*num;			// декодированные числа по id токена (NULL - не распределены)
+	char			*own;			// буфер json'а, принадлежащий документу (освобождается вместе с ним)
+	void			*map;			// отображённый в память файл (см. jsonParseFile)
+	size_t			mapSize;
+	const _jsonSax_t	*sax;		// разбор событиями: токены не накапливаются (см. jsonParseSax)
+	_jsonOff_t		saxPending;		// токен, событие которого ещё не отправлено (-1 - нет)
+	bool			saxStop;		// обработчик остановил разбор
+	_jsonEdit_t		*edit;			// правки (NULL - документ не менялся), см. jsonEditSet
+	bool			shared;			// документ общий для потоков (jsonCacheGet): индекс лениво не строится
 } _jsonObj_t;
 
-int					jsonParser(char *str, _jsonObj_t **jsonObj, unsigned int jsonLen);
-_jsonToken_t*		assignNewToken(_jsonObj_t **jsonObj, int *expectTokenCount, int pos, int parent);
+// индекс токена в массиве
+static inline _jsonOff_t jsonTokenId(_jsonObj_t *jsonObj, _jsonToken_t *token)
+{
+	return token - jsonObj->token;
+}
+
+// токены лежат в отображённом файле снимка (только чтение, см. jsonSnapshotLoad)
+static inline bool jsonTokensMapped(_jsonObj_t *jsonObj)
+{
+	return (jsonObj->map != NULL) && ((char*)jsonObj->token >= (char*)jsonObj->map) &&
+		((char*)jsonObj->token < (char*)jsonObj->map + jsonObj->mapSize);
+}
+
+// индекс первого дочернего узла (0 - нет потомков)
+static inline _jsonOff_t jsonTokenFChild(_jsonObj_t *jsonObj, _jsonToken_t *token)
+{
+#ifdef JSON_COMPACT_TOKENS
+	_jsonOff_t	id = token - jsonObj->token;
+
+	return ((id + 1 < jsonObj->count) && ((token + 1)->parent == id)) ? id + 1 : 0;
+#else
+	(void)jsonObj;
+	return token->fChild;
+#endif
+}
+
+// курсор: позиция в разобранном документе (см. jsonCursorInit)
+typedef struct
+{
+	_jsonObj_t		*obj;
+	_jsonOff_t		id;				// индекс текущего токена
+} _jsonCursor_t;
+
+// состояние разбора между вызовами jsonParseRun (разбор по частям)
+typedef struct
+{
+	_jsonLen_t			i;					// следующий необработанный символ
+	int					level;
+	int					maxNesting;
+	int					line;
+	int					col;
+	_jsonOff_t			token;				// индекс текущего токена
+	bool				inQuotes;
+	bool				start;
+	char				lastControlSymbol;
+	_jsonQuota_t		quotaType;
+	_jsonLen_t			waitPos;			// символ, на котором разбор ждёт данных
+	_jsonLen_t			waitScan;			// докуда для него уже искали конец комментария/значения
+	_jsonLen_t			commentBytes;		// байт в законченных комментариях (статистика jsonDocParse)
+} _jsonParseState_t;
+
+#define				JSON_PARSE_MORE			(int)	2
+#define				JSON_PARSE_STOP			(int)	3		// разбор остановлен обработчиком события (см. jsonParseSax)
+
+/* Статистика разбора и поиска (сборка с -DJSON_STATS, см. jsonStats.c)
+ * Без JSON_STATS счётчики в контексте отсутствуют, а вызовы сбора раскрываются в ничто.
+ * Библиотека и её клиенты должны собираться с одним значением!
+*/
+#define				JSON_STATS_ALLOC		(int)	0		// фаза: подготовка массива токенов (jsonParseBegin)
+#define				JSON_STATS_PARSE		(int)	1		// фаза: разбор (jsonParseRun из jsonDocParse)
+#define				JSON_STATS_INDEX		(int)	2		// фаза: построение индекса (jsonBuildIndex_r)
+#define				JSON_STATS_LOOKUP		(int)	3		// фаза: поиск по пути (xPathNode_r и всё, что через него)
+#define				JSON_STATS_WRITE		(int)	4		// фаза: сериализация (jsonWrite_r, jsonAsString_r)
+#define				JSON_STATS_PHASES		(int)	5
+#define				JSON_STATS_BUCKETS		(int)	40		// гистограммы: корзина n - от 2^(n-1) до 2^n тактов
+
+typedef struct
+{
+	unsigned long long	parses;						// успешных разборов jsonDocParse (jsonParser...)
+	unsigned long long	errors;						// ошибок (setError)
+	unsigned long long	bytes;						// байт json'а в успешных разборах
+	unsigned long long	tokens;						// токенов в них
+	unsigned long long	tokensExpected;				// начальная оценка кол-ва токенов (len >> 4)
+	unsigned long long	reallocs;					// расширений массива токенов (assignNewToken)
+	unsigned long long	parentReallocs;				// расширений стека родителей
+	unsigned long long	commentBytes;				// байт в комментариях
+	int					maxNesting;					// наибольшая вложенность (глубина стека родителей)
+	unsigned long long	cycles[JSON_STATS_PHASES];	// такты по фазам (TSC на x86, иначе нс)
+	unsigned long long	calls[JSON_STATS_PHASES];	// вызовов по фазам
+	unsigned long long	lookupHist[JSON_STATS_BUCKETS];	// задержки поиска по пути, log2 тактов
+	unsigned long long	writeHist[JSON_STATS_BUCKETS];	// задержки сериализации, log2 тактов
+} _jsonStats_t;
+
+// контекст парсера/сериализатора (см. jsonCtxInit)
+typedef struct
+{
+	_jsonErr_t		error;			// последняя ошибка
+	char			cErr[256];		// буфер текста последней ошибки
+	_jsonOff_t		*parent;		// стек индексов родительских токенов
+	int				parentCount;	// размер стека
+	_string2_t		*jsonString;	// выходной буфер jsonAsString_r
+#ifdef JSON_STATS
+	_jsonStats_t	stats;			// статистика (jsonStats_r)
+#endif
+} _jsonCtx_t;
+
+void				jsonCtxInit(_jsonCtx_t *ctx);
+void				jsonCtxFree(_jsonCtx_t *ctx);
+_jsonCtx_t*			jsonDefaultCtx();
+
+const _jsonStats_t*	jsonStats();
+const _jsonStats_t*	jsonStats_r(_jsonCtx_t *ctx);
+void				jsonStatsReset();
+void				jsonStatsReset_r(_jsonCtx_t *ctx);
+
+/* сбор статистики внутри библиотеки
+ * JSON_STATS_START(t)				объявляет отметку времени t
+ * JSON_STATS_PHASE(ctx, phase, t)	добавляет время от t к фазе, t - новая отметка
+ * JSON_STATS_ADD(ctx, field, n)	счётчик
+*/
+#ifdef JSON_STATS
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+
+static inline unsigned long long jsonStatsClock()
+{
+	return __rdtsc();
+}
+#else
+#include <time.h>
+
+static inline unsigned long long jsonStatsClock()
+{
+	struct timespec		ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif
+
+unsigned long long	jsonStatsPhase(_jsonCtx_t *ctx, int phase, unsigned long long start);
+void				jsonStatsParse(_jsonCtx_t *ctx, _jsonObj_t *doc, const _jsonParseState_t *st, _jsonLen_t len, _jsonOff_t expect, _jsonOff_t capacity, int res);
+
+#define				JSON_STATS_START(t)				unsigned long long t = jsonStatsClock()
+#define				JSON_STATS_PHASE(ctx, phase, t)	t = jsonStatsPhase((ctx), (phase), (t))
+#define				JSON_STATS_ADD(ctx, field, n)	(ctx)->stats.field += (n)
+#else
+#define				JSON_STATS_START(t)
+#define				JSON_STATS_PHASE(ctx, phase, t)	(void)(ctx)
+#define				JSON_STATS_ADD(ctx, field, n)
+#endif
+
+int					jsonParser(char *str, _jsonObj_t **jsonObj, _jsonLen_t jsonLen);
+int					jsonParser_r(char *str, _jsonObj_t **jsonObj, _jsonLen_t jsonLen, _jsonCtx_t *ctx);
+int					jsonParseFile(const char *fileName, _jsonObj_t **jsonObj);
+int					jsonParseFile_r(const char *fileName, _jsonObj_t **jsonObj, _jsonCtx_t *ctx);
+int					jsonParseSax(const char *str, _jsonLen_t len, const _jsonSax_t *sax);
+int					jsonParseSax_r(const char *str, _jsonLen_t len, const _jsonSax_t *sax, _jsonCtx_t *ctx);
+int					jsonValidate(const char *str, _jsonLen_t len);
+int					jsonValidate_r(const char *str, _jsonLen_t len, _jsonCtx_t *ctx);
+_jsonToken_t*		assignNewToken(_jsonObj_t **jsonObj, _jsonOff_t pos, _jsonOff_t parent);
 void				clearFlatJsonObj(_jsonObj_t **jsonObj);
+
+void				jsonDocInit(_jsonObj_t *doc, _jsonArena_t *arena);
+int					jsonDocParse(_jsonObj_t *doc, char *str, _jsonLen_t jsonLen, _jsonCtx_t *ctx);
+void				jsonDocFree(_jsonObj_t *doc);
+int					jsonParseBegin(_jsonObj_t *doc, _jsonParseState_t *st, const char *str, _jsonOff_t expectTokenCount, _jsonCtx_t *ctx);
+int					jsonParseRun(_jsonObj_t *doc, _jsonParseState_t *st, const char *str, _jsonLen_t len, bool final, _jsonCtx_t *ctx);
+void*				jsonObjAlloc(_jsonObj_t *jsonObj, size_t size);
+void*				jsonObjRealloc(_jsonObj_t *jsonObj, void *p, size_t oldSize, size_t size);
+void				jsonObjFree(_jsonObj_t *jsonObj, void *p);
+_jsonToken_t*		jsonSaxToken(_jsonObj_t *doc, _jsonOff_t pos, _jsonOff_t parent);
+bool				jsonSaxFlush(_jsonObj_t *doc);
+bool				jsonSaxClose(_jsonObj_t *doc, _jsonType_t type, _jsonOff_t pos);
+bool				jsonQuickCheck(const char *str, _jsonLen_t len);
+
+bool				jsonBuildIndex(_jsonObj_t *jsonObj);
+bool				jsonBuildIndex_r(_jsonObj_t *jsonObj, _jsonCtx_t *ctx);
+void				jsonFreeIndex(_jsonObj_t *jsonObj);
+_jsonToken_t*		jsonFindKey(_jsonObj_t *jsonObj, _jsonToken_t *object, const char *key, _jsonLen_t keyLen);
+_jsonToken_t*		jsonArrayAt(_jsonObj_t *jsonObj, _jsonToken_t *array, _jsonOff_t n);
+_jsonOff_t			jsonChildCount(_jsonObj_t *jsonObj, _jsonToken_t *token);
+_jsonToken_t*		jsonIndexKey(_jsonObj_t *jsonObj, _jsonToken_t *object, const char *key, _jsonLen_t keyLen);
+_jsonToken_t*		jsonIndexAt(_jsonObj_t *jsonObj, _jsonToken_t *array, _jsonOff_t n);
+
+const _jsonNum_t*	jsonTokenNumber(_jsonObj_t *jsonObj, _jsonToken_t *token);
+bool				jsonDecodeNumbers(_jsonObj_t *jsonObj);
+void				jsonFreeNumbers(_jsonObj_t *jsonObj);
+bool				getJsonNumber(const char *key, _jsonObj_t *jsonObj, _jsonNum_t *num);
+void				jsonNumberDecode(const char *str, _jsonOff_t len, _jsonNum_t *num);
+bool				jsonTokenDecode(_jsonObj_t *jsonObj, _jsonToken_t *token, _jsonNum_t *num);
+
+_jsonOff_t			jsonUnescape(const char *src, _jsonOff_t len, char *dst);
+_jsonOff_t			jsonTokenString(_jsonObj_t *jsonObj, _jsonToken_t *token, char *buff, _jsonOff_t size);
+bool				jsonTokenText(_jsonObj_t *jsonObj, _jsonToken_t *token, _jsonArena_t *arena, _jsonView_t *view);
+
+size_t				jsonWriteSize(_jsonObj_t *jsonObj, const _jsonWriteOpt_t *opt);
+size_t				jsonWriteTo(_jsonObj_t *jsonObj, const _jsonWriteOpt_t *opt, char *buff);
+char*				jsonWrite(_jsonObj_t *jsonObj, const _jsonWriteOpt_t *opt, size_t *len);
+char*				jsonWrite_r(_jsonObj_t *jsonObj, const _jsonWriteOpt_t *opt, size_t *len, _jsonCtx_t *ctx);
+
+bool				jsonEditSet(_jsonObj_t *jsonObj, _jsonToken_t *token, const char *text, size_t len);
+bool				jsonEditSetString(_jsonObj_t *jsonObj, _jsonToken_t *token, const char *str, size_t len);
+bool				jsonEditSetInt(_jsonObj_t *jsonObj, _jsonToken_t *token, long long value);
+bool				jsonEditInsert(_jsonObj_t *jsonObj, _jsonToken_t *object, const char *key, size_t keyLen, const char *text, size_t len);
+bool				jsonEditAppend(_jsonObj_t *jsonObj, _jsonToken_t *array, const char *text, size_t len);
+bool				jsonEditRemove(_jsonObj_t *jsonObj, _jsonToken_t *token);
+void				jsonEditFree(_jsonObj_t *jsonObj);
+size_t				jsonEditWriteSize(_jsonObj_t *jsonObj);
+size_t				jsonEditWriteTo(_jsonObj_t *jsonObj, char *buff);
+char*				jsonEditWrite(_jsonObj_t *jsonObj, size_t *len);
+
+int					jsonReparse(_jsonObj_t *doc, _jsonOff_t offset, _jsonLen_t removedLen, const char *text, _jsonLen_t textLen);
+int					jsonReparse_r(_jsonObj_t *doc, _jsonOff_t offset, _jsonLen_t removedLen, const char *text, _jsonLen_t textLen, _jsonCtx_t *ctx);
+
+int					jsonSnapshotSave(_jsonObj_t *jsonObj, const char *fileName);
+int					jsonSnapshotSave_r(_jsonObj_t *jsonObj, const char *fileName, _jsonCtx_t *ctx);
+int					jsonSnapshotLoad(const char *fileName, _jsonObj_t **jsonObj);
+int					jsonSnapshotLoad_r(const char *fileName, _jsonObj_t **jsonObj, _jsonCtx_t *ctx);
+unsigned long long	jsonHash64(const void *data, size_t len, unsigned long long seed);
+
+_jsonPath_t*		jsonPathCompile(const char *path);
+void				jsonPathFree(_jsonPath_t *path);
+int					jsonPathExec(_jsonPath_t *path, _jsonObj_t *jsonObj, _jsonToken_t **res, int maxRes);
+_jsonToken_t*		jsonPathFirst(_jsonPath_t *path, _jsonObj_t *jsonObj);
+int					jsonExtract(const char *str, _jsonLen_t len, _jsonPath_t **paths, int count, _jsonView_t *res);
+int					jsonExtract_r(const char *str, _jsonLen_t len, _jsonPath_t **paths, int count, _jsonView_t *res, _jsonCtx_t *ctx);
+
+void				jsonCursorInit(_jsonCursor_t *cursor, _jsonObj_t *jsonObj);
+_jsonToken_t*		jsonCursorToken(_jsonCursor_t *cursor);
+bool				jsonCursorChild(_jsonCursor_t *cursor);
+bool				jsonCursorNext(_jsonCursor_t *cursor);
+bool				jsonCursorParent(_jsonCursor_t *cursor);
+bool				jsonCursorKey(_jsonCursor_t *cursor, const char *key, _jsonLen_t keyLen);
+bool				jsonCursorAt(_jsonCursor_t *cursor, _jsonOff_t n);
+bool				jsonCursorView(_jsonCursor_t *cursor, _jsonView_t *view);
+long long			jsonCursorInt(_jsonCursor_t *cursor);
+long double			jsonCursorDouble(_jsonCursor_t *cursor);
+
+// разбор по частям (см. jsonStreamInit)
+typedef struct
+{
+	_jsonCtx_t			ctx;
+	_jsonParseState_t	state;
+	_jsonObj_t			*doc;
+	_string2_t			*buff;			// накопленные данные
+	int					res;			// результат последнего шага разбора
+} _jsonStream_t;
+
+_jsonStream_t*		jsonStreamInit();
+int					jsonStreamFeed(_jsonStream_t *stream, const char *chunk, _jsonLen_t len);
+int					jsonStreamFinish(_jsonStream_t *stream, _jsonObj_t **jsonObj);
+_jsonErr_t*			jsonStreamError(_jsonStream_t *stream);
+void				jsonStreamFree(_jsonStream_t **stream);
+
+// документ пакета (см. jsonParseBatch)
+typedef struct
+{
+	_jsonObj_t			*obj;			// NULL - ошибка разбора
+	int					res;			// 0 - успех, 1 - ошибка
+	_jsonErr_t			error;			// строка/столбец - внутри документа
+	char				cErr[64];
+	_jsonLen_t			start;			// документ в исходной строке
+	_jsonLen_t			len;
+} _jsonBatchDoc_t;
+
+int					jsonBatchSplit(const char *str, _jsonLen_t len, _jsonBatchDoc_t **docs);
+int					jsonParseBatch(char *str, _jsonLen_t len, int threads, _jsonBatchDoc_t **docs);
+void				jsonBatchFree(_jsonBatchDoc_t **docs, int count);
+
+// кэш разобранных документов по содержимому (см. jsonCacheInit), устройство - в jsonCache.c
+typedef struct _jsonCache_s _jsonCache_t;
+
+#define				JSON_CACHE_LRU			(int)	0		// вытеснение давно не запрошенных
+#define				JSON_CACHE_CLOCK		(int)	1		// вытеснение "часами" (второй шанс)
+#define				JSON_CACHE_INDEX		(int)	2		// строить индекс ключей документов (jsonBuildIndex)
+
+// счётчики кэша (см. jsonCacheStats)
+typedef struct
+{
+	unsigned long long	hits;
+	unsigned long long	misses;			// в т.ч. ошибочные json'ы
+	unsigned long long	evictions;
+	size_t				entries;		// документов в кэше
+	size_t				bytes;			// их учтённый объём
+} _jsonCacheStats_t;
+
+_jsonCache_t*		jsonCacheInit(size_t maxBytes, int flags);
+_jsonObj_t*			jsonCacheGet(_jsonCache_t *cache, const char *str, _jsonLen_t len);
+_jsonObj_t*			jsonCacheGet_r(_jsonCache_t *cache, const char *str, _jsonLen_t len, _jsonCtx_t *ctx);
+void				jsonCacheRelease(_jsonCache_t *cache, _jsonObj_t *doc);
+void				jsonCacheStats(_jsonCache_t *cache, _jsonCacheStats_t *stats);
+void				jsonCacheClear(_jsonCache_t *cache);
+void				jsonCacheFree(_jsonCache_t **cache);
+
+// привязка объекта json'а к структуре C по таблице полей (см. jsonBind)
+#define				JSON_BIND_STRING		(int)	1		// char[N]: строка, escape-последовательности декодируются
+#define				JSON_BIND_VIEW			(int)	2		// _jsonView_t: любой скаляр без копирования
+#define				JSON_BIND_INT			(int)	3		// целое со знаком 1, 2, 4 или 8 байт: только JSON_VALUE_INT
+#define				JSON_BIND_DOUBLE		(int)	4		// float, double, long double: JSON_VALUE_INT или FLOAT
+#define				JSON_BIND_BOOL			(int)	5		// bool
+#define				JSON_BIND_OBJECT		(int)	6		// вложенная структура (своя таблица полей)
+#define				JSON_BIND_ARRAY			(int)	7		// массив объектов в поле T[N] + счётчик int
+
+#define				JSON_BIND_REQUIRED		(int)	1		// флаг поля: отсутствие (или null) - ошибка
+#define				JSON_BIND_MAX_FIELDS	(int)	64		// полей в одной таблице
+
+// поле структуры: таблица полей заканчивается JSON_BIND_END
+typedef struct _jsonBind_s
+{
+	const char					*key;			// имя ключа в объекте
+	int							type;			// JSON_BIND_*
+	int							flags;			// JSON_BIND_REQUIRED
+	size_t						offset;			// смещение поля в структуре
+	size_t						size;			// размер поля (у массива - размер элемента)
+	const struct _jsonBind_s	*sub;			// таблица полей вложенной структуры/элемента массива
+	size_t						countOffset;	// массив: смещение счётчика (int)
+	int							max;			// массив: ёмкость
+} _jsonBind_t;
+
+#define				JSON_BIND(st, field, key, type, flags) \
+	{key, type, flags, offsetof(st, field), sizeof(((st*)0)->field), NULL, 0, 0}
+#define				JSON_BIND_STRUCT(st, field, key, sub, flags) \
+	{key, JSON_BIND_OBJECT, flags, offsetof(st, field), sizeof(((st*)0)->field), sub, 0, 0}
+#define				JSON_BIND_LIST(st, field, count, key, sub, flags) \
+	{key, JSON_BIND_ARRAY, flags, offsetof(st, field), sizeof(((st*)0)->field[0]), sub, offsetof(st, count), \
+		(int)(sizeof(((st*)0)->field) / sizeof(((st*)0)->field[0]))}
+#define				JSON_BIND_END			{NULL, 0, 0, 0, 0, NULL, 0, 0}
+
+int					jsonBind(_jsonObj_t *jsonObj, const char *path, const _jsonBind_t *bind, void *out);
+int					jsonBind_r(_jsonObj_t *jsonObj, const char *path, const _jsonBind_t *bind, void *out, _jsonCtx_t *ctx);
+
+// приёмник выходных данных: 0 - данные приняты, иначе - ошибка (см. jsonTranscodeInit)
+typedef int (*_jsonSink_t)(void *arg, const char *buff, size_t len);
+
+#define				JSON_TRANSCODE_BUFF		(int)	65536	// выходной буфер
+#define				JSON_TRANSCODE_HOLD		(int)	256		// отступ, отложенный до следующего элемента
+#define				JSON_TRANSCODE_NESTING	(int)	4096	// максимальная вложенность
+
+// преобразование "грязного" json'а в строгий по частям (см. jsonTranscodeInit)
+typedef struct
+{
+	_jsonCtx_t			ctx;
+	_jsonSink_t			sink;
+	void				*arg;
+	int					res;			// 0 - успех, 1 - ошибка (json или приёмника)
+	int					mode;			// где находимся: строка, комментарий, слово без кавычек...
+	char				quote;			// кавычка открытой строки
+	int					num;			// состояние числа
+	const char			*lit;			// ожидаемый литерал (true, false, null) и сколько его уже прошли
+	int					litPos;
+	int					hex;			// сколько цифр \uXXXX осталось
+	int					level;
+	unsigned long long	obj[JSON_TRANSCODE_NESTING / 64];	// стек контейнеров: бит - объект
+	bool				key;			// текущий элемент - ключ
+	bool				afterKey;		// ключ закончен, ждём ':'
+	bool				afterColon;		// в объекте ждём значение, а не ключ
+	bool				comma;			// после элемента уже была запятая
+	bool				hold;			// элемент закончен: запятая и отступ откладываются до следующего
+	int					holdLen;
+	char				holdBuff[JSON_TRANSCODE_HOLD];
+	int					line;
+	unsigned long long	offset;			// смещение текущей порции во входных данных
+	unsigned long long	lineStart;
+	size_t				outLen;
+	char				out[JSON_TRANSCODE_BUFF];
+} _jsonTranscode_t;
+
+_jsonTranscode_t*	jsonTranscodeInit(_jsonSink_t sink, void *arg);
+int					jsonTranscodeFeed(_jsonTranscode_t *tc, const char *chunk, _jsonLen_t len);
+int					jsonTranscodeFinish(_jsonTranscode_t *tc);
+_jsonErr_t*			jsonTranscodeError(_jsonTranscode_t *tc);
+void				jsonTranscodeFree(_jsonTranscode_t **tc);
+char*				jsonToStrict(const char *str, _jsonLen_t len, size_t *outLen);
+
+void				jsonArenaInit(_jsonArena_t *arena, void *buff, size_t size);
+void*				jsonArenaAlloc(_jsonArena_t *arena, size_t size);
+void*				jsonArenaRealloc(_jsonArena_t *arena, void *p, size_t oldSize, size_t size);
+void				jsonArenaReset(_jsonArena_t *arena);
 _jsonToken_t*		xPath(const char *path, _jsonObj_t *jsonObj);
+_jsonToken_t*		xPathNode(const char *path, _jsonObj_t *jsonObj);
+_jsonToken_t*		xPathNode_r(const char *path, _jsonObj_t *jsonObj, _jsonCtx_t *ctx);
 char*				getJsonStr(const char *key, _jsonObj_t *jsonObj);
 long long			getJsonInt(const char *key, _jsonObj_t *jsonObj);
 long double			getJsonDouble(const char *key, _jsonObj_t *jsonObj);
+bool				getJsonView(const char *key, _jsonObj_t *jsonObj, _jsonView_t *view);
+bool				getJsonRaw(const char *key, _jsonObj_t *jsonObj, _jsonView_t *view);
+bool				jsonTokenView(_jsonObj_t *jsonObj, _jsonToken_t *token, _jsonView_t *view);
+_jsonOff_t			jsonSubtreeEnd(_jsonObj_t *jsonObj, _jsonToken_t *token);
+bool				jsonTokenSpan(_jsonObj_t *jsonObj, _jsonToken_t *token, _jsonOff_t *start, _jsonOff_t *end);
 
 void jsonFormat(_jsonObj_t *jsonObj);
-void setError(int line, int col, char ch, int errNum, int **parent);
+void setError(_jsonCtx_t *ctx, int line, int col, char ch, int errNum);
 _jsonErr_t* getLastError();
+_jsonErr_t* getLastError_r(_jsonCtx_t *ctx);
 
 void tokenRecursive(_jsonObj_t *jsonObj, _jsonToken_t *token, int level, int leftKey);
 void processToken(_jsonObj_t *jsonObj, _jsonToken_t *token, int level, int leftKey);
 
 char* jsonAsString(_jsonObj_t *jsonObj);
+char* jsonAsString_r(_jsonObj_t *jsonObj, _jsonCtx_t *ctx);
 void processToken1(_jsonObj_t *jsonObj, _jsonToken_t *token, _string2_t **res, int level, int leftKey, bool nextToken);
 void tokenRecursive1(_jsonObj_t *jsonObj, _jsonToken_t *token, _string2_t **res, int level, int leftKey, bool nextToken);
 
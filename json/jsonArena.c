@@ -0,0 +1,68 @@
+/* arena allocator for dirty json parser
+ * Avinfors, O.Nikitin
+ *
+ * Упоротость и отвага!
+*/
+
+/* Арена - буфер клиента, из которого память выдаётся сдвигом указателя.
+ * Отдельные блоки не освобождаются, вся арена освобождается за O(1) вызовом jsonArenaReset.
+ * Последний выданный блок можно расширить на месте (так растёт массив токенов при разборе)
+*/
+
+#include "json.h"
+
+#define				JSON_ARENA_ALIGN		(size_t)	16
+
+void jsonArenaInit(_jsonArena_t *arena, void *buff, size_t size)
+{
+	arena->buff = (char*)buff;
+	arena->size = size;
+	arena->used = 0;
+	arena->last = 0;
+}
+
+/* выделение блока
+ * return:			указатель на блок или NULL, если в арене нет места
+*/
+void* jsonArenaAlloc(_jsonArena_t *arena, size_t size)
+{
+	size_t		offset = (arena->used + JSON_ARENA_ALIGN - 1) & ~(JSON_ARENA_ALIGN - 1);
+
+	if((offset > arena->size) || (size > arena->size - offset)) {
+		return NULL;
+	}
+	arena->last = offset;
+	arena->used = offset + size;
+	return arena->buff + offset;
+}
+
+/* изменение размера блока
+ * последний блок арены расширяется на месте, иначе - копируется в новый
+*/
+void* jsonArenaRealloc(_jsonArena_t *arena, void *p, size_t oldSize, size_t size)
+{
+	void		*res;
+
+	if(p == NULL) {
+		return jsonArenaAlloc(arena, size);
+	}
+	if((char*)p == arena->buff + arena->last) {
+		if(size <= arena->size - arena->last) {
+			arena->used = arena->last + size;
+			return p;
+		}
+		return NULL;
+	}
+	res = jsonArenaAlloc(arena, size);
+	if(res != NULL) {
+		memcpy(res, p, (oldSize < size) ? oldSize : size);
+	}
+	return res;
+}
+
+// освобождение всей памяти арены
+void jsonArenaReset(_jsonArena_t *arena)
+{
+	arena->used = 0;
+	arena->last = 0;
+}
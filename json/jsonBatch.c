@@ -0,0 +1,216 @@
+/* batch (NDJSON / concatenated) parsing for dirty json parser
+ * Avinfors, O.Nikitin
+ *
+ * Упоротость и отвага!
+*/
+
+/* Разбор потока из многих json-документов (по одному на строку или просто подряд)
+ * 1. Границы документов ищутся одним быстрым проходом по структурному индексу: учитываются только
+ *    скобки вне строк и комментариев (правила кавычек и комментариев - те же, что у парсера)
+ * 2. Документы разбираются пулом потоков. Каждый поток со своим контекстом берёт следующий
+ *    неразобранный документ из общего атомарного счётчика, так что освободившийся поток сразу
+ *    забирает работу и большие документы не тормозят остальные
+ * Результат - документы в исходном порядке, у каждого своя ошибка (строка/столбец - внутри документа)
+*/
+
+#include "json.h"
+#include "jsonScan.h"
+#include <pthread.h>
+#include <unistd.h>
+
+// задание пула
+typedef struct
+{
+	char				*str;
+	_jsonBatchDoc_t		*docs;
+	int					count;
+	int					next;			// следующий неразобранный документ
+} _jsonBatchJob_t;
+
+// добавление документа [start, end)
+static int batchAdd(_jsonBatchDoc_t **docs, int *count, int *size, _jsonLen_t start, _jsonLen_t end)
+{
+	if(*count == *size) {
+		*size = (*size == 0) ? 64 : (*size << 1);
+		*docs = (_jsonBatchDoc_t*)realloc(*docs, sizeof(_jsonBatchDoc_t) * (*size));
+	}
+	memset(*docs + *count, 0, sizeof(_jsonBatchDoc_t));
+	(*docs)[*count].start = start;
+	(*docs)[*count].len = end - start;
+	return (*count)++;
+}
+
+/* поиск границ документов
+ * return:			кол-во документов
+ * Документ - от открывающей скобки корня до парной закрывающей. Пробелы, переносы строк, запятые и
+ * комментарии между документами пропускаются. Любой другой символ вне документа начинает "мусорный"
+ * документ до конца строки: он попадёт в результат с ошибкой разбора
+*/
+int jsonBatchSplit(const char *str, _jsonLen_t len, _jsonBatchDoc_t **docs)
+{
+	_jsonScan_t		scan;
+	_jsonLen_t		i, start = 0;
+	int				count = 0, size = 0, level = 0;
+	char			quota = 0;
+
+	*docs = NULL;
+	jsonScanInit(&scan, str, len);
+	for(i=0; i<len; i++) {
+		if(quota != 0) {
+			// внутри строки интересны только кавычки (и переносы строк - они в том же классе)
+			i = jsonScanNext(&scan, i, JSON_SCAN_QUOTE);
+			if(i == len) {
+				break;
+			}
+			if((str[i] == quota) && (str[i-1] != '\\')) {
+				quota = 0;
+			}
+			continue;
+		}
+		i = jsonScanNext(&scan, i, (level > 0) ? JSON_SCAN_DELIM : JSON_SCAN_SPACE);
+		if(i == len) {
+			break;
+		}
+		switch(str[i]) {
+			case '/':
+				if((i + 1 < len) && (str[i+1] == '/')) {
+					while((i < len) && (str[i] != '\n')) {
+						i++;
+					}
+					continue;
+				}
+				if((i + 1 < len) && (str[i+1] == '*')) {
+					for(i+=2; (i + 1 < len) && ((str[i] != '*') || (str[i+1] != '/')); i++);
+					i++;
+					continue;
+				}
+				break;
+			case '"': case '\'':
+				// строка вне документа - мусор, как любой другой символ
+				if(level == 0) {
+					break;
+				}
+				if(str[i-1] != '\\') {
+					quota = str[i];
+				}
+				continue;
+			case '{': case '[':
+				if(level++ == 0) {
+					start = i;
+				}
+				continue;
+			case '}': case ']':
+				if(level > 0) {
+					if(--level == 0) {
+						batchAdd(docs, &count, &size, start, i + 1);
+					}
+					continue;
+				}
+				break;
+			case ' ': case '\t': case '\r': case '\n': case ',':
+				continue;
+		}
+		if(level == 0) {
+			// мусор вне документа - до конца строки
+			start = i;
+			while((i < len) && (str[i] != '\n')) {
+				i++;
+			}
+			batchAdd(docs, &count, &size, start, i);
+		}
+	}
+	if(level > 0) {
+		// незакрытый последний документ - разбор выдаст ошибку
+		batchAdd(docs, &count, &size, start, len);
+	}
+	return count;
+}
+
+// рабочий поток пула
+static void* batchWorker(void *arg)
+{
+	_jsonBatchJob_t		*job = (_jsonBatchJob_t*)arg;
+	_jsonBatchDoc_t		*doc;
+	_jsonCtx_t			ctx;
+	int					n;
+
+	jsonCtxInit(&ctx);
+	while((n = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->count) {
+		doc = job->docs + n;
+		doc->res = jsonParser_r(job->str + doc->start, &doc->obj, doc->len, &ctx);
+		if(doc->res != 0) {
+			clearFlatJsonObj(&doc->obj);
+			doc->error = ctx.error;
+			strncpy(doc->cErr, ctx.error.message, sizeof(doc->cErr) - 1);
+			doc->cErr[sizeof(doc->cErr) - 1] = 0;
+			doc->error.message = doc->cErr;
+		}
+	}
+	jsonCtxFree(&ctx);
+	return NULL;
+}
+
+/* разбор потока документов
+ * str				IN  документы подряд (NDJSON, или просто один за другим)
+ * len				IN  длина (0 - до завершающего нуля)
+ * threads			IN  кол-во потоков (0 - по числу процессоров)
+ * docs				OUT массив результатов (освобождается jsonBatchFree)
+ * return:			кол-во документов
+ * Документы ссылаются на str: строка должна жить, пока используются документы
+*/
+int jsonParseBatch(char *str, _jsonLen_t len, int threads, _jsonBatchDoc_t **docs)
+{
+	_jsonBatchJob_t		job;
+	pthread_t			*pool;
+	int					i;
+
+	if(len == 0) {
+		len = strlen(str);
+	}
+	job.str = str;
+	job.count = jsonBatchSplit(str, len, docs);
+	job.docs = *docs;
+	job.next = 0;
+
+	if(threads <= 0) {
+		threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if(threads > job.count) {
+		threads = job.count;
+	}
+	if(threads <= 1) {
+		batchWorker(&job);
+		return job.count;
+	}
+
+	// текущий поток тоже работает
+	pool = (pthread_t*)malloc(sizeof(pthread_t) * (threads - 1));
+	for(i=0; i<threads-1; i++) {
+		if(pthread_create(pool + i, NULL, batchWorker, &job) != 0) {
+			break;
+		}
+	}
+	threads = i;
+	batchWorker(&job);
+	for(i=0; i<threads; i++) {
+		pthread_join(pool[i], NULL);
+	}
+	free(pool);
+	return job.count;
+}
+
+void jsonBatchFree(_jsonBatchDoc_t **docs, int count)
+{
+	int		i;
+
+	if(*docs == NULL) {
+		return;
+	}
+	for(i=0; i<count; i++) {
+		if((*docs)[i].obj != NULL) {
+			clearFlatJsonObj(&(*docs)[i].obj);
+		}
+	}
+	free(*docs);
+	*docs = NULL;
+}
@@ -0,0 +1,283 @@
+/* struct binding for dirty json parser
+ * Avinfors, O.Nikitin
+ *
+ * Упоротость и отвага!
+*/
+
+/* Привязка объекта json'а к структуре C
+ * Вместо отдельного getJsonStr на каждое поле (каждый - проход по пути и malloc копии) структура
+ * описывается таблицей полей: имя ключа, тип, смещение и размер поля. jsonBind проходит ключи объекта
+ * один раз, для каждого ищет поле в таблице (начиная с поля за последним найденным - ключи обычно идут
+ * в порядке таблицы) и пишет значение прямо в структуру. Вложенные объекты и массивы объектов - своими
+ * таблицами, тем же проходом. Память не распределяется: строки копируются в буферы char[N] структуры
+ * (или не копируются вовсе - JSON_BIND_VIEW), массивы - в поля T[N] со счётчиком
+ *
+ * Тип значения проверяется по valueType токена (JSON_BIND_INT принимает только целые, JSON_BIND_STRING -
+ * только строки...), несовпадение - ошибка JSON_ERR_BIND_TYPE с позицией значения в json'е.
+ * null и отсутствующие ключи поле не меняют (для JSON_BIND_REQUIRED это ошибка), лишние ключи пропускаются
+ *
+ *	typedef struct {
+ *		char		code[64];
+ *		char		name[128];
+ *		_jsonView_t	desc;
+ *		char		type[16];
+ *	} report_t;
+ *
+ *	typedef struct {
+ *		char		defaultType[16];
+ *		report_t	list[32];
+ *		int			listCount;
+ *	} reports_t;
+ *
+ *	static const _jsonBind_t reportBind[] = {
+ *		JSON_BIND(report_t, code, "code", JSON_BIND_STRING, JSON_BIND_REQUIRED),
+ *		JSON_BIND(report_t, name, "name", JSON_BIND_STRING, 0),
+ *		JSON_BIND(report_t, desc, "desc", JSON_BIND_VIEW, 0),
+ *		JSON_BIND(report_t, type, "type", JSON_BIND_STRING, 0),
+ *		JSON_BIND_END
+ *	};
+ *	static const _jsonBind_t reportsBind[] = {
+ *		JSON_BIND(reports_t, defaultType, "defaultType", JSON_BIND_STRING, 0),
+ *		JSON_BIND_LIST(reports_t, list, listCount, "list", reportBind, 0),
+ *		JSON_BIND_END
+ *	};
+ *
+ *	reports_t	reports = {0};
+ *	if(jsonBind(jsonObj, "reports", reportsBind, &reports) != 0) {
+ *		... getLastError()
+ *	}
+ *
+ * Документ не меняется (числа берутся из кеша jsonDecodeNumbers, если он есть, иначе декодируются на месте),
+ * поэтому один документ можно привязывать из нескольких потоков
+*/
+
+#include "json.h"
+
+// ошибка привязки с позицией токена в json'е (строка, столбец - как у парсера)
+static int bindError(_jsonObj_t *jsonObj, _jsonToken_t *token, int errNum, _jsonCtx_t *ctx)
+{
+	const char	*p, *lineStart = jsonObj->json, *end = jsonObj->json + token->start;
+	int			line = 1;
+
+	for(p = jsonObj->json; p < end; p++) {
+		if(*p == '\n') {
+			line++;
+			lineStart = p + 1;
+		}
+	}
+	setError(ctx, line, (int)(end - lineStart) + 1, '.', errNum);
+	return 1;
+}
+
+// целое в поле размера size
+static bool putInt(void *field, size_t size, long long i)
+{
+	switch(size) {
+		case 1:
+			if((i < SCHAR_MIN) || (i > SCHAR_MAX)) {
+				return false;
+			}
+			*(signed char*)field = (signed char)i;
+			return true;
+		case 2:
+			if((i < SHRT_MIN) || (i > SHRT_MAX)) {
+				return false;
+			}
+			*(short*)field = (short)i;
+			return true;
+		case 4:
+			if((i < INT_MIN) || (i > INT_MAX)) {
+				return false;
+			}
+			*(int*)field = (int)i;
+			return true;
+		case 8:
+			*(long long*)field = i;
+			return true;
+	}
+	return false;
+}
+
+// дробное в поле размера size (long double - через strtold, как jsonCursorDouble)
+static bool putDouble(_jsonObj_t *jsonObj, _jsonToken_t *token, void *field, size_t size)
+{
+	char		buff[64];
+	_jsonNum_t	num;
+	_jsonOff_t	len = token->end - token->start;
+
+	if(size == sizeof(long double)) {
+		if(len >= (int)sizeof(buff)) {
+			return false;
+		}
+		memcpy(buff, jsonObj->json + token->start, len);
+		buff[len] = 0;
+		*(long double*)field = strtold(buff, NULL);
+		return true;
+	}
+	jsonTokenDecode(jsonObj, token, &num);
+	if(size == sizeof(double)) {
+		*(double*)field = num.d;
+		return true;
+	}
+	if(size == sizeof(float)) {
+		*(float*)field = (float)num.d;
+		return true;
+	}
+	return false;
+}
+
+static int bindObject(_jsonObj_t *jsonObj, _jsonToken_t *object, const _jsonBind_t *bind, char *out, _jsonCtx_t *ctx);
+
+// значение одного поля
+static int bindValue(_jsonObj_t *jsonObj, _jsonToken_t *value, const _jsonBind_t *bind, char *out, _jsonCtx_t *ctx)
+{
+	char			*field = out + bind->offset;
+	_jsonToken_t	*elem;
+	_jsonNum_t		num;
+	_jsonOff_t		id;
+	int				count = 0;
+	bool			scalar = (value->type == JSON_VALUE);
+
+	switch(bind->type) {
+		case JSON_BIND_STRING:
+			if(!scalar || (value->valueType != JSON_VALUE_STRING)) {
+				return bindError(jsonObj, value, JSON_ERR_BIND_TYPE, ctx);
+			}
+			if(jsonTokenString(jsonObj, value, field, (_jsonOff_t)bind->size) < 0) {
+				return bindError(jsonObj, value, JSON_ERR_BIND_OVERFLOW, ctx);
+			}
+			return 0;
+		case JSON_BIND_VIEW:
+			if(!scalar) {
+				return bindError(jsonObj, value, JSON_ERR_BIND_TYPE, ctx);
+			}
+			jsonTokenView(jsonObj, value, (_jsonView_t*)field);
+			return 0;
+		case JSON_BIND_INT:
+			if(!scalar || (value->valueType != JSON_VALUE_INT)) {
+				return bindError(jsonObj, value, JSON_ERR_BIND_TYPE, ctx);
+			}
+			jsonTokenDecode(jsonObj, value, &num);
+			if((num.flags & JSON_NUM_INT_OVERFLOW) || !putInt(field, bind->size, num.i)) {
+				return bindError(jsonObj, value, JSON_ERR_BIND_OVERFLOW, ctx);
+			}
+			return 0;
+		case JSON_BIND_DOUBLE:
+			if(!scalar || ((value->valueType != JSON_VALUE_INT) && (value->valueType != JSON_VALUE_FLOAT))) {
+				return bindError(jsonObj, value, JSON_ERR_BIND_TYPE, ctx);
+			}
+			if(!putDouble(jsonObj, value, field, bind->size)) {
+				return bindError(jsonObj, value, JSON_ERR_BIND_OVERFLOW, ctx);
+			}
+			return 0;
+		case JSON_BIND_BOOL:
+			if(!scalar || (value->valueType != JSON_VALUE_BOOL)) {
+				return bindError(jsonObj, value, JSON_ERR_BIND_TYPE, ctx);
+			}
+			*(bool*)field = (jsonObj->json[value->start] == 't');
+			return 0;
+		case JSON_BIND_OBJECT:
+			if(value->type != JSON_OBJECT) {
+				return bindError(jsonObj, value, JSON_ERR_BIND_TYPE, ctx);
+			}
+			return bindObject(jsonObj, value, bind->sub, field, ctx);
+		case JSON_BIND_ARRAY:
+			if(value->type != JSON_ARRAY) {
+				return bindError(jsonObj, value, JSON_ERR_BIND_TYPE, ctx);
+			}
+			for(id = jsonTokenFChild(jsonObj, value); id != 0; id = elem->nextToken) {
+				elem = jsonObj->token + id;
+				if(elem->type != JSON_OBJECT) {
+					return bindError(jsonObj, elem, JSON_ERR_BIND_TYPE, ctx);
+				}
+				if(count == bind->max) {
+					return bindError(jsonObj, elem, JSON_ERR_BIND_OVERFLOW, ctx);
+				}
+				if(bindObject(jsonObj, elem, bind->sub, field + bind->size * count, ctx) != 0) {
+					return 1;
+				}
+				// счётчик - после каждого элемента: при ошибке в нём - кол-во привязанных целиком
+				*(int*)(out + bind->countOffset) = ++count;
+			}
+			*(int*)(out + bind->countOffset) = count;
+			return 0;
+	}
+	return bindError(jsonObj, value, JSON_ERR_BIND_TYPE, ctx);
+}
+
+// ключи объекта - в поля структуры out по таблице bind
+static int bindObject(_jsonObj_t *jsonObj, _jsonToken_t *object, const _jsonBind_t *bind, char *out, _jsonCtx_t *ctx)
+{
+	unsigned long long	seen = 0;		// поля, получившие значение
+	_jsonToken_t		*key, *value;
+	_jsonOff_t			id, len;
+	int					n, i, f = 0, last = -1;
+
+	for(n=0; bind[n].key != NULL; n++);
+	if(n > JSON_BIND_MAX_FIELDS) {
+		return bindError(jsonObj, object, JSON_ERR_BIND_OVERFLOW, ctx);
+	}
+	for(id = jsonTokenFChild(jsonObj, object); id != 0; id = key->nextToken) {
+		key = jsonObj->token + id;
+		len = key->end - key->start;
+		if((key->type != JSON_KEY) || (len <= 0) || (jsonTokenFChild(jsonObj, key) == 0) || (n == 0)) {
+			continue;
+		}
+		for(i=0; i<n; i++) {
+			f = (last + 1 + i) % n;
+			if((strncmp(bind[f].key, jsonObj->json + key->start, len) == 0) && (bind[f].key[len] == 0)) {
+				break;
+			}
+		}
+		if(i == n) {
+			continue;
+		}
+		last = f;
+		value = jsonObj->token + jsonTokenFChild(jsonObj, key);
+		if((value->type == JSON_VALUE) && (value->valueType == JSON_VALUE_NULL)) {
+			continue;
+		}
+		if(bindValue(jsonObj, value, bind + f, out, ctx) != 0) {
+			return 1;
+		}
+		seen |= 1ULL << f;
+	}
+	for(f=0; f<n; f++) {
+		if((bind[f].flags & JSON_BIND_REQUIRED) && !(seen & (1ULL << f))) {
+			return bindError(jsonObj, object, JSON_ERR_BIND_MISSING, ctx);
+		}
+	}
+	return 0;
+}
+
+// привязка (контекст потока по умолчанию), см. jsonBind_r
+int jsonBind(_jsonObj_t *jsonObj, const char *path, const _jsonBind_t *bind, void *out)
+{
+	return jsonBind_r(jsonObj, path, bind, out, jsonDefaultCtx());
+}
+
+/* привязка объекта json'а к структуре
+ * path				путь к объекту (как у xPath), NULL или "" - корень
+ * bind				таблица полей (до JSON_BIND_END, не больше JSON_BIND_MAX_FIELDS полей)
+ * out				структура
+ * ctx				контекст для ошибки (см. jsonParser_r)
+ * return:			0 - успех, 1 - ошибка (JSON_ERR_BIND_*, позиция - значения или объекта).
+ *					Поля до ошибки уже заполнены
+*/
+int jsonBind_r(_jsonObj_t *jsonObj, const char *path, const _jsonBind_t *bind, void *out, _jsonCtx_t *ctx)
+{
+	_jsonToken_t	*object;
+
+	if(jsonObj->count == 0) {
+		setError(ctx, 1, 1, '.', JSON_ERR_BIND_MISSING);
+		return 1;
+	}
+	object = ((path == NULL) || (*path == 0)) ? jsonObj->token : xPathNode_r(path, jsonObj, ctx);
+	if(object == NULL) {
+		return bindError(jsonObj, jsonObj->token, JSON_ERR_BIND_MISSING, ctx);
+	}
+	if(object->type != JSON_OBJECT) {
+		return bindError(jsonObj, object, JSON_ERR_BIND_TYPE, ctx);
+	}
+	return bindObject(jsonObj, object, bind, (char*)out, ctx);
+}
@@ -0,0 +1,371 @@
+/* content-hash document cache for dirty json parser
+ * Avinfors, O.Nikitin
+ *
+ * Упоротость и отвага!
+*/
+
+/* Кэш разобранных документов по содержимому: одинаковые байты json'а разбираются один раз
+ * Ключ - jsonHash64 входа (при совпадении хэша байты сравниваются целиком). Кэш хранит копию json'а
+ * и выдаёт документы со счётчиком ссылок: документ, выданный jsonCacheGet, живёт до jsonCacheRelease,
+ * даже если за это время его вытеснили. Объём кэша ограничен maxBytes (json, токены, числа, индекс), при
+ * превышении вытесняются неиспользуемые (refs == 0) документы:
+ *  JSON_CACHE_LRU		- давно не запрошенный (запрос переносит документ в голову списка)
+ *  JSON_CACHE_CLOCK	- "часы": стрелка идёт по кругу, запрошенный с прошлого прохода документ
+ *						  получает вторую попытку. Запрос только ставит признак, списки не перестраиваются
+ *
+ *	_jsonCache_t	*cache = jsonCacheInit(64 << 20, JSON_CACHE_CLOCK | JSON_CACHE_INDEX);
+ *	...в любом потоке:
+ *	_jsonObj_t		*doc = jsonCacheGet(cache, body, bodyLen);
+ *	if(doc != NULL) {
+ *		... xPath, getJsonStr, jsonFindKey ...
+ *		jsonCacheRelease(cache, doc);
+ *	}
+ *	...
+ *	jsonCacheFree(&cache);
+ *
+ * Документы кэша общие для всех потоков и только для чтения: ф-ции, меняющие документ (jsonDocParse,
+ * jsonReparse, jsonEdit*, jsonBuildIndex), для них запрещены. Числа (jsonDecodeNumbers) и индекс ключей
+ * (JSON_CACHE_INDEX) готовятся до того, как документ станет виден другим потокам. jsonIndexKey/jsonIndexAt
+ * на документе кэша индекс не строят (doc->shared): без JSON_CACHE_INDEX это обычный jsonFindKey/jsonArrayAt
+ * Разбор при промахе идёт вне блокировки: потоки, одновременно не нашедшие один и тот же json, разберут
+ * его каждый сам, в кэше останется первый документ
+*/
+
+#include "json.h"
+#include <pthread.h>
+
+#define				JSON_CACHE_BUCKETS		(int)	64		// начальный размер хэш-таблицы
+
+// документ кэша: _jsonCacheEntry_t* и _jsonObj_t* взаимно приводятся (doc - первое поле)
+typedef struct _jsonCacheEntry_s
+{
+	_jsonObj_t					doc;
+	unsigned long long			hash;
+	_jsonLen_t					len;
+	size_t						bytes;			// учтённый объём: json, токены, числа, индекс
+	int							refs;			// выданные и не возвращённые ссылки
+	bool						cached;			// в таблице (false - вытеснен, освобождается последним release)
+	bool						referenced;		// CLOCK: запрошен с прошлого прохода стрелки
+	struct _jsonCacheEntry_s	*prev, *next;	// кольцо: голова - самый новый (LRU) / позиция стрелки (CLOCK)
+	struct _jsonCacheEntry_s	*chain;			// цепочка корзины хэш-таблицы
+} _jsonCacheEntry_t;
+
+struct _jsonCache_s
+{
+	pthread_mutex_t			lock;
+	int						flags;
+	size_t					maxBytes;
+	_jsonCacheEntry_t		**bucket;
+	size_t					buckets;		// степень двойки
+	_jsonCacheEntry_t		*ring;			// NULL - кэш пуст
+	_jsonCacheStats_t		stats;
+};
+
+/* новый кэш
+ * maxBytes			ограничение объёма (json, токены, числа и индекс документов, 0 - без ограничения)
+ * flags			JSON_CACHE_LRU или JSON_CACHE_CLOCK, плюс JSON_CACHE_INDEX - строить индекс ключей
+ * return:			кэш (освобождается jsonCacheFree) или NULL - не хватило памяти
+*/
+_jsonCache_t* jsonCacheInit(size_t maxBytes, int flags)
+{
+	_jsonCache_t	*cache = (_jsonCache_t*)calloc(1, sizeof(_jsonCache_t));
+
+	if(cache == NULL) {
+		return NULL;
+	}
+	cache->bucket = (_jsonCacheEntry_t**)calloc(JSON_CACHE_BUCKETS, sizeof(_jsonCacheEntry_t*));
+	if(cache->bucket == NULL) {
+		free(cache);
+		return NULL;
+	}
+	pthread_mutex_init(&cache->lock, NULL);
+	cache->flags = flags;
+	cache->maxBytes = maxBytes;
+	cache->buckets = JSON_CACHE_BUCKETS;
+	return cache;
+}
+
+static void entryFree(_jsonCacheEntry_t *entry)
+{
+	jsonDocFree(&entry->doc);
+	free(entry);
+}
+
+// исключение из кольца и таблицы (под блокировкой)
+static void unlinkEntry(_jsonCache_t *cache, _jsonCacheEntry_t *entry)
+{
+	_jsonCacheEntry_t	**p = cache->bucket + (entry->hash & (cache->buckets - 1));
+
+	while(*p != entry) {
+		p = &(*p)->chain;
+	}
+	*p = entry->chain;
+	if(entry->next == entry) {
+		cache->ring = NULL;
+	} else {
+		entry->prev->next = entry->next;
+		entry->next->prev = entry->prev;
+		if(cache->ring == entry) {
+			cache->ring = entry->next;
+		}
+	}
+	entry->cached = false;
+	cache->stats.entries--;
+	cache->stats.bytes -= entry->bytes;
+}
+
+// вставка перед элементом кольца (под блокировкой); before == NULL - кольцо пусто
+static void ringInsert(_jsonCache_t *cache, _jsonCacheEntry_t *entry, _jsonCacheEntry_t *before)
+{
+	if(before == NULL) {
+		entry->prev = entry->next = entry;
+		cache->ring = entry;
+		return;
+	}
+	entry->next = before;
+	entry->prev = before->prev;
+	before->prev->next = entry;
+	before->prev = entry;
+}
+
+/* вытеснение до maxBytes (под блокировкой)
+ * LRU - с хвоста кольца, CLOCK - от стрелки. Выданные документы пропускаются: за один вызов
+ * кольцо проходится не больше двух раз (CLOCK: первый проход снимает признаки)
+*/
+static void evict(_jsonCache_t *cache)
+{
+	_jsonCacheEntry_t	*entry, *next;
+	size_t				steps = 2 * cache->stats.entries;
+
+	while((cache->maxBytes > 0) && (cache->stats.bytes > cache->maxBytes) && (cache->ring != NULL) && (steps-- > 0)) {
+		if(cache->flags & JSON_CACHE_CLOCK) {
+			entry = cache->ring;
+			next = entry->next;
+			if(entry->referenced || (entry->refs > 0)) {
+				entry->referenced = false;
+				cache->ring = next;
+				continue;
+			}
+		} else {
+			entry = cache->ring->prev;
+			if(entry->refs > 0) {
+				// выданный документ - в голову, чтобы не встречать его снова
+				if(entry != cache->ring) {
+					entry->prev->next = entry->next;
+					entry->next->prev = entry->prev;
+					ringInsert(cache, entry, cache->ring);
+					cache->ring = entry;
+				}
+				continue;
+			}
+		}
+		unlinkEntry(cache, entry);
+		cache->stats.evictions++;
+		entryFree(entry);
+	}
+}
+
+// поиск (под блокировкой), найденный документ получает ссылку
+static _jsonCacheEntry_t* lookup(_jsonCache_t *cache, unsigned long long hash, const char *str, _jsonLen_t len)
+{
+	_jsonCacheEntry_t	*entry;
+
+	for(entry = cache->bucket[hash & (cache->buckets - 1)]; entry != NULL; entry = entry->chain) {
+		if((entry->hash == hash) && (entry->len == len) && (memcmp(entry->doc.json, str, len) == 0)) {
+			entry->refs++;
+			if(cache->flags & JSON_CACHE_CLOCK) {
+				entry->referenced = true;
+			} else if(entry != cache->ring) {
+				entry->prev->next = entry->next;
+				entry->next->prev = entry->prev;
+				ringInsert(cache, entry, cache->ring);
+				cache->ring = entry;
+			}
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+// удвоение хэш-таблицы (под блокировкой), при нехватке памяти таблица остаётся прежней
+static void grow(_jsonCache_t *cache)
+{
+	_jsonCacheEntry_t	**bucket = (_jsonCacheEntry_t**)calloc(cache->buckets * 2, sizeof(_jsonCacheEntry_t*));
+	_jsonCacheEntry_t	*entry, *next;
+	size_t				i, n;
+
+	if(bucket == NULL) {
+		return;
+	}
+	for(i=0; i<cache->buckets; i++) {
+		for(entry = cache->bucket[i]; entry != NULL; entry = next) {
+			next = entry->chain;
+			n = entry->hash & (cache->buckets * 2 - 1);
+			entry->chain = bucket[n];
+			bucket[n] = entry;
+		}
+	}
+	free(cache->bucket);
+	cache->bucket = bucket;
+	cache->buckets *= 2;
+}
+
+// документ из кэша (контекст потока по умолчанию), см. jsonCacheGet_r
+_jsonObj_t* jsonCacheGet(_jsonCache_t *cache, const char *str, _jsonLen_t len)
+{
+	return jsonCacheGet_r(cache, str, len, jsonDefaultCtx());
+}
+
+/* документ по содержимому json'а: из кэша или разбором копии
+ * str, len			json (len == 0 - до завершающего нуля), после вызова клиенту не нужен
+ * ctx				контекст для ошибки разбора (см. jsonParser_r)
+ * return:			документ только для чтения (вернуть - jsonCacheRelease) или NULL - ошибка разбора
+ *					(ошибочный json не кэшируется) или не хватило памяти
+*/
+_jsonObj_t* jsonCacheGet_r(_jsonCache_t *cache, const char *str, _jsonLen_t len, _jsonCtx_t *ctx)
+{
+	_jsonCacheEntry_t	*entry, *found;
+	unsigned long long	hash;
+
+	if(len == 0) {
+		len = strlen(str);
+	}
+	hash = jsonHash64(str, len, 0);
+
+	pthread_mutex_lock(&cache->lock);
+	entry = lookup(cache, hash, str, len);
+	if(entry != NULL) {
+		cache->stats.hits++;
+		pthread_mutex_unlock(&cache->lock);
+		return &entry->doc;
+	}
+	cache->stats.misses++;
+	pthread_mutex_unlock(&cache->lock);
+
+	// промах: разбор копии без блокировки
+	entry = (_jsonCacheEntry_t*)calloc(1, sizeof(_jsonCacheEntry_t));
+	if(entry == NULL) {
+		setError(ctx, 1, 1, '.', JSON_ERR_NO_MEMORY);
+		return NULL;
+	}
+	jsonDocInit(&entry->doc, NULL);
+	entry->doc.own = (char*)malloc(len + 1);
+	if(entry->doc.own == NULL) {
+		free(entry);
+		setError(ctx, 1, 1, '.', JSON_ERR_NO_MEMORY);
+		return NULL;
+	}
+	memcpy(entry->doc.own, str, len);
+	entry->doc.own[len] = 0;
+	// числа декодируются сразу: getJsonInt/getJsonDouble/jsonTokenNumber только читают кеш документа
+	if((jsonDocParse(&entry->doc, entry->doc.own, len, ctx) != 0) || !jsonDecodeNumbers(&entry->doc) ||
+		((cache->flags & JSON_CACHE_INDEX) && !jsonBuildIndex_r(&entry->doc, ctx)))
+	{
+		entryFree(entry);
+		return NULL;
+	}
+	entry->doc.shared = true;
+	entry->hash = hash;
+	entry->len = len;
+	entry->refs = 1;
+	entry->bytes = sizeof(_jsonCacheEntry_t) + len + 1 + sizeof(_jsonToken_t) * entry->doc.capacity +
+		sizeof(_jsonNum_t) * ((entry->doc.count > 0) ? entry->doc.count : 1);
+	if(entry->doc.index != NULL) {
+		// оценка: таблицы индекса - несколько смещений на токен
+		entry->bytes += sizeof(_jsonOff_t) * 4 * entry->doc.count;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	found = lookup(cache, hash, str, len);
+	if(found != NULL) {
+		// другой поток успел раньше
+		pthread_mutex_unlock(&cache->lock);
+		entryFree(entry);
+		return &found->doc;
+	}
+	if(cache->stats.entries >= cache->buckets) {
+		grow(cache);
+	}
+	entry->chain = cache->bucket[hash & (cache->buckets - 1)];
+	cache->bucket[hash & (cache->buckets - 1)] = entry;
+	entry->cached = true;
+	if(cache->flags & JSON_CACHE_CLOCK) {
+		// за стрелкой: новый документ проверяется последним
+		ringInsert(cache, entry, cache->ring);
+		if(cache->ring == NULL) {
+			cache->ring = entry;
+		}
+	} else {
+		ringInsert(cache, entry, cache->ring);
+		cache->ring = entry;
+	}
+	cache->stats.entries++;
+	cache->stats.bytes += entry->bytes;
+	evict(cache);
+	pthread_mutex_unlock(&cache->lock);
+	return &entry->doc;
+}
+
+/* возврат документа, полученного jsonCacheGet
+ * Вытесненный документ освобождается с последней ссылкой
+*/
+void jsonCacheRelease(_jsonCache_t *cache, _jsonObj_t *doc)
+{
+	_jsonCacheEntry_t	*entry = (_jsonCacheEntry_t*)doc;
+	bool				drop;
+
+	if(doc == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&cache->lock);
+	entry->refs--;
+	drop = (entry->refs == 0) && !entry->cached;
+	if(!drop && (entry->refs == 0)) {
+		// вытеснение, пропущенное из-за этой ссылки
+		evict(cache);
+	}
+	pthread_mutex_unlock(&cache->lock);
+	if(drop) {
+		entryFree(entry);
+	}
+}
+
+// счётчики кэша (снимок на момент вызова)
+void jsonCacheStats(_jsonCache_t *cache, _jsonCacheStats_t *stats)
+{
+	pthread_mutex_lock(&cache->lock);
+	*stats = cache->stats;
+	pthread_mutex_unlock(&cache->lock);
+}
+
+/* сброс кэша: документы без ссылок освобождаются сразу, выданные - при jsonCacheRelease
+*/
+void jsonCacheClear(_jsonCache_t *cache)
+{
+	_jsonCacheEntry_t	*entry;
+
+	pthread_mutex_lock(&cache->lock);
+	while(cache->ring != NULL) {
+		entry = cache->ring;
+		unlinkEntry(cache, entry);
+		if(entry->refs == 0) {
+			entryFree(entry);
+		}
+	}
+	pthread_mutex_unlock(&cache->lock);
+}
+
+/* освобождение кэша
+ * Все документы должны быть возвращены (jsonCacheRelease) до вызова
+*/
+void jsonCacheFree(_jsonCache_t **cache)
+{
+	if((cache == NULL) || (*cache == NULL)) {
+		return;
+	}
+	jsonCacheClear(*cache);
+	pthread_mutex_destroy(&(*cache)->lock);
+	free((*cache)->bucket);
+	free(*cache);
+	*cache = NULL;
+}
@@ -0,0 +1,142 @@
+/* cursor navigation for dirty json parser
+ * Avinfors, O.Nikitin
+ *
+ * Упоротость и отвага!
+*/
+
+/* Курсор - позиция (индекс токена) в разобранном документе.
+ * Курсор - значение, а не ссылка: его можно копировать, чтобы запомнить позицию.
+ * При неудачном перемещении курсор остаётся на месте.
+ *
+ * Пример: чтение полей всех элементов reports.list без повторных проходов от корня
+ *	_jsonCursor_t	list, item;
+ *	jsonCursorInit(&list, jsonObj);
+ *	if(jsonCursorKey(&list, "reports", 7) && jsonCursorKey(&list, "list", 4)) {
+ *		for(item=list, ok=jsonCursorChild(&item); ok; ok=jsonCursorNext(&item)) {
+ *			_jsonCursor_t field = item;
+ *			if(jsonCursorKey(&field, "code", 4)) ...
+ *		}
+ *	}
+*/
+
+#include "json.h"
+
+// курсор на корень документа
+void jsonCursorInit(_jsonCursor_t *cursor, _jsonObj_t *jsonObj)
+{
+	cursor->obj = jsonObj;
+	cursor->id = 0;
+}
+
+_jsonToken_t* jsonCursorToken(_jsonCursor_t *cursor)
+{
+	return cursor->obj->token + cursor->id;
+}
+
+/* вниз: у ключа - на его значение, у объекта - на первый ключ, у массива - на первый элемент
+*/
+bool jsonCursorChild(_jsonCursor_t *cursor)
+{
+	_jsonOff_t	child = jsonTokenFChild(cursor->obj, cursor->obj->token + cursor->id);
+
+	if(child == 0) {
+		return false;
+	}
+	cursor->id = child;
+	return true;
+}
+
+// вправо: следующий ключ объекта / элемент массива
+bool jsonCursorNext(_jsonCursor_t *cursor)
+{
+	_jsonOff_t	next = (cursor->obj->token + cursor->id)->nextToken;
+
+	if(next == 0) {
+		return false;
+	}
+	cursor->id = next;
+	return true;
+}
+
+// вверх: у значения ключа - на ключ, у ключа и элемента массива - на контейнер
+bool jsonCursorParent(_jsonCursor_t *cursor)
+{
+	if(cursor->id == 0) {
+		return false;
+	}
+	cursor->id = (cursor->obj->token + cursor->id)->parent;
+	return true;
+}
+
+/* на значение ключа key текущего объекта
+ * если курсор стоит на ключе - поиск выполняется в объекте, который является значением этого ключа
+*/
+bool jsonCursorKey(_jsonCursor_t *cursor, const char *key, _jsonLen_t keyLen)
+{
+	_jsonToken_t	*token = cursor->obj->token + cursor->id;
+
+	if((token->type == JSON_KEY) && (jsonTokenFChild(cursor->obj, token) != 0)) {
+		token = cursor->obj->token + jsonTokenFChild(cursor->obj, token);
+	}
+	token = jsonFindKey(cursor->obj, token, key, keyLen);
+	if((token == NULL) || (jsonTokenFChild(cursor->obj, token) == 0)) {
+		return false;
+	}
+	cursor->id = jsonTokenFChild(cursor->obj, token);
+	return true;
+}
+
+// на элемент n текущего массива
+bool jsonCursorAt(_jsonCursor_t *cursor, _jsonOff_t n)
+{
+	_jsonToken_t	*token = cursor->obj->token + cursor->id;
+
+	if((token->type == JSON_KEY) && (jsonTokenFChild(cursor->obj, token) != 0)) {
+		token = cursor->obj->token + jsonTokenFChild(cursor->obj, token);
+	}
+	token = jsonArrayAt(cursor->obj, token, n);
+	if(token == NULL) {
+		return false;
+	}
+	cursor->id = token - cursor->obj->token;
+	return true;
+}
+
+// значение под курсором без копирования (см. jsonTokenView)
+bool jsonCursorView(_jsonCursor_t *cursor, _jsonView_t *view)
+{
+	return jsonTokenView(cursor->obj, cursor->obj->token + cursor->id, view);
+}
+
+/* значение под курсором как число
+ * КОСЯК! Если под курсором не число - возвращается 0
+*/
+long long jsonCursorInt(_jsonCursor_t *cursor)
+{
+	char				buff[64];
+	_jsonView_t			view;
+	_jsonNum_t			num;
+
+	if(jsonTokenDecode(cursor->obj, cursor->obj->token + cursor->id, &num)) {
+		return num.i;
+	}
+	if(!jsonCursorView(cursor, &view) || (view.type != JSON_VALUE) || (view.len >= (int)sizeof(buff))) {
+		return 0;
+	}
+	memcpy(buff, view.ptr, view.len);
+	buff[view.len] = 0;
+	return atoll(buff);
+}
+
+long double jsonCursorDouble(_jsonCursor_t *cursor)
+{
+	char		buff[64];
+	_jsonView_t	view;
+
+	if(!jsonCursorView(cursor, &view) || (view.type != JSON_VALUE) || (view.len >= (int)sizeof(buff))) {
+		return 0;
+	}
+	memcpy(buff, view.ptr, view.len);
+	buff[view.len] = 0;
+	return strtold(buff, NULL);
+}
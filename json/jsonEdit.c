@@ -0,0 +1,675 @@
+/* in-place editing for dirty json parser
+ * Avinfors, O.Nikitin
+ *
+ * Упоротость и отвага!
+*/
+
+/* Правка разобранного документа без перестроения дерева
+ * Правки (замена значения, новый ключ, новый элемент массива, удаление) копятся списком поверх массива
+ * токенов, исходный json и токены не меняются. При выводе (jsonEditWrite) нетронутые участки исходного
+ * json'а копируются байт в байт - с пробелами, комментариями и кавычками как были, заново выводятся
+ * только заменённые узлы и контейнеры, в которых менялся состав. Стоимость вывода - копирование памяти
+ * плюс работа, пропорциональная правкам, а не размеру документа
+ *
+ *	_jsonToken_t	*ver = xPath("version", doc);
+ *	_jsonToken_t	*data = xPathNode("contractData", doc);
+ *
+ *	jsonEditSetInt(doc, ver, 2);
+ *	jsonEditSetString(doc, jsonFindKey(doc, data, "number", 6), "77-01/2024", 0);
+ *	jsonEditInsert(doc, data, "signed", 6, "true", 4);
+ *	jsonEditRemove(doc, jsonFindKey(doc, data, "draft", 5));
+ *	out = jsonEditWrite(doc, &outLen);		// освобождается free
+ *
+ * Текст значений - готовый json (jsonEditSetString сам берёт строку в кавычки и экранирует её), он не
+ * проверяется. Правки внутри заменённого или удалённого поддерева при выводе не видны
+ * jsonWrite/jsonAsString/xPath и прочие функции чтения правок не видят: они работают с исходным json'ом.
+ * Правки сбрасываются jsonEditFree, повторным разбором и jsonDocFree
+*/
+
+#include <stdio.h>
+
+#include "json.h"
+
+#define				JSON_EDIT_OPS			(int)	16		// начальный размер списка правок
+#define				JSON_EDIT_POOL			(int)	256		// начальный размер пула текстов
+#define				JSON_EDIT_PATCH_SET		(int)	0		// участок вывода: текст правки
+#define				JSON_EDIT_PATCH_STRUCT	(int)	1		// участок вывода: контейнер с изменённым составом
+
+// участок исходного json'а, который выводится не как есть
+typedef struct
+{
+	_jsonOff_t		start;
+	_jsonOff_t		end;
+	_jsonOff_t		token;			// контейнер (JSON_EDIT_PATCH_STRUCT)
+	int				kind;			// JSON_EDIT_PATCH_*
+	int				op;				// правка (JSON_EDIT_PATCH_SET)
+} _patch_t;
+
+// вывод: out == NULL - только подсчёт размера
+typedef struct
+{
+	_jsonObj_t		*doc;
+	_patch_t		*patch;			// по возрастанию start, при равных - по убыванию end, SET раньше STRUCT
+	int				count;
+	char			*out;
+	size_t			pos;
+} _editOut_t;
+
+static inline void put(_editOut_t *w, const char *p, size_t n)
+{
+	if(w->out != NULL) {
+		memcpy(w->out + w->pos, p, n);
+	}
+	w->pos += n;
+}
+
+static bool isContainer(_jsonToken_t *token)
+{
+	return (token->type == JSON_OBJECT) || (token->type == JSON_ARRAY);
+}
+
+// токен документа (пустой корневой контейнер - тоже токен, хотя count == 0)
+static bool validToken(_jsonObj_t *jsonObj, _jsonToken_t *token)
+{
+	_jsonOff_t	id;
+
+	if((jsonObj == NULL) || (token == NULL) || (jsonObj->sax != NULL) || (jsonObj->token == NULL)) {
+		return false;
+	}
+	id = token - jsonObj->token;
+	if(id == 0) {
+		return (jsonObj->count > 0) || isContainer(token);
+	}
+	return (id > 0) && (id < jsonObj->count);
+}
+
+// новая правка; текст и имя ключа копируются в пул
+static _jsonEditOp_t* addOp(_jsonObj_t *jsonObj, int op, _jsonOff_t token, const char *key, size_t keyLen, const char *text, size_t len)
+{
+	_jsonEdit_t		*edit = jsonObj->edit;
+	_jsonEditOp_t	*res;
+	void			*p;
+	size_t			size;
+
+	if(edit == NULL) {
+		edit = (_jsonEdit_t*)jsonObjRealloc(jsonObj, NULL, 0, sizeof(_jsonEdit_t));
+		if(edit == NULL) {
+			return NULL;
+		}
+		memset(edit, 0, sizeof(_jsonEdit_t));
+		jsonObj->edit = edit;
+	}
+	if(edit->count == edit->capacity) {
+		size = (edit->capacity == 0) ? JSON_EDIT_OPS : edit->capacity * 2;
+		p = jsonObjRealloc(jsonObj, edit->op, sizeof(_jsonEditOp_t) * edit->capacity, sizeof(_jsonEditOp_t) * size);
+		if(p == NULL) {
+			return NULL;
+		}
+		edit->op = (_jsonEditOp_t*)p;
+		edit->capacity = (int)size;
+	}
+	if(edit->poolUsed + keyLen + len > edit->poolSize) {
+		for(size = (edit->poolSize == 0) ? JSON_EDIT_POOL : edit->poolSize; size < edit->poolUsed + keyLen + len; size *= 2);
+		p = jsonObjRealloc(jsonObj, edit->pool, edit->poolSize, size);
+		if(p == NULL) {
+			return NULL;
+		}
+		edit->pool = (char*)p;
+		edit->poolSize = size;
+	}
+
+	res = edit->op + edit->count++;
+	res->op = op;
+	res->token = token;
+	res->key = edit->poolUsed;
+	res->keyLen = keyLen;
+	if(keyLen > 0) {
+		memcpy(edit->pool + edit->poolUsed, key, keyLen);
+	}
+	res->text = edit->poolUsed + keyLen;
+	res->len = len;
+	if(len > 0) {
+		memcpy(edit->pool + res->text, text, len);
+	}
+	edit->poolUsed += keyLen + len;
+	return res;
+}
+
+// правка op для токена (последняя), NULL - нет
+static _jsonEditOp_t* findOp(_jsonObj_t *jsonObj, int op, _jsonOff_t token)
+{
+	int		i;
+
+	if(jsonObj->edit == NULL) {
+		return NULL;
+	}
+	for(i=jsonObj->edit->count - 1; i>=0; i--) {
+		if((jsonObj->edit->op[i].op == op) && (jsonObj->edit->op[i].token == token)) {
+			return jsonObj->edit->op + i;
+		}
+	}
+	return NULL;
+}
+
+// замена текста правки (старый текст остаётся в пуле до jsonEditFree)
+static bool replaceText(_jsonObj_t *jsonObj, _jsonEditOp_t *op, const char *text, size_t len)
+{
+	int				n = (int)(op - jsonObj->edit->op);
+	_jsonEditOp_t	*tmp = addOp(jsonObj, op->op, op->token, NULL, 0, text, len);
+
+	if(tmp == NULL) {
+		return false;
+	}
+	// пул и список могли переехать
+	op = jsonObj->edit->op + n;
+	op->text = tmp->text;
+	op->len = tmp->len;
+	jsonObj->edit->count--;
+	return true;
+}
+
+/* замена значения текстом json'а
+ * token			значение (в т.ч. объект/массив) или ключ - тогда заменяется его значение
+ * text, len		json значения, как есть (len == 0 - до завершающего нуля)
+ * return:			false - неверный токен или не хватило памяти
+*/
+bool jsonEditSet(_jsonObj_t *jsonObj, _jsonToken_t *token, const char *text, size_t len)
+{
+	_jsonEditOp_t	*op;
+	_jsonOff_t		id;
+
+	if(!validToken(jsonObj, token) || (text == NULL)) {
+		return false;
+	}
+	if(len == 0) {
+		len = strlen(text);
+	}
+	if(len == 0) {
+		return false;
+	}
+	if(token->type == JSON_KEY) {
+		id = jsonTokenFChild(jsonObj, token);
+		if(id == 0) {
+			return false;
+		}
+		token = jsonObj->token + id;
+	}
+	id = jsonTokenId(jsonObj, token);
+	if((op = findOp(jsonObj, JSON_EDIT_SET, id)) != NULL) {
+		return replaceText(jsonObj, op, text, len);
+	}
+	return addOp(jsonObj, JSON_EDIT_SET, id, NULL, 0, text, len) != NULL;
+}
+
+// строка json'а в двойных кавычках: размер (out == NULL) или запись
+static size_t quoteString(const char *str, size_t len, char *out)
+{
+	static const char	hex[] = "0123456789abcdef";
+	unsigned char		c;
+	size_t				pos = 0, i;
+	char				esc;
+
+	if(out != NULL) {
+		out[pos] = '"';
+	}
+	pos++;
+	for(i=0; i<len; i++) {
+		c = (unsigned char)str[i];
+		switch(c) {
+			case '"':	esc = '"';	break;
+			case '\\':	esc = '\\';	break;
+			case '\n':	esc = 'n';	break;
+			case '\r':	esc = 'r';	break;
+			case '\t':	esc = 't';	break;
+			case '\b':	esc = 'b';	break;
+			case '\f':	esc = 'f';	break;
+			default:	esc = (c < 0x20) ? 'u' : 0;
+		}
+		if(esc == 0) {
+			if(out != NULL) {
+				out[pos] = c;
+			}
+			pos++;
+		} else if(esc != 'u') {
+			if(out != NULL) {
+				out[pos] = '\\';
+				out[pos + 1] = esc;
+			}
+			pos += 2;
+		} else {
+			if(out != NULL) {
+				memcpy(out + pos, "\\u00", 4);
+				out[pos + 4] = hex[c >> 4];
+				out[pos + 5] = hex[c & 15];
+			}
+			pos += 6;
+		}
+	}
+	if(out != NULL) {
+		out[pos] = '"';
+	}
+	return pos + 1;
+}
+
+/* замена значения строкой
+ * str, len			строка как есть (len == 0 - до завершающего нуля), в json'е она берётся в кавычки и экранируется
+*/
+bool jsonEditSetString(_jsonObj_t *jsonObj, _jsonToken_t *token, const char *str, size_t len)
+{
+	char		*text;
+	size_t		size;
+	bool		res;
+
+	if(str == NULL) {
+		return false;
+	}
+	if(len == 0) {
+		len = strlen(str);
+	}
+	size = quoteString(str, len, NULL);
+	text = (char*)malloc(size);
+	if(text == NULL) {
+		return false;
+	}
+	quoteString(str, len, text);
+	res = jsonEditSet(jsonObj, token, text, size);
+	free(text);
+	return res;
+}
+
+// замена значения целым числом
+bool jsonEditSetInt(_jsonObj_t *jsonObj, _jsonToken_t *token, long long value)
+{
+	char	buff[24];
+
+	return jsonEditSet(jsonObj, token, buff, (size_t)snprintf(buff, sizeof(buff), "%lld", value));
+}
+
+/* новый ключ объекта (в конец объекта)
+ * object			объект или ключ, значение которого - объект
+ * key, keyLen		имя ключа без кавычек (keyLen == 0 - до завершающего нуля), экранируется при выводе
+ * text, len		json значения (len == 0 - до завершающего нуля)
+ * Если ключ в объекте уже есть (и не удалён) - заменяется его значение, повторная вставка того же
+ * ключа заменяет значение предыдущей
+*/
+bool jsonEditInsert(_jsonObj_t *jsonObj, _jsonToken_t *object, const char *key, size_t keyLen, const char *text, size_t len)
+{
+	_jsonToken_t	*exists;
+	_jsonEditOp_t	*op;
+	_jsonOff_t		id;
+	int				i;
+
+	if(!validToken(jsonObj, object) || (key == NULL) || (text == NULL)) {
+		return false;
+	}
+	if((object->type == JSON_KEY) && ((id = jsonTokenFChild(jsonObj, object)) != 0)) {
+		object = jsonObj->token + id;
+	}
+	if(object->type != JSON_OBJECT) {
+		return false;
+	}
+	if(keyLen == 0) {
+		keyLen = strlen(key);
+	}
+	if(len == 0) {
+		len = strlen(text);
+	}
+	if((keyLen == 0) || (len == 0)) {
+		return false;
+	}
+	id = jsonTokenId(jsonObj, object);
+
+	exists = jsonFindKey(jsonObj, object, key, (_jsonLen_t)keyLen);
+	if((exists != NULL) && (findOp(jsonObj, JSON_EDIT_REMOVE, jsonTokenId(jsonObj, exists)) == NULL)) {
+		return jsonEditSet(jsonObj, exists, text, len);
+	}
+	for(i=0; (jsonObj->edit != NULL) && (i<jsonObj->edit->count); i++) {
+		op = jsonObj->edit->op + i;
+		if((op->op == JSON_EDIT_INSERT) && (op->token == id) && (op->keyLen == keyLen) &&
+			(memcmp(jsonObj->edit->pool + op->key, key, keyLen) == 0))
+		{
+			return replaceText(jsonObj, op, text, len);
+		}
+	}
+	return addOp(jsonObj, JSON_EDIT_INSERT, id, key, keyLen, text, len) != NULL;
+}
+
+/* новый элемент в конец массива
+ * array			массив или ключ, значение которого - массив
+ * text, len		json элемента (len == 0 - до завершающего нуля)
+*/
+bool jsonEditAppend(_jsonObj_t *jsonObj, _jsonToken_t *array, const char *text, size_t len)
+{
+	_jsonOff_t	id;
+
+	if(!validToken(jsonObj, array) || (text == NULL)) {
+		return false;
+	}
+	if((array->type == JSON_KEY) && ((id = jsonTokenFChild(jsonObj, array)) != 0)) {
+		array = jsonObj->token + id;
+	}
+	if(array->type != JSON_ARRAY) {
+		return false;
+	}
+	if(len == 0) {
+		len = strlen(text);
+	}
+	if(len == 0) {
+		return false;
+	}
+	return addOp(jsonObj, JSON_EDIT_APPEND, jsonTokenId(jsonObj, array), NULL, 0, text, len) != NULL;
+}
+
+/* удаление ключа (вместе со значением) или элемента массива
+ * token			ключ, значение ключа (удаляется ключ) или элемент массива. Корень удалить нельзя
+*/
+bool jsonEditRemove(_jsonObj_t *jsonObj, _jsonToken_t *token)
+{
+	_jsonOff_t	id;
+
+	if(!validToken(jsonObj, token) || (token == jsonObj->token)) {
+		return false;
+	}
+	if((token->type != JSON_KEY) && ((jsonObj->token + token->parent)->type == JSON_KEY)) {
+		token = jsonObj->token + token->parent;
+	}
+	id = jsonTokenId(jsonObj, token);
+	if(findOp(jsonObj, JSON_EDIT_REMOVE, id) != NULL) {
+		return true;
+	}
+	return addOp(jsonObj, JSON_EDIT_REMOVE, id, NULL, 0, NULL, 0) != NULL;
+}
+
+// сброс всех правок
+void jsonEditFree(_jsonObj_t *jsonObj)
+{
+	if(jsonObj->edit == NULL) {
+		return;
+	}
+	if(jsonObj->edit->op != NULL) {
+		jsonObjFree(jsonObj, jsonObj->edit->op);
+	}
+	if(jsonObj->edit->pool != NULL) {
+		jsonObjFree(jsonObj, jsonObj->edit->pool);
+	}
+	jsonObjFree(jsonObj, jsonObj->edit);
+	jsonObj->edit = NULL;
+}
+
+static int patchCmp(const void *a, const void *b)
+{
+	const _patch_t	*x = (const _patch_t*)a, *y = (const _patch_t*)b;
+
+	if(x->start != y->start) {
+		return (x->start < y->start) ? -1 : 1;
+	}
+	if(x->end != y->end) {
+		return (x->end > y->end) ? -1 : 1;
+	}
+	return x->kind - y->kind;
+}
+
+/* участки вывода по списку правок: заменённые узлы и контейнеры с изменённым составом
+ * return:			кол-во участков, -1 - не хватило памяти или не найдена граница узла
+*/
+static int buildPatches(_jsonObj_t *jsonObj, _patch_t **res)
+{
+	_jsonEdit_t		*edit = jsonObj->edit;
+	_jsonEditOp_t	*op;
+	_patch_t		*patch;
+	_jsonOff_t		token;
+	int				i, j, count = 0;
+
+	*res = NULL;
+	if((edit == NULL) || (edit->count == 0)) {
+		return 0;
+	}
+	patch = (_patch_t*)malloc(sizeof(_patch_t) * edit->count);
+	if(patch == NULL) {
+		return -1;
+	}
+	for(i=0; i<edit->count; i++) {
+		op = edit->op + i;
+		token = op->token;
+		if(op->op == JSON_EDIT_REMOVE) {
+			// ключ или элемент: меняется состав его контейнера
+			token = (jsonObj->token + token)->parent;
+		}
+		if(op->op != JSON_EDIT_SET) {
+			for(j=0; (j<count) && ((patch[j].kind != JSON_EDIT_PATCH_STRUCT) || (patch[j].token != token)); j++);
+			if(j < count) {
+				continue;
+			}
+		}
+		if(!jsonTokenSpan(jsonObj, jsonObj->token + token, &patch[count].start, &patch[count].end)) {
+			free(patch);
+			return -1;
+		}
+		patch[count].token = token;
+		patch[count].kind = (op->op == JSON_EDIT_SET) ? JSON_EDIT_PATCH_SET : JSON_EDIT_PATCH_STRUCT;
+		patch[count].op = i;
+		count++;
+	}
+	qsort(patch, count, sizeof(_patch_t), patchCmp);
+	*res = patch;
+	return count;
+}
+
+static void renderContainer(_editOut_t *w, _patch_t *patch);
+
+/* участок исходного json'а [start, end): байты копируются, участки правок внутри выводятся заново
+ * Участок, начинающийся внутри уже выведенного, вложен в него и пропускается
+*/
+static void emitRange(_editOut_t *w, _jsonOff_t start, _jsonOff_t end)
+{
+	const char	*str = w->doc->json;
+	_jsonOff_t	pos = start;
+	int			lo = 0, hi = w->count, mid;
+	_patch_t	*p;
+
+	// первый участок с p->start >= start
+	while(lo < hi) {
+		mid = (lo + hi) / 2;
+		if(w->patch[mid].start < start) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	for(; (lo < w->count) && (w->patch[lo].start < end); lo++) {
+		p = w->patch + lo;
+		if(p->start < pos) {
+			continue;
+		}
+		put(w, str + pos, p->start - pos);
+		if(p->kind == JSON_EDIT_PATCH_SET) {
+			put(w, w->doc->edit->pool + w->doc->edit->op[p->op].text, w->doc->edit->op[p->op].len);
+		} else {
+			renderContainer(w, p);
+		}
+		pos = p->end;
+	}
+	put(w, str + pos, end - pos);
+}
+
+// хвост промежутка после последнего значимого символа (перевод строки и отступ)
+static _jsonOff_t spaceTail(const char *str, _jsonOff_t start, _jsonOff_t end)
+{
+	while((end > start) && ((str[end-1] == ' ') || (str[end-1] == '\t') || (str[end-1] == '\r') || (str[end-1] == '\n'))) {
+		end--;
+	}
+	return end;
+}
+
+/* границы элемента контейнера: ключ (с кавычками) вместе со значением / элемент массива
+ * valStart			OUT начало значения (для ключа)
+*/
+static bool memberSpan(_jsonObj_t *jsonObj, _jsonToken_t *member, _jsonOff_t *start, _jsonOff_t *end, _jsonOff_t *valStart)
+{
+	const char	*str = jsonObj->json;
+	_jsonOff_t	id, s;
+
+	if(member->type != JSON_KEY) {
+		if(!jsonTokenSpan(jsonObj, member, start, end)) {
+			return false;
+		}
+		*valStart = *start;
+		return true;
+	}
+	id = jsonTokenFChild(jsonObj, member);
+	if((id == 0) || !jsonTokenSpan(jsonObj, jsonObj->token + id, valStart, end)) {
+		return false;
+	}
+	s = member->start;
+	if((s > 0) && ((str[s-1] == '"') || (str[s-1] == '\''))) {
+		s--;
+	}
+	*start = s;
+	return true;
+}
+
+/* контейнер с изменённым составом
+ * Оставшиеся элементы выводятся со своими исходными промежутками (запятая, пробелы, комментарии перед
+ * элементом), первый - с промежутком после открывающей скобки. Новые элементы добавляются в конец с тем же
+ * отступом, что у последнего исходного, затем - исходный промежуток перед закрывающей скобкой
+*/
+static void renderContainer(_editOut_t *w, _patch_t *patch)
+{
+	_jsonObj_t		*doc = w->doc;
+	const char		*str = doc->json, *pool = doc->edit->pool;
+	_jsonToken_t	*container = doc->token + patch->token, *member;
+	_jsonEditOp_t	*op;
+	_jsonOff_t		id, ms, me, vs, prevEnd = patch->start + 1, close = patch->end - 1;
+	_jsonOff_t		lead = close, gapStart = patch->start + 1, gapEnd = patch->start + 1, colon = -1, colonEnd = -1;
+	int				orig = 0, emitted = 0, i;
+
+	put(w, str + patch->start, 1);
+	for(id = jsonTokenFChild(doc, container); id != 0; id = member->nextToken) {
+		member = doc->token + id;
+		if(!memberSpan(doc, member, &ms, &me, &vs)) {
+			// граница не найдена (не бывает для разобранного json'а): элемент как есть
+			ms = prevEnd;
+			me = prevEnd;
+		}
+		if(orig == 0) {
+			lead = ms;
+			if(member->type == JSON_KEY) {
+				colon = member->end + (((str[member->end] == '"') || (str[member->end] == '\'')) ? 1 : 0);
+				colonEnd = vs;
+			}
+		}
+		// промежуток перед последним исходным элементом - образец для новых
+		gapStart = prevEnd;
+		gapEnd = ms;
+		orig++;
+		if(findOp(doc, JSON_EDIT_REMOVE, id) == NULL) {
+			if(emitted == 0) {
+				put(w, str + patch->start + 1, lead - patch->start - 1);
+			} else {
+				put(w, str + prevEnd, ms - prevEnd);
+			}
+			emitRange(w, ms, me);
+			emitted++;
+		}
+		prevEnd = me;
+	}
+	if(orig == 1) {
+		gapStart = patch->start + 1;
+		gapEnd = lead;
+	}
+
+	for(i=0; i<doc->edit->count; i++) {
+		op = doc->edit->op + i;
+		if(((op->op != JSON_EDIT_INSERT) && (op->op != JSON_EDIT_APPEND)) || (op->token != patch->token)) {
+			continue;
+		}
+		if(emitted == 0) {
+			if(orig > 0) {
+				put(w, str + patch->start + 1, lead - patch->start - 1);
+			}
+		} else {
+			put(w, ",", 1);
+			ms = spaceTail(str, gapStart, gapEnd);
+			put(w, str + ms, gapEnd - ms);
+		}
+		if(op->op == JSON_EDIT_INSERT) {
+			w->pos += quoteString(pool + op->key, op->keyLen, (w->out != NULL) ? w->out + w->pos : NULL);
+			if(colon >= 0) {
+				put(w, str + colon, colonEnd - colon);
+			} else {
+				put(w, ":", 1);
+			}
+		}
+		put(w, pool + op->text, op->len);
+		emitted++;
+	}
+
+	if((emitted > 0) || (orig == 0)) {
+		put(w, str + prevEnd, close - prevEnd);
+	}
+	put(w, str + close, 1);
+}
+
+// вывод документа с правками
+static size_t editWrite(_jsonObj_t *jsonObj, char *out)
+{
+	_editOut_t	w;
+	size_t		len = jsonObj->len;
+
+	w.doc = jsonObj;
+	w.out = out;
+	w.pos = 0;
+	w.count = buildPatches(jsonObj, &w.patch);
+	if(w.count < 0) {
+		return (size_t)-1;
+	}
+	emitRange(&w, 0, (_jsonOff_t)len);
+	free(w.patch);
+	return w.pos;
+}
+
+/* точный размер документа с правками (без завершающего нуля)
+ * return:			(size_t)-1 - не хватило памяти
+*/
+size_t jsonEditWriteSize(_jsonObj_t *jsonObj)
+{
+	return editWrite(jsonObj, NULL);
+}
+
+/* документ с правками в буфер клиента
+ * buff				буфер не менее jsonEditWriteSize() + 1 байт (результат завершается нулём)
+ * return:			длина результата, (size_t)-1 - не хватило памяти
+*/
+size_t jsonEditWriteTo(_jsonObj_t *jsonObj, char *buff)
+{
+	size_t	len = editWrite(jsonObj, buff);
+
+	if(len != (size_t)-1) {
+		buff[len] = 0;
+	}
+	return len;
+}
+
+/* документ с правками в новый буфер
+ * Нетронутые участки исходного json'а копируются как есть, без правок результат совпадает с исходным json'ом
+ * len				OUT длина результата (может быть NULL)
+ * return:			строка (освобождается free) или NULL - не хватило памяти
+*/
+char* jsonEditWrite(_jsonObj_t *jsonObj, size_t *len)
+{
+	size_t	size = jsonEditWriteSize(jsonObj);
+	char	*buff;
+
+	if(size == (size_t)-1) {
+		return NULL;
+	}
+	buff = (char*)malloc(size + 1);
+	if(buff == NULL) {
+		return NULL;
+	}
+	size = jsonEditWriteTo(jsonObj, buff);
+	if(len != NULL) {
+		*len = size;
+	}
+	return buff;
+}
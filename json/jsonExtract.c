@@ -0,0 +1,499 @@
+/* targeted path extraction for dirty json parser
+ * Avinfors, O.Nikitin
+ *
+ * Упоротость и отвага!
+*/
+
+/* Выборка по набору путей без построения дерева токенов
+ * Документ проходится рекурсивным спуском только по узлам, которые лежат на одном из путей.
+ * Остальные поддеревья пропускаются сканированием скобок (SSE2): без токенов и без валидации.
+ * Разбор заканчивается, как только найдены все пути, поэтому время зависит от того, где в json'е
+ * лежат нужные поля, а не от размера документа
+ *
+ * Результат каждого пути - _jsonView_t, как у jsonTokenView: у строк без кавычек, у объектов и массивов
+ * от открывающей до закрывающей скобки. Ключи сравниваются побайтно, без декодирования escape-последовательностей.
+ * При повторяющихся ключах берётся первый. Поддерживаются шаги "ключ" и "номер элемента":
+ * путь с * или [*] не находится никогда (такой запрос - к jsonPathExec по полному разбору)
+ *
+ * Проверяется только то, что разбирается: в пропущенных поддеревьях ищутся лишь строки, комментарии и
+ * баланс скобок. Документ, принятый jsonExtract, может не пройти jsonParser
+ *
+ *	_jsonPath_t	*paths[3] = {jsonPathCompile("type"), jsonPathCompile("derivation"), jsonPathCompile("version")};
+ *	_jsonView_t	res[3];
+ *	if(jsonExtract(str, 0, paths, 3, res) < 0) ... getLastError()
+ *	if(res[0].type != 0) ... printf("%.*s", (int)res[0].len, res[0].ptr)
+*/
+
+#include "json.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+typedef struct
+{
+	const char		*str;
+	_jsonOff_t		len;
+	_jsonPath_t		**paths;
+	_jsonView_t		*res;
+	int				remaining;		// кол-во ещё не найденных путей
+	_jsonOff_t		errPos;			// позиция ошибки (-1 - ошибки нет)
+	int				err;
+} _extract_t;
+
+static _jsonOff_t walkValue(_extract_t *ex, _jsonOff_t pos, int *act, int nAct, int depth);
+
+// ошибка с позицией: строка и колонка считаются только здесь
+static _jsonOff_t fail(_extract_t *ex, _jsonOff_t pos, int err)
+{
+	if(ex->errPos < 0) {
+		ex->errPos = (pos < ex->len) ? pos : ex->len;
+		ex->err = err;
+	}
+	return -1;
+}
+
+// первый из символов a, b начиная с pos (или len)
+static inline _jsonOff_t findAny2(const char *str, _jsonOff_t pos, _jsonOff_t len, char a, char b)
+{
+#if defined(__SSE2__)
+	const __m128i	va = _mm_set1_epi8(a), vb = _mm_set1_epi8(b);
+	__m128i			v;
+	int				m;
+
+	while(len - pos >= 16) {
+		v = _mm_loadu_si128((const __m128i*)(str + pos));
+		m = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+		if(m != 0) {
+			return pos + __builtin_ctz(m);
+		}
+		pos += 16;
+	}
+#endif
+	while((pos < len) && (str[pos] != a) && (str[pos] != b)) {
+		pos++;
+	}
+	return pos;
+}
+
+// строка в кавычках (pos - на открывающей), возврат - позиция за закрывающей
+static _jsonOff_t skipString(_extract_t *ex, _jsonOff_t pos)
+{
+	char		q = ex->str[pos];
+	_jsonOff_t	start = pos;
+
+	pos++;
+	for(;;) {
+		pos = findAny2(ex->str, pos, ex->len, q, '\\');
+		if(pos >= ex->len) {
+			return fail(ex, start, JSON_ERR_UNEXPECTED_END);
+		}
+		if(ex->str[pos] == q) {
+			return pos + 1;
+		}
+		pos += 2;
+	}
+}
+
+// комментарий (pos - на '/'), возврат - позиция за ним; одиночный '/' - не комментарий, pos + 1
+static _jsonOff_t skipComment(_extract_t *ex, _jsonOff_t pos)
+{
+	_jsonOff_t	start = pos;
+
+	if(ex->str[pos+1] == '/') {
+		pos = findAny2(ex->str, pos + 2, ex->len, '\n', '\n');
+		return (pos < ex->len) ? pos + 1 : pos;
+	}
+	if(ex->str[pos+1] == '*') {
+		for(pos += 2; ; pos++) {
+			pos = findAny2(ex->str, pos, ex->len, '*', '*');
+			if(pos + 1 >= ex->len) {
+				return fail(ex, start, JSON_ERR_UNEXPECTED_END);
+			}
+			if(ex->str[pos+1] == '/') {
+				return pos + 2;
+			}
+		}
+	}
+	return pos + 1;
+}
+
+// пробелы, комментарии и (sep == true) запятые
+static _jsonOff_t skipSpace(_extract_t *ex, _jsonOff_t pos, bool sep)
+{
+	const char	*str = ex->str;
+
+	while(pos < ex->len) {
+		switch(str[pos]) {
+			case ' ': case '\t': case '\r': case '\n':
+				pos++;
+				break;
+			case ',':
+				if(!sep) {
+					return pos;
+				}
+				pos++;
+				break;
+			case '/':
+				if((str[pos+1] != '/') && (str[pos+1] != '*')) {
+					return pos;
+				}
+				pos = skipComment(ex, pos);
+				if(pos < 0) {
+					return -1;
+				}
+				break;
+			default:
+				return pos;
+		}
+	}
+	return pos;
+}
+
+/* остаток контейнера (pos - за открывающей скобкой или внутри), возврат - позиция за закрывающей
+ * Ищутся только скобки, кавычки и '/': (c | 0x20) совмещает [ с { и ] с }
+*/
+static _jsonOff_t skipContainer(_extract_t *ex, _jsonOff_t pos)
+{
+	const char	*str = ex->str;
+	_jsonOff_t	start = pos;
+	int			depth = 1;
+	char		c;
+
+	while(depth > 0) {
+#if defined(__SSE2__)
+		const __m128i	low = _mm_set1_epi8(0x20), open = _mm_set1_epi8('{'), close = _mm_set1_epi8('}'),
+						dq = _mm_set1_epi8('"'), sq = _mm_set1_epi8('\''), sl = _mm_set1_epi8('/');
+		__m128i			v, l;
+		int				m = 0;
+
+		while(ex->len - pos >= 16) {
+			v = _mm_loadu_si128((const __m128i*)(str + pos));
+			l = _mm_or_si128(v, low);
+			m = _mm_movemask_epi8(_mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(l, open), _mm_cmpeq_epi8(l, close)),
+				_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, dq), _mm_cmpeq_epi8(v, sq)), _mm_cmpeq_epi8(v, sl))));
+			if(m != 0) {
+				pos += __builtin_ctz(m);
+				break;
+			}
+			pos += 16;
+		}
+		if(m == 0)
+#endif
+		{
+			while((pos < ex->len) && ((c = str[pos] | 0x20) != '{') && (c != '}') &&
+				(str[pos] != '"') && (str[pos] != '\'') && (str[pos] != '/')) {
+				pos++;
+			}
+		}
+		if(pos >= ex->len) {
+			return fail(ex, start, JSON_ERR_UNEXPECTED_END);
+		}
+		switch(str[pos]) {
+			case '{': case '[':
+				depth++;
+				pos++;
+				break;
+			case '}': case ']':
+				depth--;
+				pos++;
+				break;
+			case '"': case '\'':
+				pos = skipString(ex, pos);
+				break;
+			case '/':
+				pos = skipComment(ex, pos);
+				break;
+		}
+		if(pos < 0) {
+			return -1;
+		}
+	}
+	return pos;
+}
+
+// конец значения без кавычек (число, true/false/null, ключ без кавычек)
+static inline _jsonOff_t scalarEnd(_extract_t *ex, _jsonOff_t pos, bool key)
+{
+	const char	*str = ex->str;
+
+	while(pos < ex->len) {
+		switch(str[pos]) {
+			case ' ': case '\t': case '\r': case '\n':
+			case ',': case '}': case ']': case '{': case '[':
+				return pos;
+			case ':':
+				if(key) {
+					return pos;
+				}
+				break;
+			case '/':
+				if((str[pos+1] == '/') || (str[pos+1] == '*')) {
+					return pos;
+				}
+				break;
+		}
+		pos++;
+	}
+	return pos;
+}
+
+// тип значения без кавычек, как его определяет парсер (JSON_VALUE_NOT_VALUE - строка без кавычек)
+static _jsonValueType_t scalarType(const char *p, _jsonOff_t len)
+{
+	_jsonValueType_t	type = JSON_VALUE_INT;
+	_jsonOff_t			i = 0;
+
+	if((len == 4) && (memcmp(p, "null", 4) == 0)) {
+		return JSON_VALUE_NULL;
+	}
+	if(((len == 4) && (memcmp(p, "true", 4) == 0)) || ((len == 5) && (memcmp(p, "false", 5) == 0))) {
+		return JSON_VALUE_BOOL;
+	}
+	if((len > 0) && (p[0] == '-')) {
+		i++;
+	}
+	if((i >= len) || (p[i] < '0') || (p[i] > '9')) {
+		return JSON_VALUE_NOT_VALUE;
+	}
+	for(; i<len; i++) {
+		if(p[i] == '.') {
+			if(type == JSON_VALUE_FLOAT) {
+				return JSON_VALUE_NOT_VALUE;
+			}
+			type = JSON_VALUE_FLOAT;
+		} else if((p[i] < '0') || (p[i] > '9')) {
+			return JSON_VALUE_NOT_VALUE;
+		}
+	}
+	return type;
+}
+
+// шаг depth пути i применим к элементу контейнера (ключу key/keyLen или элементу номер index)
+static inline bool stepMatch(_extract_t *ex, int i, int depth, const char *key, _jsonOff_t keyLen, _jsonOff_t index)
+{
+	_jsonPath_t		*path = ex->paths[i];
+	_jsonPathStep_t	*step = path->step + depth;
+
+	if(key != NULL) {
+		return (step->op == JSON_PATH_KEY) && (step->len == keyLen) && (memcmp(path->keys + step->key, key, keyLen) == 0);
+	}
+	return (step->op == JSON_PATH_INDEX) && (step->len == index);
+}
+
+/* элементы объекта или массива (pos - на открывающей скобке)
+ * act/nAct - пути, ещё не найденные в этом поддереве, у всех следующий шаг - depth
+*/
+static _jsonOff_t walkContainer(_extract_t *ex, _jsonOff_t pos, int *act, int nAct, int depth)
+{
+	const char		*str = ex->str;
+	bool			object = (str[pos] == '{');
+	char			close = object ? '}' : ']';
+	const char		*key = NULL;
+	_jsonOff_t		keyLen = 0, index = 0, end;
+	_jsonPathStep_t	*step;
+	int				child[nAct], nChild, i, live;
+
+	pos++;
+	for(;;) {
+		pos = skipSpace(ex, pos, true);
+		if(pos < 0) {
+			return -1;
+		}
+		if(pos >= ex->len) {
+			return fail(ex, pos, JSON_ERR_UNEXPECTED_END);
+		}
+		if(str[pos] == close) {
+			return pos + 1;
+		}
+		if(object) {
+			// ключ в кавычках или без
+			if((str[pos] == '"') || (str[pos] == '\'')) {
+				end = skipString(ex, pos);
+				if(end < 0) {
+					return -1;
+				}
+				key = str + pos + 1;
+				keyLen = end - pos - 2;
+			} else {
+				end = scalarEnd(ex, pos, true);
+				if(end == pos) {
+					return fail(ex, pos, JSON_ERR_UNEXPECTED_SYMBOL);
+				}
+				key = str + pos;
+				keyLen = end - pos;
+			}
+			pos = skipSpace(ex, end, false);
+			if(pos < 0) {
+				return -1;
+			}
+			if((pos >= ex->len) || (str[pos] != ':')) {
+				return fail(ex, pos, (pos >= ex->len) ? JSON_ERR_UNEXPECTED_END : JSON_ERR_SINGLE_KEY);
+			}
+			pos = skipSpace(ex, pos + 1, false);
+			if(pos < 0) {
+				return -1;
+			}
+			if((pos >= ex->len) || (str[pos] == close) || (str[pos] == ',')) {
+				return fail(ex, pos, (pos >= ex->len) ? JSON_ERR_UNEXPECTED_END : JSON_ERR_SINGLE_KEY);
+			}
+		}
+
+		// пути, идущие в этот элемент (при повторном ключе найденные по первому уже не ищутся)
+		nChild = 0;
+		live = 0;
+		for(i=0; i<nAct; i++) {
+			// найденные раньше и те, что заканчиваются на самом контейнере
+			if((ex->res[act[i]].type != 0) || (ex->paths[act[i]]->count <= depth)) {
+				continue;
+			}
+			// ключ в массиве и уже пройденный номер элемента найтись не могут
+			step = ex->paths[act[i]]->step + depth;
+			if(object ? (step->op != JSON_PATH_KEY) : ((step->op != JSON_PATH_INDEX) || (step->len < index))) {
+				continue;
+			}
+			live++;
+			if(stepMatch(ex, act[i], depth, key, keyLen, index)) {
+				child[nChild++] = act[i];
+			}
+		}
+		if(live == 0) {
+			// в этом поддереве искать больше нечего: конец контейнера нужен только родителю
+			return skipContainer(ex, pos);
+		}
+		pos = walkValue(ex, pos, child, nChild, depth + 1);
+		if((pos < 0) || (ex->remaining == 0)) {
+			return pos;
+		}
+		index++;
+	}
+}
+
+/* значение (pos - на его первом символе)
+ * Пути из act, у которых шагов depth, найдены в этом значении; остальные ищутся в его элементах
+*/
+static _jsonOff_t walkValue(_extract_t *ex, _jsonOff_t pos, int *act, int nAct, int depth)
+{
+	const char		*str = ex->str;
+	_jsonOff_t		start = pos, end;
+	_jsonView_t		view;
+	int				i, descend = 0;
+
+	for(i=0; i<nAct; i++) {
+		if(ex->paths[act[i]]->count > depth) {
+			descend++;
+		}
+	}
+	switch(str[pos]) {
+		case '{': case '[':
+			view.type = (str[pos] == '{') ? JSON_OBJECT : JSON_ARRAY;
+			view.valueType = JSON_VALUE_NOT_VALUE;
+			end = (descend > 0) ? walkContainer(ex, pos, act, nAct, depth) : skipContainer(ex, pos + 1);
+			if((end < 0) || (ex->remaining == 0)) {
+				return end;
+			}
+			break;
+		case '"': case '\'':
+			end = skipString(ex, pos);
+			if(end < 0) {
+				return -1;
+			}
+			view.type = JSON_VALUE;
+			view.valueType = JSON_VALUE_STRING;
+			start++;
+			end--;
+			break;
+		default:
+			end = scalarEnd(ex, pos, false);
+			view.type = JSON_VALUE;
+			view.valueType = scalarType(str + pos, end - pos);
+			if(view.valueType == JSON_VALUE_NOT_VALUE) {
+				return fail(ex, pos, (end == pos) ? JSON_ERR_UNEXPECTED_SYMBOL : JSON_ERR_STRING_WITHOUT_QUOTA);
+			}
+	}
+	view.ptr = str + start;
+	view.len = end - start;
+	for(i=0; i<nAct; i++) {
+		if((ex->paths[act[i]]->count == depth) && (ex->res[act[i]].type == 0)) {
+			ex->res[act[i]] = view;
+			ex->remaining--;
+		}
+	}
+	return (view.valueType == JSON_VALUE_STRING) ? end + 1 : end;
+}
+
+// выборка по путям (контекст потока по умолчанию), см. jsonExtract_r
+int jsonExtract(const char *str, _jsonLen_t len, _jsonPath_t **paths, int count, _jsonView_t *res)
+{
+	return jsonExtract_r(str, len, paths, count, res, jsonDefaultCtx());
+}
+
+/* выборка значений по набору путей без полного разбора
+ * str, len			json (len == 0 - до завершающего нуля)
+ * paths, count		скомпилированные пути (jsonPathCompile)
+ * res				OUT результаты по путям; у ненайденных type == 0
+ * ctx				контекст для ошибки (см. jsonParser_r)
+ * return:			кол-во найденных путей, -1 - invalid json на пройденном участке (ошибка - в ctx)
+*/
+int jsonExtract_r(const char *str, _jsonLen_t len, _jsonPath_t **paths, int count, _jsonView_t *res, _jsonCtx_t *ctx)
+{
+	_extract_t		ex;
+	_jsonOff_t		pos, i, line = 1, col = 1;
+	int				act[count > 0 ? count : 1], nAct = 0, n;
+
+	if(len == 0) {
+		len = strlen(str);
+	}
+	if(len > (_jsonLen_t)JSON_OFF_MAX) {
+		setError(ctx, 1, 1, '.', JSON_ERR_NO_MEMORY);
+		return -1;
+	}
+	ex.str = str;
+	ex.len = len;
+	ex.paths = paths;
+	ex.res = res;
+	ex.remaining = 0;
+	ex.errPos = -1;
+	ex.err = JSON_ERR_NO_ERROR;
+	for(n=0; n<count; n++) {
+		memset(res + n, 0, sizeof(_jsonView_t));
+		if(paths[n] == NULL) {
+			continue;
+		}
+		// пути с * и [*] не ищутся
+		for(i=0; (i < paths[n]->count) && (paths[n]->step[i].op != JSON_PATH_ANY_KEY) && (paths[n]->step[i].op != JSON_PATH_ANY_INDEX); i++);
+		if(i == paths[n]->count) {
+			act[nAct++] = n;
+		}
+	}
+	ex.remaining = nAct;
+	if(nAct == 0) {
+		return 0;
+	}
+
+	// корень - только объект или массив (как у jsonParser)
+	pos = skipSpace(&ex, 0, false);
+	if(pos >= 0) {
+		if(pos >= ex.len) {
+			pos = fail(&ex, pos, JSON_ERR_UNEXPECTED_END);
+		} else if((str[pos] != '{') && (str[pos] != '[')) {
+			pos = fail(&ex, pos, JSON_ERR_UNEXPECTED_SYMBOL);
+		} else {
+			pos = walkValue(&ex, pos, act, nAct, 0);
+		}
+	}
+	if(pos < 0) {
+		for(i=0; i<ex.errPos; i++) {
+			if(str[i] == '\n') {
+				line++;
+				col = 1;
+			} else {
+				col++;
+			}
+		}
+		setError(ctx, line, col, str[ex.errPos], ex.err);
+		return -1;
+	}
+	return nAct - ex.remaining;
+}
@@ -0,0 +1,79 @@
+/* memory-mapped file input for dirty json parser
+ * Avinfors, O.Nikitin
+ *
+ * Упоротость и отвага!
+*/
+
+/* Разбор файла без чтения в буфер: файл отображается в память (только чтение) и разбирается на месте.
+ * Страницы подгружаются ядром по мере прохода парсера (MADV_SEQUENTIAL - упреждающее чтение,
+ * прочитанные страницы можно вытеснять), поэтому большой файл не копируется и не держится в памяти целиком.
+ * Отображение живёт вместе с документом и снимается clearFlatJsonObj / jsonDocFree
+ *
+ * Парсер заглядывает на несколько байт вперёд (литералы, начало комментария), поэтому за концом файла
+ * отображается ещё одна нулевая страница: читать "за файлом" безопасно при любом его размере
+ *
+ * Файлы больше 2 Гб - только при сборке с JSON_OFFSET_64
+*/
+
+#include "json.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// разбор файла (контекст потока по умолчанию), см. jsonParseFile_r
+int jsonParseFile(const char *fileName, _jsonObj_t **jsonObj)
+{
+	return jsonParseFile_r(fileName, jsonObj, jsonDefaultCtx());
+}
+
+/* разбор файла
+ * fileName			IN  имя файла
+ * jsonObj			OUT неинициализированный указатель на _jsonObj_t (освобождается clearFlatJsonObj)
+ * ctx				IN  контекст (см. jsonParser_r)
+ * return:			0 - успех, 1 - ошибка (JSON_ERR_FILE - файл не прочитан, остальные - см. jsonParser)
+ * При ошибке открытия/отображения файла *jsonObj == NULL
+*/
+int jsonParseFile_r(const char *fileName, _jsonObj_t **jsonObj, _jsonCtx_t *ctx)
+{
+	struct stat		st;
+	size_t			size, page = (size_t)sysconf(_SC_PAGESIZE);
+	char			*map;
+	int				fh;
+
+	*jsonObj = NULL;
+	fh = open(fileName, O_RDONLY);
+	if(fh < 0) {
+		setError(ctx, 0, 1, '.', JSON_ERR_FILE);
+		return 1;
+	}
+	if((fstat(fh, &st) != 0) || ((unsigned long long)st.st_size > (unsigned long long)JSON_OFF_MAX)) {
+		close(fh);
+		setError(ctx, 0, 1, '.', JSON_ERR_FILE);
+		return 1;
+	}
+
+	// резерв: файл + нулевая страница, затем файл поверх начала резерва
+	size = ((size_t)st.st_size + page) & ~(page - 1);
+	map = (char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(map == MAP_FAILED) {
+		close(fh);
+		setError(ctx, 0, 1, '.', JSON_ERR_FILE);
+		return 1;
+	}
+	if((st.st_size > 0) && (mmap(map, st.st_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fh, 0) == MAP_FAILED)) {
+		munmap(map, size);
+		close(fh);
+		setError(ctx, 0, 1, '.', JSON_ERR_FILE);
+		return 1;
+	}
+	close(fh);
+	madvise(map, size, MADV_SEQUENTIAL);
+
+	*jsonObj = (_jsonObj_t*)malloc(sizeof(_jsonObj_t));
+	jsonDocInit(*jsonObj, NULL);
+	(*jsonObj)->map = map;
+	(*jsonObj)->mapSize = size;
+	// пустой файл: длина 0 - до завершающего нуля, т.е. пустая строка
+	return jsonDocParse(*jsonObj, map, (_jsonLen_t)st.st_size, ctx);
+}
@@ -0,0 +1,236 @@
+/* child index for dirty json parser
+ * Avinfors, O.Nikitin
+ *
+ * Упоротость и отвага!
+*/
+
+/* Индекс дочерних узлов контейнеров
+ * Без индекса поиск ключа и элемента массива - проход по цепочке nextToken, O(ширина узла).
+ * Индекс строится одним проходом по массиву токенов (явно jsonBuildIndex или лениво при первом
+ * вызове jsonIndexKey/jsonIndexAt - кроме документов, общих для потоков, см. jsonCacheGet) и даёт:
+ *  - для массивов: плотную таблицу id элементов, элемент по номеру - O(1)
+ *  - для объектов от JSON_INDEX_MIN_KEYS ключей: хэш-таблицу id ключей (открытая адресация), поиск - O(1)
+ * Маленькие объекты таблицы не получают: линейный проход по ним не медленнее хэширования
+ * Вся память индекса - один блок, распределённый через аллокатор документа
+*/
+
+#include "json.h"
+
+#define				JSON_INDEX_MIN_KEYS		(int)	8
+
+// хэш имени ключа (FNV-1a)
+static unsigned int keyHash(const char *key, _jsonLen_t len)
+{
+	unsigned int	h = 2166136261u;
+	_jsonLen_t		i;
+
+	for(i=0; i<len; i++) {
+		h ^= (unsigned char)key[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+// размер хэш-таблицы объекта с count ключами: степень двойки, заполнение не более 50%
+static _jsonOff_t tableSize(_jsonOff_t count)
+{
+	_jsonOff_t	size = 16;
+
+	while(size < (count << 1)) {
+		size <<= 1;
+	}
+	return size;
+}
+
+// построение индекса (контекст потока по умолчанию), см. jsonBuildIndex_r
+bool jsonBuildIndex(_jsonObj_t *jsonObj)
+{
+	return jsonBuildIndex_r(jsonObj, jsonDefaultCtx());
+}
+
+/* построение индекса
+ * ctx				контекст для статистики (см. jsonStats_r)
+ * return:			false - не хватило памяти
+*/
+bool jsonBuildIndex_r(_jsonObj_t *jsonObj, _jsonCtx_t *ctx)
+{
+	_jsonIndex_t	*index;
+	_jsonToken_t	*token, *child;
+	_jsonOff_t		i, n, dataCount = 0, *slot;
+	_jsonOff_t		count = (jsonObj->count > 0) ? jsonObj->count : 1;	// у пустого корня count == 0
+	_jsonLen_t		mask, h;
+
+	if(jsonObj->index != NULL) {
+		return true;
+	}
+	JSON_STATS_START(t);
+
+	// 1й проход: размеры таблиц
+	for(i=0; i<count; i++) {
+		token = jsonObj->token + i;
+		if((token->type != JSON_OBJECT) && (token->type != JSON_ARRAY)) {
+			continue;
+		}
+		n = jsonChildCount(jsonObj, token);
+		if(token->type == JSON_ARRAY) {
+			dataCount += n;
+		} else if(n >= JSON_INDEX_MIN_KEYS) {
+			dataCount += tableSize(n);
+		}
+	}
+
+	index = (_jsonIndex_t*)jsonObjAlloc(jsonObj, sizeof(_jsonIndex_t) + sizeof(_jsonOff_t) * (2 * count + dataCount));
+	if(index == NULL) {
+		return false;
+	}
+	index->table = (_jsonOff_t*)(index + 1);
+	index->size = index->table + count;
+	index->data = index->size + count;
+
+	// 2й проход: заполнение
+	dataCount = 0;
+	for(i=0; i<count; i++) {
+		token = jsonObj->token + i;
+		index->table[i] = -1;
+		index->size[i] = 0;
+		if((token->type != JSON_OBJECT) && (token->type != JSON_ARRAY)) {
+			continue;
+		}
+		if(token->type == JSON_ARRAY) {
+			index->table[i] = dataCount;
+			for(n=jsonTokenFChild(jsonObj, token); n != 0; n=(jsonObj->token + n)->nextToken) {
+				index->data[dataCount++] = n;
+				index->size[i]++;
+			}
+			continue;
+		}
+		n = jsonChildCount(jsonObj, token);
+		if(n < JSON_INDEX_MIN_KEYS) {
+			continue;
+		}
+		index->table[i] = dataCount;
+		index->size[i] = tableSize(n);
+		mask = index->size[i] - 1;
+		slot = index->data + dataCount;
+		memset(slot, 0, sizeof(_jsonOff_t) * index->size[i]);
+		for(n=jsonTokenFChild(jsonObj, token); n != 0; n=(jsonObj->token + n)->nextToken) {
+			child = jsonObj->token + n;
+			h = keyHash(jsonObj->json + child->start, child->end - child->start) & mask;
+			// при повторяющихся ключах остаётся первый (как при проходе по цепочке)
+			while(slot[h] != 0) {
+				_jsonToken_t *other = jsonObj->token + slot[h];
+				if(((other->end - other->start) == (child->end - child->start)) &&
+					(memcmp(jsonObj->json + other->start, jsonObj->json + child->start, child->end - child->start) == 0)) {
+					break;
+				}
+				h = (h + 1) & mask;
+			}
+			if(slot[h] == 0) {
+				slot[h] = n;
+			}
+		}
+		dataCount += index->size[i];
+	}
+
+	jsonObj->index = index;
+	JSON_STATS_PHASE(ctx, JSON_STATS_INDEX, t);
+	return true;
+}
+
+// освобождение индекса (индекс также освобождается jsonDocFree и при повторном разборе документа)
+void jsonFreeIndex(_jsonObj_t *jsonObj)
+{
+	if(jsonObj->index != NULL) {
+		jsonObjFree(jsonObj, jsonObj->index);
+		jsonObj->index = NULL;
+	}
+}
+
+/* поиск ключа в объекте
+ * object			токен объекта
+ * key, keyLen		имя ключа (без кавычек)
+ * return:			токен ключа (значение - его fChild) или NULL
+ * Использует индекс, если он построен, иначе - проход по ключам объекта
+*/
+_jsonToken_t* jsonFindKey(_jsonObj_t *jsonObj, _jsonToken_t *object, const char *key, _jsonLen_t keyLen)
+{
+	_jsonToken_t	*token;
+	_jsonOff_t		id = object - jsonObj->token, *slot, n;
+	_jsonLen_t		mask, h;
+
+	if(object->type != JSON_OBJECT) {
+		return NULL;
+	}
+	if((jsonObj->index != NULL) && (jsonObj->index->table[id] >= 0)) {
+		slot = jsonObj->index->data + jsonObj->index->table[id];
+		mask = jsonObj->index->size[id] - 1;
+		for(h = keyHash(key, keyLen) & mask; slot[h] != 0; h = (h + 1) & mask) {
+			token = jsonObj->token + slot[h];
+			if(((_jsonLen_t)(token->end - token->start) == keyLen) && (memcmp(jsonObj->json + token->start, key, keyLen) == 0)) {
+				return token;
+			}
+		}
+		return NULL;
+	}
+	for(n=jsonTokenFChild(jsonObj, object); n != 0; n=token->nextToken) {
+		token = jsonObj->token + n;
+		if(((_jsonLen_t)(token->end - token->start) == keyLen) && (memcmp(jsonObj->json + token->start, key, keyLen) == 0)) {
+			return token;
+		}
+	}
+	return NULL;
+}
+
+/* элемент массива по номеру
+ * return:			токен элемента или NULL
+ * Использует индекс, если он построен, иначе - проход по элементам массива
+*/
+_jsonToken_t* jsonArrayAt(_jsonObj_t *jsonObj, _jsonToken_t *array, _jsonOff_t n)
+{
+	_jsonOff_t	id = array - jsonObj->token, i;
+
+	if((array->type != JSON_ARRAY) || (n < 0)) {
+		return NULL;
+	}
+	if(jsonObj->index != NULL) {
+		return (n < jsonObj->index->size[id]) ? jsonObj->token + jsonObj->index->data[jsonObj->index->table[id] + n] : NULL;
+	}
+	for(i=jsonTokenFChild(jsonObj, array); (i != 0) && (n > 0); n--) {
+		i = (jsonObj->token + i)->nextToken;
+	}
+	return (i != 0) ? jsonObj->token + i : NULL;
+}
+
+/* кол-во элементов массива (ключей объекта)
+*/
+_jsonOff_t jsonChildCount(_jsonObj_t *jsonObj, _jsonToken_t *token)
+{
+	_jsonOff_t	id = token - jsonObj->token, i, n = 0;
+
+	if((jsonObj->index != NULL) && (token->type == JSON_ARRAY)) {
+		return jsonObj->index->size[id];
+	}
+	for(i=jsonTokenFChild(jsonObj, token); i != 0; i=(jsonObj->token + i)->nextToken) {
+		n++;
+	}
+	return n;
+}
+
+/* поиск с построением индекса при первом обращении
+ * Общий документ (jsonObj->shared) не меняется: поиск - по готовому индексу или проходом по ключам
+*/
+_jsonToken_t* jsonIndexKey(_jsonObj_t *jsonObj, _jsonToken_t *object, const char *key, _jsonLen_t keyLen)
+{
+	if(!jsonObj->shared) {
+		jsonBuildIndex(jsonObj);
+	}
+	return jsonFindKey(jsonObj, object, key, keyLen);
+}
+
+_jsonToken_t* jsonIndexAt(_jsonObj_t *jsonObj, _jsonToken_t *array, _jsonOff_t n)
+{
+	if(!jsonObj->shared) {
+		jsonBuildIndex(jsonObj);
+	}
+	return jsonArrayAt(jsonObj, array, n);
+}
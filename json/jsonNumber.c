@@ -0,0 +1,212 @@
+/* number decoding for dirty json parser
+ * Avinfors, O.Nikitin
+ *
+ * Упоротость и отвага!
+*/
+
+/* Декодирование чисел один раз на документ
+ * Парсер уже отличает JSON_VALUE_INT от JSON_VALUE_FLOAT, но значение не вычисляет. Здесь число
+ * декодируется при первом обращении (jsonTokenNumber) или сразу для всего документа (jsonDecodeNumbers)
+ * и кешируется в массиве рядом с токенами (по id токена), повторное обращение - чтение из массива
+ *
+ *  - целая часть: точное накопление в unsigned long long с контролем переполнения
+ *  - double: быстрый путь Клингера (мантисса <= 2^53 и степень 10 не более 22 - одно точное умножение
+ *    или деление, результат округлён корректно), иначе - strtod (тоже корректное округление)
+ *  - JSON_NUM_INT_OVERFLOW		9999944444446666699999.666666
+ *    JSON_NUM_PRECISION_LOSS	9999999999999999 (double хранит 10000000000000000)
+ *
+ * Кеш, как и индекс, заполняется при чтении (jsonTokenNumber): документ, который читают несколько потоков,
+ * нужно заранее декодировать jsonDecodeNumbers. getJsonInt, getJsonNumber, jsonCursorInt и jsonBind кеш
+ * не создают (jsonTokenDecode): есть - читают из него, нет - декодируют на стек
+*/
+
+#include "json.h"
+
+#define				JSON_NUM_MAX_DIGITS		(int)	19				// значащих цифр в мантиссе (< 2^64)
+#define				JSON_NUM_EXACT_MAX		(1ULL << 53)			// мантисса double
+
+// точные степени 10 в double
+static const double	pow10Exact[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* декодирование числа [p, end)
+ * Как и atoll/strtod, разбирается самый длинный префикс вида -цифры.цифры, остаток игнорируется
+*/
+static void decodeNumber(const char *p, const char *end, _jsonNum_t *num)
+{
+	const char			*begin = p;
+	unsigned long long	ip = 0, m = 0;		// целая часть, мантисса (первые значащие цифры)
+	int					nd = 0, exp10 = 0, d;
+	bool				neg = false, ipOverflow = false, dropped = false;
+	char				buff[64], *copy;
+
+	num->flags = JSON_NUM_DECODED;
+	if((p < end) && (*p == '-')) {
+		neg = true;
+		p++;
+	}
+	for(; (p < end) && (*p >= '0') && (*p <= '9'); p++) {
+		d = *p - '0';
+		if(ip > (~0ULL - d) / 10) {
+			ipOverflow = true;
+		} else if(!ipOverflow) {
+			ip = ip * 10 + d;
+		}
+		if(nd < JSON_NUM_MAX_DIGITS) {
+			if((m != 0) || (d != 0)) {
+				m = m * 10 + d;
+				nd++;
+			}
+		} else {
+			exp10++;
+			dropped |= (d != 0);
+		}
+	}
+	if((p < end) && (*p == '.')) {
+		for(p++; (p < end) && (*p >= '0') && (*p <= '9'); p++) {
+			d = *p - '0';
+			if(nd < JSON_NUM_MAX_DIGITS) {
+				if((m != 0) || (d != 0)) {
+					m = m * 10 + d;
+					nd++;
+				}
+				exp10--;
+			} else {
+				dropped |= (d != 0);
+			}
+		}
+	}
+
+	// целая часть с насыщением, как у strtoll
+	if(ipOverflow || (ip > (neg ? (unsigned long long)LLONG_MAX + 1 : (unsigned long long)LLONG_MAX))) {
+		num->i = neg ? LLONG_MIN : LLONG_MAX;
+		num->flags |= JSON_NUM_INT_OVERFLOW;
+	} else {
+		num->i = neg ? (long long)(0ULL - ip) : (long long)ip;
+	}
+
+	if(dropped || ((unsigned long long)(double)m != m)) {
+		num->flags |= JSON_NUM_PRECISION_LOSS;
+	}
+	if(!dropped && (m <= JSON_NUM_EXACT_MAX) && (exp10 >= -22) && (exp10 <= 22)) {
+		// быстрый путь: m и 10^|exp10| точны в double, одна операция округляется корректно
+		num->d = (exp10 < 0) ? (double)m / pow10Exact[-exp10] : (double)m * pow10Exact[exp10];
+		if(neg) {
+			num->d = -num->d;
+		}
+		return;
+	}
+	if(p - begin < (int)sizeof(buff)) {
+		memcpy(buff, begin, p - begin);
+		buff[p - begin] = 0;
+		num->d = strtod(buff, NULL);
+		return;
+	}
+	copy = (char*)malloc(p - begin + 1);
+	memcpy(copy, begin, p - begin);
+	copy[p - begin] = 0;
+	num->d = strtod(copy, NULL);
+	free(copy);
+}
+
+// распределение кеша (все записи - "не декодировано")
+static bool allocNumbers(_jsonObj_t *jsonObj)
+{
+	_jsonOff_t	count = (jsonObj->count > 0) ? jsonObj->count : 1;
+
+	if(jsonObj->num != NULL) {
+		return true;
+	}
+	jsonObj->num = (_jsonNum_t*)jsonObjAlloc(jsonObj, sizeof(_jsonNum_t) * count);
+	if(jsonObj->num == NULL) {
+		return false;
+	}
+	memset(jsonObj->num, 0, sizeof(_jsonNum_t) * count);
+	return true;
+}
+
+/* число токена
+ * return:			декодированное значение или NULL (токен - не число, нет памяти)
+ * Указатель действителен до повторного разбора/освобождения документа
+*/
+const _jsonNum_t* jsonTokenNumber(_jsonObj_t *jsonObj, _jsonToken_t *token)
+{
+	_jsonNum_t	*num;
+
+	if((token->type != JSON_VALUE) || ((token->valueType != JSON_VALUE_INT) && (token->valueType != JSON_VALUE_FLOAT))) {
+		return NULL;
+	}
+	if(!allocNumbers(jsonObj)) {
+		return NULL;
+	}
+	num = jsonObj->num + jsonTokenId(jsonObj, token);
+	if(num->flags == 0) {
+		decodeNumber(jsonObj->json + token->start, jsonObj->json + token->end, num);
+	}
+	return num;
+}
+
+/* декодирование числа без кеша документа (ничего не распределяет, документ не меняется)
+ * str, len			текст числа (jsonTokenView)
+*/
+void jsonNumberDecode(const char *str, _jsonOff_t len, _jsonNum_t *num)
+{
+	decodeNumber(str, str + len, num);
+}
+
+/* число токена без распределения памяти: из кеша документа, если он есть, иначе декодируется на месте
+ * Документ не меняется, поэтому вызов безопасен из нескольких потоков
+ * return:			false - токен не число
+*/
+bool jsonTokenDecode(_jsonObj_t *jsonObj, _jsonToken_t *token, _jsonNum_t *num)
+{
+	if((token->type != JSON_VALUE) || ((token->valueType != JSON_VALUE_INT) && (token->valueType != JSON_VALUE_FLOAT))) {
+		return false;
+	}
+	if((jsonObj->num != NULL) && (jsonObj->num[jsonTokenId(jsonObj, token)].flags != 0)) {
+		*num = jsonObj->num[jsonTokenId(jsonObj, token)];
+		return true;
+	}
+	decodeNumber(jsonObj->json + token->start, jsonObj->json + token->end, num);
+	return true;
+}
+
+/* декодирование всех чисел документа одним проходом
+ * return:			false - не хватило памяти
+*/
+bool jsonDecodeNumbers(_jsonObj_t *jsonObj)
+{
+	_jsonOff_t	i;
+
+	if(!allocNumbers(jsonObj)) {
+		return false;
+	}
+	for(i=0; i<jsonObj->count; i++) {
+		jsonTokenNumber(jsonObj, jsonObj->token + i);
+	}
+	return true;
+}
+
+// освобождение кеша (также освобождается jsonDocFree и при повторном разборе документа)
+void jsonFreeNumbers(_jsonObj_t *jsonObj)
+{
+	if(jsonObj->num != NULL) {
+		jsonObjFree(jsonObj, jsonObj->num);
+		jsonObj->num = NULL;
+	}
+}
+
+/* число по пути
+ * return:			false - значение не найдено или не число
+*/
+bool getJsonNumber(const char *key, _jsonObj_t *jsonObj, _jsonNum_t *num)
+{
+	_jsonToken_t		*token = xPath(key, jsonObj);
+
+	if(token == (_jsonToken_t*)(0)) {
+		return false;
+	}
+	return jsonTokenDecode(jsonObj, token, num);
+}
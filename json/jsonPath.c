@@ -0,0 +1,210 @@
+/* compiled path queries for dirty json parser
+ * Avinfors, O.Nikitin
+ *
+ * Упоротость и отвага!
+*/
+
+/* Путь компилируется один раз (jsonPathCompile) в программу - массив шагов,
+ * программа выполняется (jsonPathExec) над любым количеством документов.
+ *
+ * Синтаксис пути:
+ *  a.b.c				ключи объектов
+ *  list[2]				элемент массива по номеру (с 0)
+ *  list[*]				все элементы массива
+ *  a.*					все значения объекта
+ *  ['a.b']	["a[1]"]	ключ со спецсимволами
+ *  [0].a				путь от корневого массива
+ * Пример: reports.list[*].code - код каждого элемента списка
+ *
+ * Результат - узлы-значения (значение, объект или массив) в порядке следования в документе
+*/
+
+#include "json.h"
+
+// разбор одного шага в скобках: [n], [*], ['key'], ["key"]
+static const char* compileBracket(const char *p, _jsonPathStep_t *step, char **keys, char *keyBase)
+{
+	char	quota;
+	int		n = 0;
+
+	p++;
+	if(*p == '*') {
+		step->op = JSON_PATH_ANY_INDEX;
+		p++;
+	} else if((*p == '\'') || (*p == '"')) {
+		quota = *p++;
+		step->op = JSON_PATH_KEY;
+		step->key = *keys - keyBase;
+		while((*p != quota) && (*p != 0)) {
+			*(*keys)++ = *p++;
+		}
+		if(*p == 0) {
+			return NULL;
+		}
+		step->len = (*keys - keyBase) - step->key;
+		p++;
+	} else if((*p >= '0') && (*p <= '9')) {
+		step->op = JSON_PATH_INDEX;
+		while((*p >= '0') && (*p <= '9')) {
+			// номер, не помещающийся в int, - ошибка
+			if(n > (INT_MAX - (*p - '0')) / 10) {
+				return NULL;
+			}
+			n = n * 10 + (*p++ - '0');
+		}
+		step->len = n;
+	} else {
+		return NULL;
+	}
+	return (*p == ']') ? p + 1 : NULL;
+}
+
+/* компиляция пути
+ * return:			программа (освобождается jsonPathFree) или NULL - ошибка синтаксиса, нет памяти
+*/
+_jsonPath_t* jsonPathCompile(const char *path)
+{
+	_jsonPath_t		*prog;
+	const char		*p;
+	char			*keys;
+	int				len = strlen(path), steps = 1;
+
+	// шагов не больше, чем точек и открывающих скобок
+	for(p=path; *p; p++) {
+		if((*p == '.') || (*p == '[')) {
+			steps++;
+		}
+	}
+	prog = (_jsonPath_t*)malloc(sizeof(_jsonPath_t) + sizeof(_jsonPathStep_t) * steps + len + 1);
+	if(prog == NULL) {
+		return NULL;
+	}
+	prog->step = (_jsonPathStep_t*)(prog + 1);
+	prog->keys = (char*)(prog->step + steps);
+	prog->count = 0;
+	keys = prog->keys;
+
+	p = path;
+	while(*p) {
+		_jsonPathStep_t *step = prog->step + prog->count;
+
+		if(*p == '[') {
+			p = compileBracket(p, step, &keys, prog->keys);
+		} else if((*p == '*') && ((p[1] == '.') || (p[1] == '[') || (p[1] == 0))) {
+			step->op = JSON_PATH_ANY_KEY;
+			p++;
+		} else {
+			step->op = JSON_PATH_KEY;
+			step->key = keys - prog->keys;
+			while((*p != '.') && (*p != '[') && (*p != 0)) {
+				*keys++ = *p++;
+			}
+			step->len = (keys - prog->keys) - step->key;
+			if(step->len == 0) {
+				p = NULL;
+			}
+		}
+		if(p == NULL) {
+			free(prog);
+			return NULL;
+		}
+		prog->count++;
+
+		// после шага: конец, следующий шаг в скобках или точка перед ключом
+		if(*p == '.') {
+			p++;
+			if((*p == 0) || (*p == '.') || (*p == '[')) {
+				free(prog);
+				return NULL;
+			}
+		} else if((*p != '[') && (*p != 0)) {
+			free(prog);
+			return NULL;
+		}
+	}
+	if(prog->count == 0) {
+		free(prog);
+		return NULL;
+	}
+	return prog;
+}
+
+void jsonPathFree(_jsonPath_t *path)
+{
+	free(path);
+}
+
+// рекурсивное выполнение шага n над узлом token
+static void execStep(_jsonPath_t *path, int n, _jsonObj_t *jsonObj, _jsonToken_t *token, _jsonToken_t **res, int maxRes, int *found)
+{
+	_jsonPathStep_t	*step;
+	_jsonOff_t		i;
+
+	if((res != NULL) && (*found >= maxRes)) {
+		return;
+	}
+	if(n == path->count) {
+		if(res != NULL) {
+			res[*found] = token;
+		}
+		(*found)++;
+		return;
+	}
+	step = path->step + n;
+	switch(step->op) {
+		case JSON_PATH_KEY:
+			token = jsonFindKey(jsonObj, token, path->keys + step->key, step->len);
+			if((token != NULL) && (jsonTokenFChild(jsonObj, token) != 0)) {
+				execStep(path, n + 1, jsonObj, jsonObj->token + jsonTokenFChild(jsonObj, token), res, maxRes, found);
+			}
+			break;
+		case JSON_PATH_INDEX:
+			token = jsonArrayAt(jsonObj, token, step->len);
+			if(token != NULL) {
+				execStep(path, n + 1, jsonObj, token, res, maxRes, found);
+			}
+			break;
+		case JSON_PATH_ANY_KEY:
+			if(token->type != JSON_OBJECT) {
+				break;
+			}
+			for(i=jsonTokenFChild(jsonObj, token); i != 0; i=(jsonObj->token + i)->nextToken) {
+				if(jsonTokenFChild(jsonObj, jsonObj->token + i) != 0) {
+					execStep(path, n + 1, jsonObj, jsonObj->token + jsonTokenFChild(jsonObj, jsonObj->token + i), res, maxRes, found);
+				}
+			}
+			break;
+		case JSON_PATH_ANY_INDEX:
+			if(token->type != JSON_ARRAY) {
+				break;
+			}
+			for(i=jsonTokenFChild(jsonObj, token); i != 0; i=(jsonObj->token + i)->nextToken) {
+				execStep(path, n + 1, jsonObj, jsonObj->token + i, res, maxRes, found);
+			}
+			break;
+	}
+}
+
+/* выполнение программы над документом
+ * path				скомпилированный путь
+ * jsonObj			разобранный документ
+ * res				OUT массив для найденных узлов, NULL - только подсчёт
+ * maxRes			размер res, при его заполнении обход прекращается
+ * return:			кол-во найденных узлов
+ * Программа не изменяется при выполнении: один путь можно выполнять из нескольких потоков
+*/
+int jsonPathExec(_jsonPath_t *path, _jsonObj_t *jsonObj, _jsonToken_t **res, int maxRes)
+{
+	int		found = 0;
+
+	execStep(path, 0, jsonObj, jsonObj->token, res, maxRes, &found);
+	return found;
+}
+
+// первый найденный узел или NULL
+_jsonToken_t* jsonPathFirst(_jsonPath_t *path, _jsonObj_t *jsonObj)
+{
+	_jsonToken_t	*token;
+
+	return (jsonPathExec(path, jsonObj, &token, 1) > 0) ? token : NULL;
+}
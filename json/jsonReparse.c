@@ -0,0 +1,259 @@
+/* incremental reparse for dirty json parser
+ * Avinfors, O.Nikitin
+ *
+ * Упоротость и отвага!
+*/
+
+/* Повторный разбор документа после правки исходного текста
+ * Правка - замена removedLen байт с позиции offset на text. Токены хранят смещения в json'е и ссылки
+ * parent/nextToken, поэтому заново разбирается только наименьший контейнер, внутри которого (не задевая
+ * его скобок) лежит правка. Его поддерево в массиве токенов заменяется новым, у токенов за ним сдвигаются
+ * смещения и индексы. Если правка задевает скобки контейнеров до корня, лежит вне корня или контейнер
+ * после правки разбирается с ошибкой (в т.ч. правка "вылезает" из него: открытый комментарий, строка,
+ * лишняя скобка) - документ разбирается целиком, ошибка при этом та же, что у jsonParser
+ *
+ *	jsonParser(text, &doc, 0);
+ *	...
+ *	// пользователь заменил "1" на "12" в позиции 17
+ *	if(jsonReparse(doc, 17, 1, "12", 2) != 0) {
+ *		... getLastError()
+ *	}
+ *
+ * Новый текст документа собирается в буфере, принадлежащем документу (_jsonObj_t.own): исходная строка
+ * клиента после первого вызова больше не используется. Текст документа должен завершаться нулём.
+ * Индекс (jsonBuildIndex), декодированные числа и правки (jsonEditSet) сбрасываются
+*/
+
+#include "json.h"
+
+/* наименьший контейнер, внутри которого лежит [offset, offset + removedLen]
+ * start, end		OUT границы контейнера (см. jsonTokenSpan)
+ * return:			индекс контейнера, -1 - правка задевает корень или лежит вне его
+*/
+static _jsonOff_t enclosing(_jsonObj_t *doc, _jsonOff_t offset, _jsonLen_t removedLen, _jsonOff_t *start, _jsonOff_t *end)
+{
+	_jsonToken_t	*token = doc->token, *child, *value;
+	_jsonOff_t		id, s, e, next;
+
+	if(((token->type != JSON_OBJECT) && (token->type != JSON_ARRAY)) || !jsonTokenSpan(doc, token, start, end) ||
+		(offset <= *start) || ((_jsonLen_t)offset + removedLen >= (_jsonLen_t)*end))
+	{
+		return -1;
+	}
+	for(;;) {
+		// элемент, в котором может лежать правка: последний, начинающийся не дальше offset
+		for(id = jsonTokenFChild(doc, token); id != 0; id = next) {
+			next = (doc->token + id)->nextToken;
+			if((next == 0) || ((doc->token + next)->start > offset)) {
+				break;
+			}
+		}
+		if(id == 0) {
+			break;
+		}
+		child = doc->token + id;
+		value = child;
+		if(child->type == JSON_KEY) {
+			if(jsonTokenFChild(doc, child) == 0) {
+				break;
+			}
+			value = doc->token + jsonTokenFChild(doc, child);
+		}
+		if(((value->type != JSON_OBJECT) && (value->type != JSON_ARRAY)) || (value->start >= offset) ||
+			!jsonTokenSpan(doc, value, &s, &e) || ((_jsonLen_t)offset + removedLen >= (_jsonLen_t)e))
+		{
+			break;
+		}
+		token = value;
+		*start = s;
+		*end = e;
+	}
+	return jsonTokenId(doc, token);
+}
+
+// сдвиг ссылки на токен за заменённым поддеревом
+static inline _jsonOff_t shiftRef(_jsonOff_t ref, _jsonOff_t subEnd, _jsonOff_t dn)
+{
+	return (ref >= subEnd) ? ref + dn : ref;
+}
+
+/* замена поддерева id (токены [id, subEnd)) токенами разобранного отдельно контейнера
+ * sub				документ контейнера, смещения в нём - от start
+ * delta			изменение длины текста
+*/
+static bool splice(_jsonObj_t *doc, _jsonOff_t id, _jsonObj_t *sub, _jsonOff_t start, _jsonOff_t delta)
+{
+	_jsonOff_t		subEnd = jsonSubtreeEnd(doc, doc->token + id);
+	_jsonOff_t		n = (sub->count > 0) ? sub->count : 1, dn = n - (subEnd - id), count = doc->count + dn, i;
+	_jsonToken_t	old = doc->token[id], *t, *tokens;
+
+	if(count > doc->capacity) {
+		tokens = (_jsonToken_t*)jsonObjRealloc(doc, doc->token, sizeof(_jsonToken_t) * doc->capacity, sizeof(_jsonToken_t) * count);
+		if(tokens == NULL) {
+			return false;
+		}
+		doc->token = tokens;
+		doc->capacity = count;
+	}
+	memmove(doc->token + id + n, doc->token + subEnd, sizeof(_jsonToken_t) * (doc->count - subEnd));
+
+	// токены до поддерева: ссылки вперёд
+	for(i=0; i<id; i++) {
+		t = doc->token + i;
+		t->nextToken = shiftRef(t->nextToken, subEnd, dn);
+#ifndef JSON_COMPACT_TOKENS
+		t->fChild = shiftRef(t->fChild, subEnd, dn);
+		t->lChild = shiftRef(t->lChild, subEnd, dn);
+#endif
+	}
+	// токены после поддерева: смещения и индексы
+	for(i=id + n; i<count; i++) {
+		t = doc->token + i;
+		t->start += delta;
+		if(t->end != 0) {
+			// 0 - конец не выставлен (ключ без двоеточия у грязного json'а)
+			t->end += delta;
+		}
+		t->parent = shiftRef(t->parent, subEnd, dn);
+		if(t->nextToken != 0) {
+			t->nextToken += dn;
+		}
+#ifndef JSON_COMPACT_TOKENS
+		t->id = i;
+		if(t->fChild != 0) {
+			t->fChild += dn;
+		}
+		if(t->lChild != 0) {
+			t->lChild += dn;
+		}
+#endif
+	}
+	// новое поддерево
+	for(i=0; i<n; i++) {
+		t = doc->token + id + i;
+		*t = sub->token[i];
+		t->start += start;
+		if(t->end != 0) {
+			t->end += start;
+		}
+		if(i == 0) {
+			t->parent = old.parent;
+			t->nextToken = shiftRef(old.nextToken, subEnd, dn);
+		} else {
+			t->parent += id;
+			if(t->nextToken != 0) {
+				t->nextToken += id;
+			}
+		}
+#ifndef JSON_COMPACT_TOKENS
+		t->id = id + i;
+		if(t->fChild != 0) {
+			t->fChild += id;
+		}
+		if(t->lChild != 0) {
+			t->lChild += id;
+		}
+#endif
+	}
+	doc->count = count;
+	return true;
+}
+
+// повторный разбор после правки (контекст потока по умолчанию), см. jsonReparse_r
+int jsonReparse(_jsonObj_t *doc, _jsonOff_t offset, _jsonLen_t removedLen, const char *text, _jsonLen_t textLen)
+{
+	return jsonReparse_r(doc, offset, removedLen, text, textLen, jsonDefaultCtx());
+}
+
+/* повторный разбор документа после правки исходного текста
+ * doc				успешно разобранный документ (jsonParser, jsonDocParse...) или документ после
+ *					неудачного jsonReparse (тогда он разбирается целиком)
+ * offset			позиция правки в текущем тексте документа
+ * removedLen		сколько байт удалено с offset
+ * text, textLen	вставленный текст (textLen == 0 - только удаление)
+ * ctx				контекст для ошибки (см. jsonParser_r)
+ * return:			0 - успех, 1 - invalid json (документ - как после неудачного jsonDocParse)
+*/
+int jsonReparse_r(_jsonObj_t *doc, _jsonOff_t offset, _jsonLen_t removedLen, const char *text, _jsonLen_t textLen, _jsonCtx_t *ctx)
+{
+	_jsonLen_t		len = doc->len, newLen;
+	_jsonOff_t		id = -1, start, end, delta, level = 0, t;
+	_jsonObj_t		sub;
+	char			*str;
+	int				res;
+
+	if((offset < 0) || ((_jsonLen_t)offset > len) || (removedLen > len - offset) || (doc->sax != NULL)) {
+		setError(ctx, 1, 1, '.', JSON_ERR_UNEXPECTED_SYMBOL);
+		return 1;
+	}
+	newLen = len - removedLen + textLen;
+	if(newLen > (_jsonLen_t)JSON_OFF_MAX) {
+		setError(ctx, 1, 1, '.', JSON_ERR_NO_MEMORY);
+		return 1;
+	}
+	/* контейнер ищется по старому тексту и старым токенам
+	 * Правка в корне - это обычный разбор, токены снимка (jsonSnapshotLoad) только для чтения - тоже
+	*/
+	if(doc->count > 0) {
+		id = enclosing(doc, offset, removedLen, &start, &end);
+	}
+	if((id == 0) || jsonTokensMapped(doc)) {
+		id = -1;
+	}
+
+	str = (char*)malloc(newLen + 1);
+	if(str == NULL) {
+		setError(ctx, 1, 1, '.', JSON_ERR_NO_MEMORY);
+		return 1;
+	}
+	memcpy(str, doc->json, offset);
+	if(textLen > 0) {
+		memcpy(str + offset, text, textLen);
+	}
+	memcpy(str + offset + textLen, doc->json + offset + removedLen, len - offset - removedLen);
+	str[newLen] = 0;
+	if(doc->own != NULL) {
+		free(doc->own);
+	}
+	doc->own = str;
+	doc->json = str;
+	doc->len = newLen;
+	jsonFreeIndex(doc);
+	jsonFreeNumbers(doc);
+	jsonEditFree(doc);
+
+	if(id >= 0) {
+		/* контейнер разбирается отдельно: до правки он был корректным, json вокруг него не менялся
+		 * Отдельно разобранный контейнер должен закрываться последней скобкой: парсер после закрытия корня
+		 * пропускает запятую и разбирает текст дальше, поэтому контейнер сперва проверяется быстрым
+		 * проходом валидатора - он принимает только то, что парсер заведомо разбирает так же, как в документе
+		*/
+		delta = (_jsonOff_t)textLen - (_jsonOff_t)removedLen;
+		if(!jsonQuickCheck(str + start, end + delta - start)) {
+			id = -1;
+		}
+	}
+	if(id >= 0) {
+		jsonDocInit(&sub, NULL);
+		res = jsonDocParse(&sub, str + start, end + delta - start, ctx);
+		if((res == 0) && splice(doc, id, &sub, start, delta)) {
+			for(t = id; t != 0; t = (doc->token + t)->parent) {
+				if(((doc->token + t)->type == JSON_OBJECT) || ((doc->token + t)->type == JSON_ARRAY)) {
+					level++;
+				}
+			}
+			if(sub.nesting + level > doc->nesting) {
+				doc->nesting = sub.nesting + level;
+			}
+			jsonDocFree(&sub);
+			return 0;
+		}
+		jsonDocFree(&sub);
+	}
+	res = jsonDocParse(doc, str, newLen, ctx);
+	if(res != 0) {
+		// токены неполные: следующая правка разбирает документ целиком
+		doc->count = 0;
+	}
+	return res;
+}
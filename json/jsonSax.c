@@ -0,0 +1,181 @@
+/* event (SAX) mode for dirty json parser
+ * Avinfors, O.Nikitin
+ *
+ * Упоротость и отвага!
+*/
+
+/* Разбор событиями: тот же парсер (структурный индекс, валидация, ошибки), но вместо массива токенов
+ * вызываются обработчики клиента - начало/конец объекта и массива, ключ, значение (с типом и позициями в json'е)
+ *
+ * Токены не накапливаются: документ держит по одному слоту на ключ и значение каждого открытого уровня
+ * (контейнер уровня N, за ним - его текущий ключ и значение). Новый токен ложится в слот сразу за своим
+ * родителем, закрытые поддеревья затираются. Память - O(вложенности), а не O(кол-ва токенов)
+ *
+ * Событие токена отправляется, когда токен закончен: перед следующим токеном, перед закрывающей скобкой
+ * или в конце разбора. Порядок событий - порядок токенов в json'е
+ *
+ *	bool onValue(void *arg, const char *json, const _jsonToken_t *token) { (*(int*)arg)++; return true; }
+ *	_jsonSax_t	sax = {.arg = &count, .value = onValue};
+ *	if(jsonParseSax(str, 0, &sax) == 1) ... getLastError()
+*/
+
+#include "json.h"
+
+#define				JSON_SAX_TOKENS			(int)	32		// начальное кол-во слотов (вложенность ~15)
+
+static inline bool saxEvent(_jsonObj_t *doc);
+
+/* токен для разбора событиями (вместо добавления в массив, см. assignNewToken)
+ * внутренняя ф-ция
+*/
+_jsonToken_t* jsonSaxToken(_jsonObj_t *doc, _jsonOff_t pos, _jsonOff_t parent)
+{
+	_jsonToken_t	*token, *tokens;
+	_jsonOff_t		id;
+	bool			afterKey;
+
+	// предыдущий токен закончен
+	if((doc->saxPending >= 0) && !saxEvent(doc)) {
+		return NULL;
+	}
+	// значение ключа - в слоте за ключом, остальные - в слоте за контейнером
+	afterKey = ((doc->token + doc->count)->type == JSON_KEY);
+	id = afterKey ? doc->count + 1 : parent + 1;
+	if(id >= doc->capacity) {
+		tokens = (_jsonToken_t*)jsonObjRealloc(doc, doc->token,
+			sizeof(_jsonToken_t) * doc->capacity, sizeof(_jsonToken_t) * (doc->capacity << 1));
+		if(tokens == NULL) {
+			return NULL;
+		}
+		doc->token = tokens;
+		doc->capacity <<= 1;
+	}
+	token = doc->token + id;
+	token->parent = afterKey ? doc->count : parent;
+	token->start = pos;
+	token->end = 0;
+	token->nextToken = 0;
+	token->valueType = 0;
+	token->escaped = 0;
+#ifndef JSON_COMPACT_TOKENS
+	token->id = id;
+	token->fChild = 0;
+	token->lChild = 0;
+#endif
+	doc->count = id;
+	doc->saxPending = id;
+	return token;
+}
+
+// событие ожидающего токена
+static inline bool saxEvent(_jsonObj_t *doc)
+{
+	const _jsonSax_t	*sax = doc->sax;
+	_jsonToken_t		*token;
+	bool				res = true;
+
+	token = doc->token + doc->saxPending;
+	doc->saxPending = -1;
+	switch(token->type) {
+		case JSON_OBJECT:
+			if(sax->objectStart != NULL) {
+				res = sax->objectStart(sax->arg, token->start);
+			}
+			break;
+		case JSON_ARRAY:
+			if(sax->arrayStart != NULL) {
+				res = sax->arrayStart(sax->arg, token->start);
+			}
+			break;
+		case JSON_KEY:
+			if(sax->key != NULL) {
+				res = sax->key(sax->arg, doc->json, token);
+			}
+			break;
+		case JSON_VALUE:
+			if(sax->value != NULL) {
+				res = sax->value(sax->arg, doc->json, token);
+			}
+			break;
+		default:
+			break;
+	}
+	if(!res) {
+		doc->saxStop = true;
+	}
+	return res;
+}
+
+/* событие законченного токена
+ * внутренняя ф-ция
+ * return:			false - обработчик остановил разбор
+*/
+bool jsonSaxFlush(_jsonObj_t *doc)
+{
+	return (doc->saxPending < 0) || saxEvent(doc);
+}
+
+/* закрытие контейнера: событие последнего токена, затем конец объекта/массива
+ * внутренняя ф-ция
+*/
+bool jsonSaxClose(_jsonObj_t *doc, _jsonType_t type, _jsonOff_t pos)
+{
+	const _jsonSax_t	*sax = doc->sax;
+	bool				res = true;
+
+	if((doc->saxPending >= 0) && !saxEvent(doc)) {
+		return false;
+	}
+	if((type == JSON_OBJECT) && (sax->objectEnd != NULL)) {
+		res = sax->objectEnd(sax->arg, pos);
+	} else if((type == JSON_ARRAY) && (sax->arrayEnd != NULL)) {
+		res = sax->arrayEnd(sax->arg, pos);
+	}
+	if(!res) {
+		doc->saxStop = true;
+	}
+	return res;
+}
+
+// разбор событиями (контекст потока по умолчанию), см. jsonParseSax_r
+int jsonParseSax(const char *str, _jsonLen_t len, const _jsonSax_t *sax)
+{
+	return jsonParseSax_r(str, len, sax, jsonDefaultCtx());
+}
+
+/* разбор событиями
+ * str, len			json (len == 0 - до завершающего нуля)
+ * sax				обработчики событий
+ * ctx				контекст (см. jsonParser_r)
+ * return:			0 - успех, 1 - invalid json (ошибка - как у jsonParser), JSON_PARSE_STOP - остановлен обработчиком
+ * События до ошибки уже отправлены: ошибка в json'е обнаруживается только дойдя до неё
+*/
+int jsonParseSax_r(const char *str, _jsonLen_t len, const _jsonSax_t *sax, _jsonCtx_t *ctx)
+{
+	_jsonObj_t			doc;
+	_jsonParseState_t	st;
+	_jsonErr_t			error = ctx->error;
+	int					res;
+
+	if(len == 0) {
+		len = strlen(str);
+	}
+	if(len > (_jsonLen_t)JSON_OFF_MAX) {
+		setError(ctx, 1, 1, '.', JSON_ERR_NO_MEMORY);
+		return 1;
+	}
+	jsonDocInit(&doc, NULL);
+	doc.sax = sax;
+	doc.saxPending = -1;
+	res = jsonParseBegin(&doc, &st, str, JSON_SAX_TOKENS, ctx);
+	if(res == 0) {
+		res = jsonParseRun(&doc, &st, str, len, true, ctx);
+	}
+	if(doc.saxStop) {
+		// остановка внутри assignNewToken выглядит для парсера как нехватка памяти - ошибки нет
+		ctx->error = error;
+		res = JSON_PARSE_STOP;
+	}
+	jsonDocFree(&doc);
+	return res;
+}
@@ -0,0 +1,203 @@
+/* structural index for dirty json parser
+ * Avinfors, O.Nikitin
+ *
+ * Упоротость и отвага!
+*/
+
+#include "jsonScan.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define JSON_SCAN_X86
+#endif
+
+// биты классов для скалярной таблицы
+#define				JSON_SCAN_BIT_QUOTE		(1 << JSON_SCAN_QUOTE)
+#define				JSON_SCAN_BIT_SPACE		(1 << JSON_SCAN_SPACE)
+#define				JSON_SCAN_BIT_DELIM		(1 << JSON_SCAN_DELIM)
+#define				JSON_SCAN_BIT_COMMENT	(1 << JSON_SCAN_COMMENT)
+
+static unsigned char	scanTable[256];
+static void				(*scanBlock)(const char *p, uint64_t *mask);
+static const char		*scanImpl = "scalar";
+
+/* скалярная реализация: таблица классов
+*/
+static void scanBlockScalar(const char *p, uint64_t *mask)
+{
+	uint64_t		m[JSON_SCAN_CLASSES] = {0, 0, 0, 0};
+	unsigned char	c;
+	int				i;
+
+	for(i=0; i<(int)JSON_SCAN_BLOCK; i++) {
+		c = scanTable[(unsigned char)p[i]];
+		m[JSON_SCAN_QUOTE] |= (uint64_t)((c >> JSON_SCAN_QUOTE) & 1) << i;
+		m[JSON_SCAN_SPACE] |= (uint64_t)((c >> JSON_SCAN_SPACE) & 1) << i;
+		m[JSON_SCAN_DELIM] |= (uint64_t)((c >> JSON_SCAN_DELIM) & 1) << i;
+		m[JSON_SCAN_COMMENT] |= (uint64_t)((c >> JSON_SCAN_COMMENT) & 1) << i;
+	}
+	// для пробелов маска инвертирована: интересны все НЕ пробельные символы
+	mask[JSON_SCAN_QUOTE] = m[JSON_SCAN_QUOTE];
+	mask[JSON_SCAN_SPACE] = ~m[JSON_SCAN_SPACE];
+	mask[JSON_SCAN_DELIM] = m[JSON_SCAN_DELIM];
+	mask[JSON_SCAN_COMMENT] = m[JSON_SCAN_COMMENT];
+}
+
+#ifdef JSON_SCAN_X86
+
+/* SSE4.2: PCMPESTRM сравнивает 16 байт с набором символов класса
+*/
+__attribute__ ((target("sse4.2")))
+static uint64_t scanSetSse42(const char *p, __m128i set, int setLen)
+{
+	uint64_t	m = 0;
+	int			i;
+
+	for(i=0; i<4; i++) {
+		__m128i data = _mm_loadu_si128((const __m128i*)(p + (i << 4)));
+		__m128i r = _mm_cmpestrm(set, setLen, data, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK);
+		m |= (uint64_t)(unsigned int)_mm_cvtsi128_si32(r) << (i << 4);
+	}
+	return m;
+}
+
+__attribute__ ((target("sse4.2")))
+static void scanBlockSse42(const char *p, uint64_t *mask)
+{
+	const __m128i	quote = _mm_setr_epi8('"', '\'', '\n', '\\', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i	space = _mm_setr_epi8(' ', '\t', '\r', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i	delim = _mm_setr_epi8(' ', '\t', '\r', '\n', '{', '}', '[', ']', ':', ',', '"', '\'', '/', 0, 0, 0);
+	const __m128i	comment = _mm_setr_epi8('*', '\r', '\n', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+	mask[JSON_SCAN_QUOTE] = scanSetSse42(p, quote, 4);
+	mask[JSON_SCAN_SPACE] = ~scanSetSse42(p, space, 3);
+	mask[JSON_SCAN_DELIM] = scanSetSse42(p, delim, 13);
+	mask[JSON_SCAN_COMMENT] = scanSetSse42(p, comment, 3);
+}
+
+/* AVX2: побайтовые сравнения двух 32-байтных половин блока
+*/
+__attribute__ ((target("avx2")))
+static void scanHalfAvx2(const char *p, uint32_t *m)
+{
+	__m256i	data = _mm256_loadu_si256((const __m256i*)p);
+	__m256i	dq = _mm256_cmpeq_epi8(data, _mm256_set1_epi8('"'));
+	__m256i	sq = _mm256_cmpeq_epi8(data, _mm256_set1_epi8('\''));
+	__m256i	nl = _mm256_cmpeq_epi8(data, _mm256_set1_epi8('\n'));
+	__m256i	bs = _mm256_cmpeq_epi8(data, _mm256_set1_epi8('\\'));
+	__m256i	cr = _mm256_cmpeq_epi8(data, _mm256_set1_epi8('\r'));
+	__m256i	sp = _mm256_or_si256(
+					_mm256_or_si256(_mm256_cmpeq_epi8(data, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(data, _mm256_set1_epi8('\t'))),
+					cr);
+	__m256i	quote = _mm256_or_si256(_mm256_or_si256(dq, sq), nl);
+	__m256i	st = _mm256_or_si256(
+					_mm256_or_si256(
+						_mm256_or_si256(_mm256_cmpeq_epi8(data, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(data, _mm256_set1_epi8('}'))),
+						_mm256_or_si256(_mm256_cmpeq_epi8(data, _mm256_set1_epi8('[')), _mm256_cmpeq_epi8(data, _mm256_set1_epi8(']')))),
+					_mm256_or_si256(
+						_mm256_or_si256(_mm256_cmpeq_epi8(data, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(data, _mm256_set1_epi8(','))),
+						_mm256_cmpeq_epi8(data, _mm256_set1_epi8('/'))));
+	__m256i	comment = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(data, _mm256_set1_epi8('*')), cr), nl);
+
+	m[JSON_SCAN_QUOTE] = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(quote, bs));
+	m[JSON_SCAN_SPACE] = ~(uint32_t)_mm256_movemask_epi8(sp);
+	m[JSON_SCAN_DELIM] = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(st, sp), quote));
+	m[JSON_SCAN_COMMENT] = (uint32_t)_mm256_movemask_epi8(comment);
+}
+
+__attribute__ ((target("avx2")))
+static void scanBlockAvx2(const char *p, uint64_t *mask)
+{
+	uint32_t	lo[JSON_SCAN_CLASSES], hi[JSON_SCAN_CLASSES];
+	int			i;
+
+	scanHalfAvx2(p, lo);
+	scanHalfAvx2(p + 32, hi);
+	for(i=0; i<JSON_SCAN_CLASSES; i++) {
+		mask[i] = ((uint64_t)hi[i] << 32) | lo[i];
+	}
+}
+
+#endif
+
+/* выбор реализации при загрузке библиотеки
+*/
+__attribute__ ((constructor))
+static void jsonScanSetup()
+{
+	const char	*c;
+
+	for(c="\"'\n\\"; *c; c++)						scanTable[(unsigned char)*c] |= JSON_SCAN_BIT_QUOTE;
+	for(c=" \t\r"; *c; c++)							scanTable[(unsigned char)*c] |= JSON_SCAN_BIT_SPACE;
+	for(c=" \t\r\n{}[]:,\"'/"; *c; c++)				scanTable[(unsigned char)*c] |= JSON_SCAN_BIT_DELIM;
+	for(c="*\r\n"; *c; c++)							scanTable[(unsigned char)*c] |= JSON_SCAN_BIT_COMMENT;
+
+	scanBlock = scanBlockScalar;
+#ifdef JSON_SCAN_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2")) {
+		scanBlock = scanBlockAvx2;
+		scanImpl = "avx2";
+	} else if(__builtin_cpu_supports("sse4.2")) {
+		scanBlock = scanBlockSse42;
+		scanImpl = "sse4.2";
+	}
+#endif
+}
+
+void jsonScanInit(_jsonScan_t *scan, const char *str, _jsonLen_t len)
+{
+	scan->str = str;
+	scan->len = len;
+	scan->block = ~(_jsonLen_t)0;
+}
+
+/* построение масок блока, начинающегося со смещения block
+ * хвост строки копируется в буфер, дополненный нулями: за пределы строки не читаем
+*/
+void jsonScanLoad(_jsonScan_t *scan, _jsonLen_t block)
+{
+	char	tail[JSON_SCAN_BLOCK];
+
+	if(scan->len - block >= JSON_SCAN_BLOCK) {
+		scanBlock(scan->str + block, scan->mask);
+	} else {
+		memset(tail, 0, JSON_SCAN_BLOCK);
+		memcpy(tail, scan->str + block, scan->len - block);
+		scanBlock(tail, scan->mask);
+	}
+	scan->block = block;
+}
+
+// имя выбранной реализации (для отладки и бенчмарков)
+const char* jsonScanImpl()
+{
+	return scanImpl;
+}
+
+/* принудительный выбор реализации (тесты, бенчмарки): "scalar", "sse4.2", "avx2"
+ * Переключение не защищено: вызывать, пока никто не разбирает json
+ * return:			false - реализация неизвестна или процессор её не поддерживает (выбор не меняется)
+*/
+bool jsonScanUse(const char *impl)
+{
+	if(strcmp(impl, "scalar") == 0) {
+		scanBlock = scanBlockScalar;
+		scanImpl = "scalar";
+		return true;
+	}
+#ifdef JSON_SCAN_X86
+	if((strcmp(impl, "avx2") == 0) && __builtin_cpu_supports("avx2")) {
+		scanBlock = scanBlockAvx2;
+		scanImpl = "avx2";
+		return true;
+	}
+	if((strcmp(impl, "sse4.2") == 0) && __builtin_cpu_supports("sse4.2")) {
+		scanBlock = scanBlockSse42;
+		scanImpl = "sse4.2";
+		return true;
+	}
+#endif
+	return false;
+}
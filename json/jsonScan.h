@@ -0,0 +1,61 @@
+#ifndef __jsonScan_h
+#define __jsonScan_h
+
+#include <stdint.h>
+#include <limits.h>
+
+#include "json.h"
+
+/* Структурный индекс json'а
+ * Строка обрабатывается блоками по 64 байта. Для каждого блока строятся битовые маски (бит N - байт N блока)
+ * "интересных" для парсера символов. Парсер по маске перепрыгивает через байты, которые не меняют его состояния
+ * (содержимое строк, отступы, имена ключей без кавычек, тела комментариев)
+ * Реализация блока выбирается в runtime: AVX2, SSE4.2 или скалярная
+*/
+
+// классы символов (индекс маски)
+#define				JSON_SCAN_QUOTE			(int)	0		// " ' \n \\				- внутри строки в кавычках
+#define				JSON_SCAN_SPACE			(int)	1		// всё, кроме ' ' \t \r		- пропуск отступов
+#define				JSON_SCAN_DELIM			(int)	2		// пробелы, \n, { } [ ] : , " ' /	- конец токена без кавычек
+#define				JSON_SCAN_COMMENT		(int)	3		// * \r \n				- тело комментария
+#define				JSON_SCAN_CLASSES		(int)	4
+
+#define				JSON_SCAN_BLOCK			(_jsonLen_t)	64
+
+typedef struct
+{
+	const char		*str;
+	_jsonLen_t		len;
+	_jsonLen_t		block;							// смещение закешированного блока (~0 - нет блока)
+	uint64_t		mask[JSON_SCAN_CLASSES];		// маски закешированного блока
+} _jsonScan_t;
+
+void				jsonScanInit(_jsonScan_t *scan, const char *str, _jsonLen_t len);
+void				jsonScanLoad(_jsonScan_t *scan, _jsonLen_t block);
+const char*			jsonScanImpl();
+bool				jsonScanUse(const char *impl);
+
+/* позиция первого символа класса cls, начиная с pos (включительно)
+ * если такого символа нет - возвращается длина строки
+*/
+static inline _jsonLen_t jsonScanNext(_jsonScan_t *scan, _jsonLen_t pos, int cls)
+{
+	_jsonLen_t		block;
+	uint64_t		m;
+
+	while(pos < scan->len) {
+		block = pos & ~(JSON_SCAN_BLOCK - 1);
+		if(block != scan->block) {
+			jsonScanLoad(scan, block);
+		}
+		m = scan->mask[cls] >> (pos & (JSON_SCAN_BLOCK - 1));
+		if(m != 0) {
+			pos += __builtin_ctzll(m);
+			return (pos < scan->len) ? pos : scan->len;
+		}
+		pos = block + JSON_SCAN_BLOCK;
+	}
+	return scan->len;
+}
+
+#endif
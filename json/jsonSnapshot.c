@@ -0,0 +1,295 @@
+/* binary snapshot of parsed documents for dirty json parser
+ * Avinfors, O.Nikitin
+ *
+ * Упоротость и отвага!
+*/
+
+/* Снимок разобранного документа: токены и исходный json в одном файле, загрузка без разбора
+ * Массив токенов не содержит указателей (только индексы и смещения в json'е), поэтому он пишется в файл
+ * как есть, а при загрузке используется прямо из отображённого в память файла (только чтение).
+ * Загрузка - mmap, проверка заголовка и контрольной суммы. Страницы снимка лежат в page cache и общие
+ * для всех процессов хоста, загрузивших один и тот же файл
+ *
+ * Формат (все числа - в порядке байт и размерах машины, записавшей снимок):
+ *	заголовок		_snapHeader_t: сигнатура, версия, маркер порядка байт, размеры токена и смещения,
+ *					режим токенов, кол-во токенов, nesting, положение и размер частей, контрольная сумма
+ *	токены			с границы JSON_SNAPSHOT_ALIGN
+ *	json			с границы JSON_SNAPSHOT_ALIGN, с завершающим нулём
+ * Снимок, записанный другой сборкой (JSON_COMPACT_TOKENS, JSON_OFFSET_64) или на машине с другим
+ * порядком байт, не загружается (JSON_ERR_SNAPSHOT) - его надо пересоздать из json'а
+ *
+ *	if(jsonSnapshotLoad("contract.snap", &doc) != 0) {
+ *		jsonParseFile("contract.json", &doc);
+ *		jsonSnapshotSave(doc, "contract.snap");
+ *	}
+ *	... xPath, getJsonStr, jsonBuildIndex ...
+ *	clearFlatJsonObj(&doc);
+ *
+ * Токены загруженного документа только для чтения: jsonDocParse/jsonReparse распределяют новый массив
+ * токенов, правки (jsonEditSet), индекс и декодированные числа хранятся отдельно и работают как обычно.
+ * Снимок записывается во временный файл и переименовывается: процессы, уже отобразившие старый снимок,
+ * продолжают работать с ним
+*/
+
+#include "json.h"
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define				JSON_SNAPSHOT_VERSION	(int)	2
+#define				JSON_SNAPSHOT_ORDER		0x01020304u		// маркер порядка байт
+#define				JSON_SNAPSHOT_ALIGN		(int)	64
+#define				JSON_SNAPSHOT_COMPACT	(int)	1		// флаг: токены JSON_COMPACT_TOKENS
+
+#define				JSON_HASH_P1			0x9E3779B185EBCA87ULL
+#define				JSON_HASH_P2			0xC2B2AE3D27D4EB4FULL
+#define				JSON_HASH_P3			0x165667B19E3779F9ULL
+
+static const char	snapMagic[8] = {'D', 'J', 'S', 'N', 'A', 'P', 0, 0};
+
+typedef struct
+{
+	char				magic[8];
+	unsigned int		version;
+	unsigned int		order;			// JSON_SNAPSHOT_ORDER в порядке байт записавшей машины
+	unsigned int		tokenSize;		// sizeof(_jsonToken_t)
+	unsigned int		offSize;		// sizeof(_jsonOff_t)
+	unsigned int		flags;			// JSON_SNAPSHOT_*
+	unsigned int		reserved;
+	unsigned long long	count;			// _jsonObj_t.count
+	unsigned long long	nesting;
+	unsigned long long	tokenPos;		// смещение токенов в файле
+	unsigned long long	tokens;			// кол-во записанных токенов (пустой корень - 1 при count == 0)
+	unsigned long long	jsonPos;		// смещение json'а в файле
+	unsigned long long	jsonLen;		// длина json'а без завершающего нуля
+	unsigned long long	hash;			// jsonHash64 токенов, затем json'а (без нуля)
+} _snapHeader_t;
+
+static inline unsigned long long rotl64(unsigned long long x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline unsigned long long hashRound(unsigned long long acc, unsigned long long w)
+{
+	return rotl64(acc + w * JSON_HASH_P2, 31) * JSON_HASH_P1;
+}
+
+/* быстрый 64-битный хэш блока памяти (не криптографический)
+ * 4 независимые цепочки по 8 байт, поэтому умножения идут параллельно: несколько Гб/с
+ * seed				начальное значение (хэш нескольких блоков - хэш следующего с seed = хэш предыдущего)
+ * Значение зависит от порядка байт машины
+*/
+unsigned long long jsonHash64(const void *data, size_t len, unsigned long long seed)
+{
+	const unsigned char	*p = (const unsigned char*)data, *end = p + len;
+	unsigned long long	v[4], h, w;
+
+	if(len >= 32) {
+		v[0] = seed + JSON_HASH_P1 + JSON_HASH_P2;
+		v[1] = seed + JSON_HASH_P2;
+		v[2] = seed;
+		v[3] = seed - JSON_HASH_P1;
+		do {
+			memcpy(&w, p, 8);		v[0] = hashRound(v[0], w);
+			memcpy(&w, p + 8, 8);	v[1] = hashRound(v[1], w);
+			memcpy(&w, p + 16, 8);	v[2] = hashRound(v[2], w);
+			memcpy(&w, p + 24, 8);	v[3] = hashRound(v[3], w);
+			p += 32;
+		} while(end - p >= 32);
+		h = rotl64(v[0], 1) + rotl64(v[1], 7) + rotl64(v[2], 12) + rotl64(v[3], 18);
+	} else {
+		h = seed + JSON_HASH_P3;
+	}
+	h += (unsigned long long)len;
+	for(; end - p >= 8; p += 8) {
+		memcpy(&w, p, 8);
+		h = rotl64(h ^ hashRound(0, w), 27) * JSON_HASH_P1 + JSON_HASH_P3;
+	}
+	for(; p < end; p++) {
+		h = rotl64(h ^ (*p * JSON_HASH_P3), 11) * JSON_HASH_P1;
+	}
+	h ^= h >> 33;
+	h *= JSON_HASH_P2;
+	h ^= h >> 29;
+	h *= JSON_HASH_P3;
+	h ^= h >> 32;
+	return h;
+}
+
+static inline unsigned long long alignUp(unsigned long long pos)
+{
+	return (pos + JSON_SNAPSHOT_ALIGN - 1) & ~(unsigned long long)(JSON_SNAPSHOT_ALIGN - 1);
+}
+
+// запись блока целиком (write может записать часть)
+static bool writeAll(int fh, const void *data, size_t len)
+{
+	const char	*p = (const char*)data;
+	ssize_t		n;
+
+	while(len > 0) {
+		n = write(fh, p, len);
+		if(n <= 0) {
+			return false;
+		}
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+// сохранение снимка (контекст потока по умолчанию), см. jsonSnapshotSave_r
+int jsonSnapshotSave(_jsonObj_t *jsonObj, const char *fileName)
+{
+	return jsonSnapshotSave_r(jsonObj, fileName, jsonDefaultCtx());
+}
+
+/* сохранение снимка успешно разобранного документа
+ * fileName			файл снимка (заменяется целиком)
+ * return:			0 - успех, 1 - ошибка записи (JSON_ERR_FILE)
+ * Правки (jsonEditSet) в снимок не попадают
+*/
+int jsonSnapshotSave_r(_jsonObj_t *jsonObj, const char *fileName, _jsonCtx_t *ctx)
+{
+	static const char	pad[JSON_SNAPSHOT_ALIGN] = {0};
+	_snapHeader_t		hdr;
+	char				tmpName[PATH_MAX];
+	int					fh;
+	bool				ok;
+
+	if((jsonObj->sax != NULL) || (jsonObj->token == NULL) || (jsonObj->json == NULL)) {
+		setError(ctx, 0, 1, '.', JSON_ERR_FILE);
+		return 1;
+	}
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, snapMagic, sizeof(snapMagic));
+	hdr.version = JSON_SNAPSHOT_VERSION;
+	hdr.order = JSON_SNAPSHOT_ORDER;
+	hdr.tokenSize = sizeof(_jsonToken_t);
+	hdr.offSize = sizeof(_jsonOff_t);
+#ifdef JSON_COMPACT_TOKENS
+	hdr.flags = JSON_SNAPSHOT_COMPACT;
+#endif
+	hdr.count = jsonObj->count;
+	hdr.nesting = jsonObj->nesting;
+	hdr.tokens = (jsonObj->count > 0) ? jsonObj->count : 1;
+	hdr.tokenPos = alignUp(sizeof(hdr));
+	hdr.jsonPos = alignUp(hdr.tokenPos + hdr.tokens * sizeof(_jsonToken_t));
+	// длина - разобранная: у документа пакета (jsonParseBatch) за ней идёт следующий документ, а не ноль
+	hdr.jsonLen = jsonObj->len;
+	hdr.hash = jsonHash64(jsonObj->json, hdr.jsonLen, jsonHash64(jsonObj->token, hdr.tokens * sizeof(_jsonToken_t), 0));
+
+	if(snprintf(tmpName, sizeof(tmpName), "%s.%d.tmp", fileName, (int)getpid()) >= (int)sizeof(tmpName)) {
+		setError(ctx, 0, 1, '.', JSON_ERR_FILE);
+		return 1;
+	}
+	fh = open(tmpName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fh < 0) {
+		setError(ctx, 0, 1, '.', JSON_ERR_FILE);
+		return 1;
+	}
+	ok = writeAll(fh, &hdr, sizeof(hdr)) &&
+		writeAll(fh, pad, hdr.tokenPos - sizeof(hdr)) &&
+		writeAll(fh, jsonObj->token, hdr.tokens * sizeof(_jsonToken_t)) &&
+		writeAll(fh, pad, hdr.jsonPos - hdr.tokenPos - hdr.tokens * sizeof(_jsonToken_t)) &&
+		writeAll(fh, jsonObj->json, hdr.jsonLen) &&
+		writeAll(fh, pad, 1);
+	ok = (close(fh) == 0) && ok;
+	if(!ok || (rename(tmpName, fileName) != 0)) {
+		unlink(tmpName);
+		setError(ctx, 0, 1, '.', JSON_ERR_FILE);
+		return 1;
+	}
+	return 0;
+}
+
+// заголовок снимка подходит этой сборке и не выходит за файл
+static bool checkHeader(const _snapHeader_t *hdr, unsigned long long size)
+{
+	unsigned int	flags = 0;
+
+#ifdef JSON_COMPACT_TOKENS
+	flags = JSON_SNAPSHOT_COMPACT;
+#endif
+	if((memcmp(hdr->magic, snapMagic, sizeof(snapMagic)) != 0) || (hdr->version != JSON_SNAPSHOT_VERSION) ||
+		(hdr->order != JSON_SNAPSHOT_ORDER) || (hdr->tokenSize != sizeof(_jsonToken_t)) ||
+		(hdr->offSize != sizeof(_jsonOff_t)) || (hdr->flags != flags))
+	{
+		return false;
+	}
+	if((hdr->count > (unsigned long long)JSON_OFF_MAX) || (hdr->jsonLen > (unsigned long long)JSON_OFF_MAX) ||
+		(hdr->tokens != ((hdr->count > 0) ? hdr->count : 1)) || (hdr->nesting > (unsigned long long)INT_MAX))
+	{
+		return false;
+	}
+	return (hdr->tokenPos >= sizeof(_snapHeader_t)) && (hdr->tokenPos % JSON_SNAPSHOT_ALIGN == 0) &&
+		(hdr->tokenPos <= size) && (hdr->tokens <= (size - hdr->tokenPos) / sizeof(_jsonToken_t)) &&
+		(hdr->jsonPos >= hdr->tokenPos + hdr->tokens * sizeof(_jsonToken_t)) &&
+		(hdr->jsonPos <= size) && (hdr->jsonLen < size - hdr->jsonPos);
+}
+
+// загрузка снимка (контекст потока по умолчанию), см. jsonSnapshotLoad_r
+int jsonSnapshotLoad(const char *fileName, _jsonObj_t **jsonObj)
+{
+	return jsonSnapshotLoad_r(fileName, jsonObj, jsonDefaultCtx());
+}
+
+/* загрузка снимка без разбора
+ * jsonObj			OUT неинициализированный указатель на _jsonObj_t (освобождается clearFlatJsonObj)
+ * return:			0 - успех, 1 - ошибка: JSON_ERR_FILE - файл не прочитан,
+ *					JSON_ERR_SNAPSHOT - не снимок, снимок другой сборки или повреждён. *jsonObj == NULL
+*/
+int jsonSnapshotLoad_r(const char *fileName, _jsonObj_t **jsonObj, _jsonCtx_t *ctx)
+{
+	const _snapHeader_t	*hdr;
+	struct stat			st;
+	char				*map;
+	int					fh;
+
+	*jsonObj = NULL;
+	fh = open(fileName, O_RDONLY);
+	if(fh < 0) {
+		setError(ctx, 0, 1, '.', JSON_ERR_FILE);
+		return 1;
+	}
+	if(fstat(fh, &st) != 0) {
+		close(fh);
+		setError(ctx, 0, 1, '.', JSON_ERR_FILE);
+		return 1;
+	}
+	if((size_t)st.st_size < sizeof(_snapHeader_t)) {
+		close(fh);
+		setError(ctx, 0, 1, '.', JSON_ERR_SNAPSHOT);
+		return 1;
+	}
+	map = (char*)mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fh, 0);
+	close(fh);
+	if(map == MAP_FAILED) {
+		setError(ctx, 0, 1, '.', JSON_ERR_FILE);
+		return 1;
+	}
+
+	hdr = (const _snapHeader_t*)map;
+	if(!checkHeader(hdr, st.st_size) || (map[hdr->jsonPos + hdr->jsonLen] != 0) ||
+		(jsonHash64(map + hdr->jsonPos, hdr->jsonLen, jsonHash64(map + hdr->tokenPos, hdr->tokens * sizeof(_jsonToken_t), 0)) != hdr->hash))
+	{
+		munmap(map, st.st_size);
+		setError(ctx, 0, 1, '.', JSON_ERR_SNAPSHOT);
+		return 1;
+	}
+
+	*jsonObj = (_jsonObj_t*)malloc(sizeof(_jsonObj_t));
+	jsonDocInit(*jsonObj, NULL);
+	(*jsonObj)->map = map;
+	(*jsonObj)->mapSize = st.st_size;
+	(*jsonObj)->json = map + hdr->jsonPos;
+	(*jsonObj)->len = (_jsonLen_t)hdr->jsonLen;
+	(*jsonObj)->token = (_jsonToken_t*)(map + hdr->tokenPos);
+	(*jsonObj)->count = (_jsonOff_t)hdr->count;
+	(*jsonObj)->nesting = (int)hdr->nesting;
+	// capacity == 0: токены не принадлежат документу (см. jsonTokensMapped)
+	return 0;
+}
@@ -0,0 +1,119 @@
+/* parse and lookup statistics for dirty json parser
+ * Avinfors, O.Nikitin
+ *
+ * Упоротость и отвага!
+*/
+
+/* Статистика разбора и поиска (сборка библиотеки и клиентов с -DJSON_STATS)
+ * Счётчики лежат в контексте (_jsonCtx_t) и копятся между вызовами до jsonStatsReset_r:
+ *  - разборы jsonDocParse (и всё, что через него: jsonParser, jsonParseFile, jsonReparse): байты, токены,
+ *    расширения массива токенов против начальной оценки len >> 4, вложенность, байты комментариев
+ *  - такты по фазам: подготовка, разбор, индекс, поиск по пути, сериализация
+ *  - гистограммы задержек поиска (xPathNode, а значит xPath и getJson*) и сериализации (jsonWrite,
+ *    jsonAsString_r) по степеням двойки
+ * Документ контекст разбора не запоминает (один документ читают из нескольких потоков, контекст разбора может
+ * быть уже освобождён), поэтому поиск, индекс и сериализация учитываются в контексте вызова: варианты _r
+ * (xPathNode_r, jsonBuildIndex_r, jsonWrite_r, jsonAsString_r, jsonBind_r, jsonCacheGet_r) - в переданном,
+ * функции без контекста (xPath, getJson*, jsonWrite, jsonBuildIndex, ленивый jsonIndexKey) - в контексте потока по умолчанию.
+ * Разбор по частям (jsonStream*, jsonParseSax, jsonValidate) в счётчики разборов не попадает, ошибки - попадают
+ *
+ * Без JSON_STATS сбор раскрывается в ничто, а jsonStats_r возвращает NULL
+ *
+ *	const _jsonStats_t *st = jsonStats();
+ *	if(st != NULL) {
+ *		printf("parses %llu, tokens %llu (expected %llu), reallocs %llu\n",
+ *			st->parses, st->tokens, st->tokensExpected, st->reallocs);
+ *		for(i=0; i<JSON_STATS_BUCKETS; i++) {
+ *			... st->lookupHist[i] - поисков дольше 2^(i-1) и не дольше 2^i тактов
+ *		}
+ *	}
+*/
+
+#include "json.h"
+
+// статистика контекста потока по умолчанию, см. jsonStats_r
+const _jsonStats_t* jsonStats()
+{
+	return jsonStats_r(jsonDefaultCtx());
+}
+
+/* статистика контекста
+ * return:			счётчики (живут в контексте) или NULL - библиотека собрана без JSON_STATS
+*/
+const _jsonStats_t* jsonStats_r(_jsonCtx_t *ctx)
+{
+#ifdef JSON_STATS
+	return &ctx->stats;
+#else
+	(void)ctx;
+	return NULL;
+#endif
+}
+
+void jsonStatsReset()
+{
+	jsonStatsReset_r(jsonDefaultCtx());
+}
+
+// обнуление счётчиков контекста
+void jsonStatsReset_r(_jsonCtx_t *ctx)
+{
+#ifdef JSON_STATS
+	memset(&ctx->stats, 0, sizeof(_jsonStats_t));
+#else
+	(void)ctx;
+#endif
+}
+
+#ifdef JSON_STATS
+// корзина гистограммы: n - от 2^(n-1) до 2^n тактов
+static inline int bucket(unsigned long long cycles)
+{
+	int		n = (cycles == 0) ? 0 : 64 - __builtin_clzll(cycles);
+
+	return (n < JSON_STATS_BUCKETS) ? n : JSON_STATS_BUCKETS - 1;
+}
+
+/* учёт фазы (JSON_STATS_PHASE)
+ * start			отметка начала фазы
+ * return:			текущая отметка (начало следующей фазы)
+*/
+unsigned long long jsonStatsPhase(_jsonCtx_t *ctx, int phase, unsigned long long start)
+{
+	unsigned long long	now = jsonStatsClock(), cycles = now - start;
+
+	ctx->stats.cycles[phase] += cycles;
+	ctx->stats.calls[phase]++;
+	if(phase == JSON_STATS_LOOKUP) {
+		ctx->stats.lookupHist[bucket(cycles)]++;
+	} else if(phase == JSON_STATS_WRITE) {
+		ctx->stats.writeHist[bucket(cycles)]++;
+	}
+	return now;
+}
+
+/* учёт разбора jsonDocParse
+ * expect			начальная оценка кол-ва токенов
+ * capacity			размер массива токенов после jsonParseBegin: массив растёт удвоением (assignNewToken),
+ *					поэтому кол-во расширений - log2 отношения конечного размера к нему
+ * st				состояние после jsonParseRun (байты комментариев)
+ * res				результат jsonParseRun
+*/
+void jsonStatsParse(_jsonCtx_t *ctx, _jsonObj_t *doc, const _jsonParseState_t *st, _jsonLen_t len, _jsonOff_t expect, _jsonOff_t capacity, int res)
+{
+	if((res != 0) || (doc->sax != NULL)) {
+		return;
+	}
+	ctx->stats.parses++;
+	ctx->stats.bytes += len;
+	ctx->stats.tokens += doc->count;
+	ctx->stats.tokensExpected += expect;
+	ctx->stats.commentBytes += st->commentBytes;
+	for(; (capacity > 0) && (capacity < doc->capacity); capacity <<= 1) {
+		ctx->stats.reallocs++;
+	}
+	if(doc->nesting > ctx->stats.maxNesting) {
+		ctx->stats.maxNesting = doc->nesting;
+	}
+}
+#endif
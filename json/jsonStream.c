@@ -0,0 +1,96 @@
+/* incremental (chunked) input for dirty json parser
+ * Avinfors, O.Nikitin
+ *
+ * Упоротость и отвага!
+*/
+
+/* Разбор json'а по мере поступления данных (из сокета, pipe и т.п.)
+ * Каждая порция дописывается в буфер потока и сразу разбирается, насколько это возможно:
+ * состояние парсера (уровень вложенности, кавычки, последний управляющий символ...) сохраняется
+ * между порциями. Результат - тот же документ и те же ошибки (строка, столбец), что и у jsonParser.
+ * Буфер потока становится исходной строкой документа и освобождается вместе с ним
+ *
+ *	_jsonStream_t	*stream = jsonStreamInit();
+ *	while((n = read(fh, buff, sizeof(buff))) > 0) {
+ *		if(jsonStreamFeed(stream, buff, n) != 0) break;		// ошибка видна сразу, не дожидаясь конца данных
+ *	}
+ *	if(jsonStreamFinish(stream, &jsonObj) == 0) ...
+ *	jsonStreamFree(&stream);
+*/
+
+#include "json.h"
+
+_jsonStream_t* jsonStreamInit()
+{
+	_jsonStream_t	*stream = (_jsonStream_t*)malloc(sizeof(_jsonStream_t));
+
+	jsonCtxInit(&stream->ctx);
+	strinit2(&stream->buff, STRING2_BUFF_INITIAL_SIZE);
+	stream->buff->buff[0] = 0;
+	stream->doc = (_jsonObj_t*)malloc(sizeof(_jsonObj_t));
+	jsonDocInit(stream->doc, NULL);
+	stream->res = jsonParseBegin(stream->doc, &stream->state, stream->buff->buff, 64, &stream->ctx);
+	if(stream->res == 0) {
+		stream->res = JSON_PARSE_MORE;
+	}
+	return stream;
+}
+
+/* очередная порция данных
+ * return:			0 - порция принята, 1 - json ошибочен или не помещается в буфер потока (до INT_MAX байт,
+ *					JSON_ERR_NO_MEMORY) (см. jsonStreamError)
+*/
+int jsonStreamFeed(_jsonStream_t *stream, const char *chunk, _jsonLen_t len)
+{
+	if(stream->res != JSON_PARSE_MORE) {
+		return 1;
+	}
+	if(len > (_jsonLen_t)(INT_MAX - stream->buff->strLen)) {
+		setError(&stream->ctx, stream->state.line, stream->state.col, '.', JSON_ERR_NO_MEMORY);
+		stream->res = 1;
+		return 1;
+	}
+	strncat2(&stream->buff, chunk, len, 0);
+	stream->res = jsonParseRun(stream->doc, &stream->state, stream->buff->buff, stream->buff->strLen, false, &stream->ctx);
+	return (stream->res == 1) ? 1 : 0;
+}
+
+/* конец данных
+ * jsonObj			OUT документ (освобождается clearFlatJsonObj, вместе с ним - буфер потока)
+ * return:			0 - успех, 1 - json ошибочен
+ * После вызова поток больше не принимает данные
+*/
+int jsonStreamFinish(_jsonStream_t *stream, _jsonObj_t **jsonObj)
+{
+	if(stream->res == JSON_PARSE_MORE) {
+		stream->res = jsonParseRun(stream->doc, &stream->state, stream->buff->buff, stream->buff->strLen, true, &stream->ctx);
+	}
+	// буфер переходит к документу
+	*jsonObj = stream->doc;
+	(*jsonObj)->own = stream->buff->buff;
+	free(stream->buff);
+	stream->buff = NULL;
+	stream->doc = NULL;
+	return stream->res;
+}
+
+_jsonErr_t* jsonStreamError(_jsonStream_t *stream)
+{
+	return getLastError_r(&stream->ctx);
+}
+
+void jsonStreamFree(_jsonStream_t **stream)
+{
+	if((stream == NULL) || (*stream == NULL)) {
+		return;
+	}
+	if((*stream)->doc != NULL) {
+		clearFlatJsonObj(&(*stream)->doc);
+	}
+	if((*stream)->buff != NULL) {
+		strfree2(&(*stream)->buff);
+	}
+	jsonCtxFree(&(*stream)->ctx);
+	free(*stream);
+	*stream = NULL;
+}
@@ -0,0 +1,205 @@
+/* string unescaping for dirty json parser
+ * Avinfors, O.Nikitin
+ *
+ * Упоротость и отвага!
+*/
+
+/* Декодирование строк: \" \\ \/ \b \f \n \r \t \uXXXX (включая суррогатные пары, результат - UTF-8)
+ * и "грязное" \' . Неизвестная последовательность \x даёт x (как в JavaScript)
+ *
+ * Парсер отмечает в токене (escaped), есть ли в строке обратная косая черта: чистые строки
+ * отдаются без копирования (jsonTokenText), остальные декодируются в буфер клиента или арену.
+ * Участки без escape-последовательностей копируются блоками по 16 байт (SSE2), поэтому
+ * не-ASCII текст (кириллица в UTF-8) не обрабатывается побайтно
+ *
+ * Результат никогда не длиннее исходной строки: буфера размером (end - start + 1) всегда достаточно
+*/
+
+#include "json.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// копирование до обратной косой черты или конца строки, возврат - позиция '\' (или end)
+static const char* copyRun(const char *p, const char *end, char **dst)
+{
+	char	*d = *dst;
+
+#if defined(__SSE2__)
+	const __m128i	bsl = _mm_set1_epi8('\\');
+	__m128i			v;
+	int				m;
+
+	// запись блока целиком безопасна: d отстаёт от p, а буфер не короче исходной строки
+	while(end - p >= 16) {
+		v = _mm_loadu_si128((const __m128i*)p);
+		_mm_storeu_si128((__m128i*)d, v);
+		m = _mm_movemask_epi8(_mm_cmpeq_epi8(v, bsl));
+		if(m != 0) {
+			m = __builtin_ctz(m);
+			*dst = d + m;
+			return p + m;
+		}
+		p += 16;
+		d += 16;
+	}
+#endif
+	while((p < end) && (*p != '\\')) {
+		*d++ = *p++;
+	}
+	*dst = d;
+	return p;
+}
+
+// 4 hex-цифры, -1 - ошибка
+static int hex4(const char *p)
+{
+	int		i, c, res = 0;
+
+	for(i=0; i<4; i++) {
+		c = p[i];
+		if((c >= '0') && (c <= '9')) {
+			c -= '0';
+		} else if((c >= 'a') && (c <= 'f')) {
+			c -= 'a' - 10;
+		} else if((c >= 'A') && (c <= 'F')) {
+			c -= 'A' - 10;
+		} else {
+			return -1;
+		}
+		res = (res << 4) | c;
+	}
+	return res;
+}
+
+static char* utf8(char *d, unsigned int cp)
+{
+	if(cp < 0x80) {
+		*d++ = cp;
+	} else if(cp < 0x800) {
+		*d++ = 0xC0 | (cp >> 6);
+		*d++ = 0x80 | (cp & 0x3F);
+	} else if(cp < 0x10000) {
+		*d++ = 0xE0 | (cp >> 12);
+		*d++ = 0x80 | ((cp >> 6) & 0x3F);
+		*d++ = 0x80 | (cp & 0x3F);
+	} else {
+		*d++ = 0xF0 | (cp >> 18);
+		*d++ = 0x80 | ((cp >> 12) & 0x3F);
+		*d++ = 0x80 | ((cp >> 6) & 0x3F);
+		*d++ = 0x80 | (cp & 0x3F);
+	}
+	return d;
+}
+
+/* декодирование строки
+ * src, len			IN  исходная строка (без кавычек)
+ * dst				OUT буфер не менее len + 1 байт (результат завершается нулём)
+ * return:			длина результата
+*/
+_jsonOff_t jsonUnescape(const char *src, _jsonOff_t len, char *dst)
+{
+	const char	*p = src, *end = src + len;
+	char		*d = dst;
+	int			cp, lo;
+
+	while(p < end) {
+		p = copyRun(p, end, &d);
+		if(p == end) {
+			break;
+		}
+		// p - на '\'
+		if(p + 1 == end) {
+			*d++ = *p++;
+			break;
+		}
+		switch(p[1]) {
+			case 'b':	*d++ = '\b';	break;
+			case 'f':	*d++ = '\f';	break;
+			case 'n':	*d++ = '\n';	break;
+			case 'r':	*d++ = '\r';	break;
+			case 't':	*d++ = '\t';	break;
+			case 'u':
+				cp = (end - p >= 6) ? hex4(p + 2) : -1;
+				if(cp < 0) {
+					// битая последовательность остаётся как есть
+					*d++ = '\\';
+					p++;
+					continue;
+				}
+				p += 4;
+				if((cp >= 0xD800) && (cp <= 0xDBFF)) {
+					// суррогатная пара
+					lo = ((end - p >= 8) && (p[2] == '\\') && (p[3] == 'u')) ? hex4(p + 4) : -1;
+					if((lo >= 0xDC00) && (lo <= 0xDFFF)) {
+						cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+						p += 6;
+					} else {
+						cp = 0xFFFD;
+					}
+				} else if((cp >= 0xDC00) && (cp <= 0xDFFF)) {
+					cp = 0xFFFD;
+				}
+				d = utf8(d, cp);
+				break;
+			default:
+				// \" \\ \/ \' и неизвестные: сам символ
+				*d++ = p[1];
+		}
+		p += 2;
+	}
+	*d = 0;
+	return d - dst;
+}
+
+/* строка ключа/значения в буфер клиента
+ * buff, size		буфер и его размер (достаточно token->end - token->start + 1)
+ * return:			длина результата или -1 (токен - не ключ и не значение, буфер мал)
+*/
+_jsonOff_t jsonTokenString(_jsonObj_t *jsonObj, _jsonToken_t *token, char *buff, _jsonOff_t size)
+{
+	_jsonOff_t	len = token->end - token->start;
+
+	if(((token->type != JSON_KEY) && (token->type != JSON_VALUE)) || (size <= len)) {
+		return -1;
+	}
+	if(!token->escaped) {
+		memcpy(buff, jsonObj->json + token->start, len);
+		buff[len] = 0;
+		return len;
+	}
+	return jsonUnescape(jsonObj->json + token->start, len, buff);
+}
+
+/* строка ключа/значения без лишнего копирования
+ * Строка без escape-последовательностей - указатель в исходный json (как jsonTokenView),
+ * иначе - декодированная копия в арене (завершается нулём)
+ * return:			false - токен не ключ и не значение, или строку нужно декодировать, а арены нет/мала
+*/
+bool jsonTokenText(_jsonObj_t *jsonObj, _jsonToken_t *token, _jsonArena_t *arena, _jsonView_t *view)
+{
+	_jsonOff_t	len = token->end - token->start;
+	char		*buff;
+
+	if((token->type != JSON_KEY) && (token->type != JSON_VALUE)) {
+		return false;
+	}
+	view->type = token->type;
+	view->valueType = token->valueType;
+	if(!token->escaped) {
+		view->ptr = jsonObj->json + token->start;
+		view->len = len;
+		return true;
+	}
+	if(arena == NULL) {
+		return false;
+	}
+	buff = (char*)jsonArenaAlloc(arena, len + 1);
+	if(buff == NULL) {
+		return false;
+	}
+	view->len = jsonUnescape(jsonObj->json + token->start, len, buff);
+	view->ptr = buff;
+	return true;
+}
@@ -0,0 +1,754 @@
+/* dirty to strict json transcoder for dirty json parser
+ * Avinfors, O.Nikitin
+ *
+ * Упоротость и отвага!
+*/
+
+/* Преобразование "грязного" json'а в строгий (RFC 8259) за один проход, без дерева токенов
+ * Данные принимаются порциями, память - постоянная (состояние + выходной буфер), результат
+ * отдаётся приёмнику по мере заполнения буфера:
+ *  - комментарии // и / * * / удаляются
+ *  - ключи без кавычек и строки в одинарных кавычках - в двойных кавычках; " внутри строки экранируется,
+ *    \' становится ', управляющие символы (перевод строки в строке и т.п.) - escape-последовательностями
+ *  - запятые ставятся между элементами: висячие (перед ] и }) отбрасываются, пропущенные - добавляются
+ *  - числа: 007 -> 7, 1. -> 1.0
+ * Отступы сохраняются как есть
+ *
+ * Остальное проверяется, как в строгом json'е: ключ - ':' - значение, одно значение в корне, числа
+ * -?цифры[.цифры][e[+-]цифры] (.5, 1-2, 1e - ошибка), \u и 4 шестнадцатеричные цифры. Неизвестная
+ * escape-последовательность \x сохраняется вместе с '\' (\\x)
+ *
+ * Пропуск строк, отступов, слов без кавычек и тел комментариев - по структурному индексу (jsonScan),
+ * как в парсере: побайтово обрабатываются только кавычки, скобки, разделители и escape-последовательности
+ *
+ *	_jsonTranscode_t	*tc = jsonTranscodeInit(sink, arg);
+ *	while((n = read(fh, buff, sizeof(buff))) > 0) {
+ *		if(jsonTranscodeFeed(tc, buff, n) != 0) break;
+ *	}
+ *	if(jsonTranscodeFinish(tc) != 0) ... jsonTranscodeError(tc)
+ *	jsonTranscodeFree(&tc);
+*/
+
+#include "json.h"
+#include "jsonScan.h"
+#include <stddef.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// где находимся (_jsonTranscode_t.mode)
+#define				TC_NONE				(int)	0		// между элементами
+#define				TC_STRING			(int)	1		// строка в кавычках
+#define				TC_STRING_ESC		(int)	2		// строка, после '\'
+#define				TC_KEY				(int)	3		// ключ без кавычек
+#define				TC_NUMBER			(int)	4
+#define				TC_LITERAL			(int)	5		// true, false, null
+#define				TC_SLASH			(int)	6		// '/', ждём второй символ комментария
+#define				TC_LINE_COMMENT		(int)	7
+#define				TC_BLOCK_COMMENT	(int)	8
+#define				TC_BLOCK_STAR		(int)	9		// блочный комментарий, после '*'
+#define				TC_STRING_HEX		(int)	10		// строка, цифры \uXXXX
+
+// состояние числа (_jsonTranscode_t.num)
+#define				TC_NUM_START		(int)	0		// ничего ещё не было
+#define				TC_NUM_MINUS		(int)	1		// после '-'
+#define				TC_NUM_ZERO			(int)	2		// пока только нули (ведущие нули отбрасываются)
+#define				TC_NUM_INT			(int)	3
+#define				TC_NUM_DOT			(int)	4		// сразу после '.'
+#define				TC_NUM_FRAC			(int)	5		// дробная часть
+#define				TC_NUM_EXP			(int)	6		// сразу после 'e'
+#define				TC_NUM_EXP_SIGN		(int)	7		// после знака порядка
+#define				TC_NUM_EXP_DIGIT	(int)	8		// цифры порядка
+
+static void flush(_jsonTranscode_t *tc)
+{
+	if((tc->outLen > 0) && (tc->res == 0)) {
+		if(tc->sink(tc->arg, tc->out, tc->outLen) != 0) {
+			setError(&tc->ctx, tc->line, 0, '.', JSON_ERR_OUTPUT);
+			tc->res = 1;
+		}
+	}
+	tc->outLen = 0;
+}
+
+static inline __attribute__ ((always_inline)) void putN(_jsonTranscode_t *tc, const char *p, size_t n)
+{
+	if(tc->outLen + n > JSON_TRANSCODE_BUFF) {
+		flush(tc);
+		if(n >= JSON_TRANSCODE_BUFF) {
+			// длинный участок - приёмнику напрямую
+			if((tc->res == 0) && (tc->sink(tc->arg, p, n) != 0)) {
+				setError(&tc->ctx, tc->line, 0, '.', JSON_ERR_OUTPUT);
+				tc->res = 1;
+			}
+			return;
+		}
+	}
+	if(n <= 16) {
+		// короткие ключи/значения: вызов memcpy дороже копирования
+		char	*d = tc->out + tc->outLen;
+		size_t	k;
+
+		for(k=0; k<n; k++) {
+			d[k] = p[k];
+		}
+	} else {
+		memcpy(tc->out + tc->outLen, p, n);
+	}
+	tc->outLen += n;
+}
+
+static inline __attribute__ ((always_inline)) void put(_jsonTranscode_t *tc, char c)
+{
+	if(tc->outLen == JSON_TRANSCODE_BUFF) {
+		flush(tc);
+	}
+	tc->out[tc->outLen++] = c;
+}
+
+/* копирование участка строки до управляющего символа (< 0x20)
+ * Копирование и поиск - одним проходом, блоками по 16 байт (SSE2): в выходном буфере оставляется запас,
+ * поэтому блок пишется целиком
+ * return:			длина скопированного участка
+*/
+static inline __attribute__ ((always_inline)) size_t copyPlain(_jsonTranscode_t *tc, const char *p, size_t n)
+{
+	char	*d;
+	size_t	i = 0;
+
+	if(tc->outLen + n + 16 > JSON_TRANSCODE_BUFF) {
+		flush(tc);
+	}
+	d = tc->out + tc->outLen;
+#if defined(__SSE2__)
+	const __m128i	ctl = _mm_set1_epi8(0x1F);
+	__m128i			v;
+	int				m;
+
+	for(; i + 16 <= n; i += 16) {
+		v = _mm_loadu_si128((const __m128i*)(p + i));
+		_mm_storeu_si128((__m128i*)(d + i), v);
+		// v <= 0x1F (без знака) <=> min(v, 0x1F) == v
+		m = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(v, ctl), v));
+		if(m != 0) {
+			i += __builtin_ctz(m);
+			tc->outLen += i;
+			return i;
+		}
+	}
+#endif
+	for(; (i < n) && ((unsigned char)p[i] >= 0x20); i++) {
+		d[i] = p[i];
+	}
+	tc->outLen += i;
+	return i;
+}
+
+// текст строки: управляющие символы - escape-последовательностями
+static void putText(_jsonTranscode_t *tc, const char *p, size_t n)
+{
+	static const char	hex[] = "0123456789abcdef";
+	char				esc[6] = {'\\', 'u', '0', '0', 0, 0};
+	size_t				k, part;
+
+	while(n > 0) {
+		// длинная строка - частями, чтобы участок с запасом помещался в выходной буфер
+		part = (n > JSON_TRANSCODE_BUFF / 2) ? JSON_TRANSCODE_BUFF / 2 : n;
+		k = copyPlain(tc, p, part);
+		p += k;
+		n -= k;
+		if(k == part) {
+			continue;
+		}
+		switch(*p) {
+			case '\n':	putN(tc, "\\n", 2);	break;
+			case '\r':	putN(tc, "\\r", 2);	break;
+			case '\t':	putN(tc, "\\t", 2);	break;
+			case '\b':	putN(tc, "\\b", 2);	break;
+			case '\f':	putN(tc, "\\f", 2);	break;
+			default:
+				esc[4] = hex[(unsigned char)*p >> 4];
+				esc[5] = hex[*p & 0x0F];
+				putN(tc, esc, 6);
+		}
+		p++;
+		n--;
+	}
+}
+
+// ключ без кавычек: \ и управляющие символы - escape-последовательностями
+static void putKey(_jsonTranscode_t *tc, const char *p, size_t n)
+{
+	const char	*bs;
+
+	while((bs = (const char*)memchr(p, '\\', n)) != NULL) {
+		putText(tc, p, bs - p);
+		putN(tc, "\\\\", 2);
+		n -= bs + 1 - p;
+		p = bs + 1;
+	}
+	putText(tc, p, n);
+}
+
+// отступ: после законченного элемента откладывается (до запятой), лишнее сверх буфера отбрасывается
+static inline __attribute__ ((always_inline)) void putSpace(_jsonTranscode_t *tc, const char *p, size_t n)
+{
+	if(!tc->hold) {
+		putN(tc, p, n);
+		return;
+	}
+	if(n > (size_t)(JSON_TRANSCODE_HOLD - tc->holdLen)) {
+		n = JSON_TRANSCODE_HOLD - tc->holdLen;
+	}
+	for(; n>0; n--) {
+		tc->holdBuff[tc->holdLen++] = *p++;
+	}
+}
+
+static inline __attribute__ ((always_inline)) void flushHold(_jsonTranscode_t *tc)
+{
+	if(tc->hold) {
+		putN(tc, tc->holdBuff, tc->holdLen);
+		tc->hold = false;
+		tc->holdLen = 0;
+	}
+}
+
+static void fail(_jsonTranscode_t *tc, unsigned long long pos, char ch, int errNum)
+{
+	setError(&tc->ctx, tc->line, (int)(pos - tc->lineStart) + 1, ch, errNum);
+	tc->res = 1;
+}
+
+static inline bool inObject(_jsonTranscode_t *tc)
+{
+	return (tc->level > 0) && ((tc->obj[(tc->level - 1) >> 6] >> ((tc->level - 1) & 63)) & 1);
+}
+
+/* начало элемента: запятая после предыдущего элемента контейнера (кроме значения ключа)
+ * Элемент в объекте без ':' перед ним - ключ (tc->key)
+ * pos, c			позиция и символ начала элемента (для ошибки)
+ * return:			false - элемент здесь недопустим: после ключа нет ':', второе значение в корне
+*/
+static inline __attribute__ ((always_inline)) bool elementStart(_jsonTranscode_t *tc, unsigned long long pos, char c)
+{
+	if(tc->afterKey || (tc->hold && (tc->level == 0))) {
+		fail(tc, pos, c, JSON_ERR_UNEXPECTED_SYMBOL);
+		return false;
+	}
+	if(tc->hold && (tc->level > 0) && !tc->afterColon) {
+		put(tc, ',');
+	}
+	flushHold(tc);
+	tc->key = inObject(tc) && !tc->afterColon;
+	tc->afterColon = false;
+	tc->comma = false;
+	return true;
+}
+
+static inline __attribute__ ((always_inline)) void elementDone(_jsonTranscode_t *tc)
+{
+	tc->mode = TC_NONE;
+	tc->hold = true;
+	tc->holdLen = 0;
+	tc->afterKey = tc->key;
+	tc->key = false;
+}
+
+// конец числа: 007 -> 7, 1. -> 1.0; без цифр (-, 1e, 1e+) - ошибка
+static inline __attribute__ ((always_inline)) void numberDone(_jsonTranscode_t *tc, unsigned long long pos, char c)
+{
+	if((tc->num == TC_NUM_START) || (tc->num == TC_NUM_MINUS) || (tc->num == TC_NUM_EXP) || (tc->num == TC_NUM_EXP_SIGN)) {
+		fail(tc, pos, c, JSON_ERR_ILLEGAL_SYMBOL);
+		return;
+	}
+	if((tc->num == TC_NUM_ZERO) || (tc->num == TC_NUM_DOT)) {
+		put(tc, '0');
+	}
+	elementDone(tc);
+}
+
+/* очередной символ числа
+ * return:			false - символ в числе недопустим
+*/
+static inline __attribute__ ((always_inline)) bool numberChar(_jsonTranscode_t *tc, char c)
+{
+	if((c >= '0') && (c <= '9')) {
+		switch(tc->num) {
+			case TC_NUM_START:
+			case TC_NUM_MINUS:
+			case TC_NUM_ZERO:
+				if(c == '0') {
+					tc->num = TC_NUM_ZERO;
+					return true;
+				}
+				tc->num = TC_NUM_INT;
+				break;
+			case TC_NUM_DOT:
+				tc->num = TC_NUM_FRAC;
+				break;
+			case TC_NUM_EXP:
+			case TC_NUM_EXP_SIGN:
+				tc->num = TC_NUM_EXP_DIGIT;
+				break;
+		}
+	} else if(c == '-') {
+		if(tc->num == TC_NUM_START) {
+			tc->num = TC_NUM_MINUS;
+		} else if(tc->num == TC_NUM_EXP) {
+			tc->num = TC_NUM_EXP_SIGN;
+		} else {
+			return false;
+		}
+	} else if(c == '+') {
+		if(tc->num != TC_NUM_EXP) {
+			return false;
+		}
+		tc->num = TC_NUM_EXP_SIGN;
+	} else if(c == '.') {
+		if((tc->num != TC_NUM_ZERO) && (tc->num != TC_NUM_INT)) {
+			return false;
+		}
+		if(tc->num == TC_NUM_ZERO) {
+			put(tc, '0');
+		}
+		tc->num = TC_NUM_DOT;
+	} else if((c == 'e') || (c == 'E')) {
+		if((tc->num != TC_NUM_ZERO) && (tc->num != TC_NUM_INT) && (tc->num != TC_NUM_DOT) && (tc->num != TC_NUM_FRAC)) {
+			return false;
+		}
+		if((tc->num == TC_NUM_ZERO) || (tc->num == TC_NUM_DOT)) {
+			put(tc, '0');
+		}
+		tc->num = TC_NUM_EXP;
+	} else {
+		return false;
+	}
+	put(tc, c);
+	return true;
+}
+
+static inline bool isHex(char c)
+{
+	return ((c >= '0') && (c <= '9')) || ((c >= 'a') && (c <= 'f')) || ((c >= 'A') && (c <= 'F'));
+}
+
+_jsonTranscode_t* jsonTranscodeInit(_jsonSink_t sink, void *arg)
+{
+	_jsonTranscode_t	*tc = (_jsonTranscode_t*)malloc(sizeof(_jsonTranscode_t));
+
+	if(tc == NULL) {
+		return NULL;
+	}
+	memset(tc, 0, offsetof(_jsonTranscode_t, out));
+	jsonCtxInit(&tc->ctx);
+	tc->sink = sink;
+	tc->arg = arg;
+	tc->line = 1;
+	return tc;
+}
+
+/* очередная порция данных
+ * return:			0 - порция обработана, 1 - ошибка (см. jsonTranscodeError)
+*/
+int jsonTranscodeFeed(_jsonTranscode_t *tc, const char *chunk, _jsonLen_t len)
+{
+	_jsonScan_t		scan;
+	_jsonLen_t		i = 0, j;
+	char			c;
+
+	jsonScanInit(&scan, chunk, len);
+	while((i < len) && (tc->res == 0)) {
+		switch(tc->mode) {
+			case TC_STRING:
+				j = jsonScanNext(&scan, i, JSON_SCAN_QUOTE);
+				putText(tc, chunk + i, j - i);
+				if(j == len) {
+					i = len;
+					break;
+				}
+				c = chunk[j];
+				i = j + 1;
+				if(c == '\\') {
+					tc->mode = TC_STRING_ESC;
+				} else if(c == tc->quote) {
+					put(tc, '"');
+					elementDone(tc);
+				} else if(c == '"') {
+					putN(tc, "\\\"", 2);
+				} else if(c == '\'') {
+					put(tc, '\'');
+				} else {
+					// перевод строки внутри строки
+					putN(tc, "\\n", 2);
+					tc->line++;
+					tc->lineStart = tc->offset + i;
+				}
+				break;
+
+			case TC_STRING_ESC:
+				c = chunk[i++];
+				tc->mode = TC_STRING;
+				switch(c) {
+					case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+						put(tc, '\\');
+						put(tc, c);
+						break;
+					case 'u':
+						put(tc, '\\');
+						put(tc, c);
+						tc->hex = 4;
+						tc->mode = TC_STRING_HEX;
+						break;
+					case '\n':
+						tc->line++;
+						tc->lineStart = tc->offset + i;
+						__attribute__ ((fallthrough));
+					case '\'':
+						// \' и продолжение строки: сам символ
+						putText(tc, &c, 1);
+						break;
+					default:
+						// неизвестная последовательность: '\' сохраняется
+						putN(tc, "\\\\", 2);
+						putText(tc, &c, 1);
+				}
+				break;
+
+			case TC_STRING_HEX:
+				c = chunk[i];
+				if(!isHex(c)) {
+					fail(tc, tc->offset + i, c, JSON_ERR_ILLEGAL_SYMBOL);
+					break;
+				}
+				put(tc, c);
+				i++;
+				if(--tc->hex == 0) {
+					tc->mode = TC_STRING;
+				}
+				break;
+
+			case TC_NONE:
+				j = jsonScanNext(&scan, i, JSON_SCAN_SPACE);
+				putSpace(tc, chunk + i, j - i);
+				if(j == len) {
+					i = len;
+					break;
+				}
+				c = chunk[j];
+				i = j + 1;
+				switch(c) {
+					case '\n':
+						putSpace(tc, &c, 1);
+						tc->line++;
+						tc->lineStart = tc->offset + i;
+						break;
+					case '{': case '[':
+						if(tc->level == JSON_TRANSCODE_NESTING) {
+							fail(tc, tc->offset + j, c, JSON_ERR_NO_MEMORY);
+							break;
+						}
+						if(!elementStart(tc, tc->offset + j, c)) {
+							break;
+						}
+						if(tc->key) {
+							// объект или массив вместо ключа
+							fail(tc, tc->offset + j, c, JSON_ERR_UNEXPECTED_SYMBOL);
+							break;
+						}
+						if(c == '{') {
+							tc->obj[tc->level >> 6] |= 1ULL << (tc->level & 63);
+						} else {
+							tc->obj[tc->level >> 6] &= ~(1ULL << (tc->level & 63));
+						}
+						tc->level++;
+						put(tc, c);
+						break;
+					case '}': case ']':
+						// ключ без значения тоже ошибка
+						if((tc->level == 0) || (inObject(tc) != (c == '}')) || tc->afterKey || tc->afterColon) {
+							fail(tc, tc->offset + j, c, JSON_ERR_UNEXPECTED_SYMBOL);
+							break;
+						}
+						// висячая запятая не выводится
+						flushHold(tc);
+						tc->level--;
+						tc->comma = false;
+						put(tc, c);
+						elementDone(tc);
+						break;
+					case ':':
+						if(!tc->afterKey) {
+							fail(tc, tc->offset + j, c, JSON_ERR_UNEXPECTED_SYMBOL);
+							break;
+						}
+						flushHold(tc);
+						put(tc, ':');
+						tc->afterKey = false;
+						tc->afterColon = true;
+						break;
+					case ',':
+						// только после элемента и одна; сама запятая ставится перед следующим элементом (elementStart)
+						if((tc->level == 0) || !tc->hold || tc->afterKey || tc->comma) {
+							fail(tc, tc->offset + j, c, JSON_ERR_UNEXPECTED_SYMBOL);
+							break;
+						}
+						tc->comma = true;
+						break;
+					case '"': case '\'':
+						if(!elementStart(tc, tc->offset + j, c)) {
+							break;
+						}
+						put(tc, '"');
+						tc->quote = c;
+						tc->mode = TC_STRING;
+						break;
+					case '/':
+						tc->mode = TC_SLASH;
+						break;
+					default:
+						// слово без кавычек: символ обрабатывается в режиме слова
+						i = j;
+						if(!elementStart(tc, tc->offset + j, c)) {
+							break;
+						}
+						if(tc->key) {
+							put(tc, '"');
+							tc->mode = TC_KEY;
+						} else if(((c >= '0') && (c <= '9')) || (c == '-') || (c == '.')) {
+							tc->num = TC_NUM_START;
+							tc->mode = TC_NUMBER;
+						} else {
+							tc->lit = (c == 't') ? "true" : (c == 'f') ? "false" : (c == 'n') ? "null" : NULL;
+							if(tc->lit == NULL) {
+								fail(tc, tc->offset + j, c, JSON_ERR_STRING_WITHOUT_QUOTA);
+								break;
+							}
+							tc->litPos = 0;
+							tc->mode = TC_LITERAL;
+						}
+				}
+				break;
+
+			case TC_KEY:
+				j = jsonScanNext(&scan, i, JSON_SCAN_DELIM);
+				putKey(tc, chunk + i, j - i);
+				i = j;
+				if(j < len) {
+					put(tc, '"');
+					elementDone(tc);
+				}
+				break;
+
+			case TC_LITERAL:
+				j = jsonScanNext(&scan, i, JSON_SCAN_DELIM);
+				if((tc->litPos + (j - i) > strlen(tc->lit)) || (memcmp(tc->lit + tc->litPos, chunk + i, j - i) != 0)) {
+					fail(tc, tc->offset + i, chunk[i], JSON_ERR_STRING_WITHOUT_QUOTA);
+					break;
+				}
+				putN(tc, chunk + i, j - i);
+				tc->litPos += j - i;
+				i = j;
+				if(j < len) {
+					if(tc->lit[tc->litPos] != 0) {
+						fail(tc, tc->offset + j, chunk[j], JSON_ERR_STRING_WITHOUT_QUOTA);
+						break;
+					}
+					elementDone(tc);
+				}
+				break;
+
+			case TC_NUMBER:
+				// число - до разделителя, каждый символ проверяется
+				j = jsonScanNext(&scan, i, JSON_SCAN_DELIM);
+				for(; (i < j) && numberChar(tc, chunk[i]); i++);
+				if(i < j) {
+					fail(tc, tc->offset + i, chunk[i], JSON_ERR_ILLEGAL_SYMBOL);
+					break;
+				}
+				if(j < len) {
+					numberDone(tc, tc->offset + j, chunk[j]);
+				}
+				break;
+
+			case TC_SLASH:
+				c = chunk[i];
+				if(c == '/') {
+					tc->mode = TC_LINE_COMMENT;
+				} else if(c == '*') {
+					tc->mode = TC_BLOCK_COMMENT;
+				} else {
+					fail(tc, tc->offset + i, c, JSON_ERR_ILLEGAL_SYMBOL);
+					break;
+				}
+				i++;
+				break;
+
+			case TC_LINE_COMMENT:
+				// до перевода строки (он сам остаётся отступом)
+				for(j = jsonScanNext(&scan, i, JSON_SCAN_COMMENT); (j < len) && (chunk[j] == '*'); j = jsonScanNext(&scan, j + 1, JSON_SCAN_COMMENT));
+				i = j;
+				if(j < len) {
+					tc->mode = TC_NONE;
+				}
+				break;
+
+			case TC_BLOCK_COMMENT:
+				j = jsonScanNext(&scan, i, JSON_SCAN_COMMENT);
+				if(j == len) {
+					i = len;
+					break;
+				}
+				i = j + 1;
+				if(chunk[j] == '*') {
+					tc->mode = TC_BLOCK_STAR;
+				} else if(chunk[j] == '\n') {
+					tc->line++;
+					tc->lineStart = tc->offset + i;
+				}
+				break;
+
+			case TC_BLOCK_STAR:
+				c = chunk[i];
+				if(c == '/') {
+					tc->mode = TC_NONE;
+					i++;
+				} else if(c == '*') {
+					i++;
+				} else {
+					tc->mode = TC_BLOCK_COMMENT;
+				}
+				break;
+		}
+	}
+	tc->offset += len;
+	return tc->res;
+}
+
+/* конец данных: недописанный элемент, выходной буфер - приёмнику
+ * return:			0 - успех, 1 - ошибка
+*/
+int jsonTranscodeFinish(_jsonTranscode_t *tc)
+{
+	if(tc->res != 0) {
+		return tc->res;
+	}
+	switch(tc->mode) {
+		case TC_NUMBER:
+			numberDone(tc, tc->offset, '.');
+			if(tc->res != 0) {
+				return tc->res;
+			}
+			break;
+		case TC_LITERAL:
+			if(tc->lit[tc->litPos] != 0) {
+				fail(tc, tc->offset, '.', JSON_ERR_STRING_WITHOUT_QUOTA);
+				return tc->res;
+			}
+			elementDone(tc);
+			break;
+		case TC_NONE:
+		case TC_LINE_COMMENT:
+			break;
+		default:
+			fail(tc, tc->offset, '.', JSON_ERR_UNEXPECTED_END);
+			return tc->res;
+	}
+	// незакрытый контейнер или ни одного значения
+	if((tc->level > 0) || !tc->hold) {
+		fail(tc, tc->offset, '.', JSON_ERR_UNEXPECTED_END);
+		return tc->res;
+	}
+	flushHold(tc);
+	flush(tc);
+	return tc->res;
+}
+
+_jsonErr_t* jsonTranscodeError(_jsonTranscode_t *tc)
+{
+	return getLastError_r(&tc->ctx);
+}
+
+void jsonTranscodeFree(_jsonTranscode_t **tc)
+{
+	if((tc == NULL) || (*tc == NULL)) {
+		return;
+	}
+	jsonCtxFree(&(*tc)->ctx);
+	free(*tc);
+	*tc = NULL;
+}
+
+// приёмник jsonToStrict: растущий буфер
+typedef struct
+{
+	char			*buff;
+	size_t			len;
+	size_t			size;
+} _strictBuff_t;
+
+static int strictSink(void *arg, const char *buff, size_t len)
+{
+	_strictBuff_t	*out = (_strictBuff_t*)arg;
+	char			*p;
+
+	if(out->len + len + 1 > out->size) {
+		while(out->len + len + 1 > out->size) {
+			out->size <<= 1;
+		}
+		p = (char*)realloc(out->buff, out->size);
+		if(p == NULL) {
+			return 1;
+		}
+		out->buff = p;
+	}
+	memcpy(out->buff + out->len, buff, len);
+	out->len += len;
+	return 0;
+}
+
+/* строгий json из "грязного" целиком
+ * outLen			OUT длина результата (может быть NULL)
+ * return:			строка (освобождается free) или NULL - ошибка (см. getLastError)
+*/
+char* jsonToStrict(const char *str, _jsonLen_t len, size_t *outLen)
+{
+	_jsonTranscode_t	*tc;
+	_strictBuff_t		out;
+	_jsonCtx_t			*ctx = jsonDefaultCtx();
+	int					res;
+
+	// результат обычно чуть длиннее исходника (кавычки ключей)
+	out.len = 0;
+	out.size = (size_t)len + (len >> 4) + 64;
+	out.buff = (char*)malloc(out.size);
+	tc = jsonTranscodeInit(strictSink, &out);
+	if((out.buff == NULL) || (tc == NULL)) {
+		free(out.buff);
+		free(tc);
+		setError(ctx, 0, 1, '.', JSON_ERR_NO_MEMORY);
+		return NULL;
+	}
+	res = jsonTranscodeFeed(tc, str, len);
+	if(res == 0) {
+		res = jsonTranscodeFinish(tc);
+	}
+	if(res != 0) {
+		// ошибка - в контекст потока по умолчанию
+		ctx->error = tc->ctx.error;
+		if(tc->ctx.error.message == tc->ctx.cErr) {
+			strcpy(ctx->cErr, tc->ctx.cErr);
+			ctx->error.message = ctx->cErr;
+		}
+		jsonTranscodeFree(&tc);
+		free(out.buff);
+		return NULL;
+	}
+	jsonTranscodeFree(&tc);
+	out.buff[out.len] = 0;
+	if(outLen != NULL) {
+		*outLen = out.len;
+	}
+	return out.buff;
+}
@@ -0,0 +1,346 @@
+/* validate-only mode for dirty json parser
+ * Avinfors, O.Nikitin
+ *
+ * Упоротость и отвага!
+*/
+
+/* Проверка json'а без построения токенов и без распределения памяти в куче
+ * Ответ (0 - json корректен, 1 - нет) и ошибка (строка, столбец, JSON_ERR_*) совпадают с jsonParser
+ *
+ * Проверка в два прохода:
+ *  - быстрый: рекурсивный спуск без токенов по "обычному" грязному json'у (комментарии, одинарные кавычки,
+ *    ключи без кавычек, запятая перед закрывающей скобкой). Он консервативен: принимает только то,
+ *    что заведомо принимает парсер, на всём остальном (в т.ч. на любой ошибке) сдаётся
+ *  - точный: если быстрый сдался, json проходится ядром парсера в режиме событий (см. jsonParseSax)
+ *    без обработчиков. Слоты токенов и стек родителей лежат на стеке, поэтому позиция и код ошибки
+ *    те же, что у jsonParser
+ * Корректные документы проверяются только быстрым проходом, отвергнутые - обоими
+ *
+ * Вложенность точного прохода ограничена JSON_VALIDATE_SLOTS: более глубокий json отвергается
+ * с JSON_ERR_NO_MEMORY (как при нехватке памяти у парсера). Быстрый проход держит до JSON_VALIDATE_NESTING
+ * уровней, поэтому до точного прохода глубокий корректный json доходит только с конструкциями, на которых
+ * быстрый сдаётся (или глубже JSON_VALIDATE_NESTING)
+ *
+ *	if(jsonValidate(body, bodyLen) != 0) {
+ *		_jsonErr_t *err = getLastError();
+ *		... err->line, err->col, err->message
+ *	}
+*/
+
+#include "json.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define				JSON_VALIDATE_NESTING	(int)	65536	// глубина быстрого прохода (стек - бит на уровень, 8 Кб)
+#define				JSON_VALIDATE_SLOTS		(int)	512		// слоты токенов точного прохода (вложенность ~250)
+#define				JSON_VALIDATE_TOKENS	(int)	32		// начальное кол-во слотов
+#define				JSON_VALIDATE_SPACE		(int)	1		// класс символа: ' ' \t \r \n
+#define				JSON_VALIDATE_DELIM		(int)	2		// класс символа: конец ключа без кавычек (JSON_SCAN_DELIM и 0)
+
+// символы, после которых парсер заканчивает число или true/false/null
+static inline bool scalarTerm(const char *p, const char *end)
+{
+	if(p >= end) {
+		return false;
+	}
+	switch(*p) {
+		case ',': case ']': case '}': case ' ': case '\t': case '\r': case '\n':
+			return true;
+		case '/':
+			return (p + 1 < end) && ((p[1] == '/') || (p[1] == '*'));
+	}
+	return false;
+}
+
+// классы символов быстрого прохода
+static const unsigned char	validateClass[256] = {
+	[' '] = JSON_VALIDATE_SPACE | JSON_VALIDATE_DELIM, ['\t'] = JSON_VALIDATE_SPACE | JSON_VALIDATE_DELIM,
+	['\r'] = JSON_VALIDATE_SPACE | JSON_VALIDATE_DELIM, ['\n'] = JSON_VALIDATE_SPACE | JSON_VALIDATE_DELIM,
+	['{'] = JSON_VALIDATE_DELIM, ['}'] = JSON_VALIDATE_DELIM, ['['] = JSON_VALIDATE_DELIM, [']'] = JSON_VALIDATE_DELIM,
+	[':'] = JSON_VALIDATE_DELIM, [','] = JSON_VALIDATE_DELIM, ['"'] = JSON_VALIDATE_DELIM, ['\''] = JSON_VALIDATE_DELIM,
+	['/'] = JSON_VALIDATE_DELIM, [0] = JSON_VALIDATE_DELIM
+};
+
+static inline bool keyDelim(char c)
+{
+	return validateClass[(unsigned char)c] & JSON_VALIDATE_DELIM;
+}
+
+// пробелы и комментарии, NULL - комментарий, который парсер понимает иначе
+static const char* skipSpace(const char *str, const char *p, const char *end)
+{
+	while(p < end) {
+		if(validateClass[(unsigned char)*p] & JSON_VALIDATE_SPACE) {
+			p++;
+			continue;
+		}
+		switch(*p) {
+			case '/':
+				// '/' после '\' парсер пропускает, одиночный '/' открывает строку
+				if((p + 1 >= end) || ((p > str) && (p[-1] == '\\'))) {
+					return NULL;
+				}
+				if(p[1] == '/') {
+					// однострочный - до \r или \n, в конце json'а без перевода строки это ошибка
+					for(p += 2; (p < end) && (*p != '\r') && (*p != '\n'); p++);
+					if(p == end) {
+						return NULL;
+					}
+					p++;
+				} else if(p[1] == '*') {
+					for(p += 2; (p + 1 < end) && ((*p != '*') || (p[1] != '/')); p++);
+					if(p + 1 >= end) {
+						return NULL;
+					}
+					p += 2;
+				} else {
+					return NULL;
+				}
+				break;
+			default:
+				return p;
+		}
+	}
+	return p;
+}
+
+/* строка в кавычках (p - на открывающей), возврат - позиция за закрывающей
+ * Закрывающая кавычка - как у парсера: та же кавычка, перед которой нет '\'.
+ * Пустая строка ключа, другая кавычка или '/' первым символом дают у парсера особые токены - NULL
+*/
+static const char* skipString(const char *p, const char *end, bool key)
+{
+	char		q = *p;
+
+	p++;
+	if(p >= end) {
+		return NULL;
+	}
+	if(*p == q) {
+		return key ? NULL : p + 1;
+	}
+	if((*p == '/') || (*p == ((q == '"') ? '\'' : '"'))) {
+		return NULL;
+	}
+	p++;
+	for(;;) {
+#if defined(__SSE2__)
+		const __m128i	vq = _mm_set1_epi8(q);
+		int				m = 0;
+
+		while(end - p >= 16) {
+			m = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), vq));
+			if(m != 0) {
+				p += __builtin_ctz(m);
+				break;
+			}
+			p += 16;
+		}
+		if(m == 0)
+#endif
+		{
+			while((p < end) && (*p != q)) {
+				p++;
+			}
+		}
+		if(p >= end) {
+			return NULL;
+		}
+		if(p[-1] != '\\') {
+			return p + 1;
+		}
+		p++;
+	}
+}
+
+/* число или true/false/null в значении, как их принимает парсер
+ * (у парсера есть и более странные варианты, например 1-2 - на них NULL)
+*/
+static const char* skipScalar(const char *p, const char *end)
+{
+	bool		dot = false;
+
+	if(((*p == 'n') && (end - p >= 4) && (memcmp(p, "null", 4) == 0)) ||
+		((*p == 't') && (end - p >= 4) && (memcmp(p, "true", 4) == 0)))
+	{
+		p += 4;
+	} else if((*p == 'f') && (end - p >= 5) && (memcmp(p, "false", 5) == 0)) {
+		p += 5;
+	} else {
+		if(*p == '-') {
+			p++;
+		}
+		if((p >= end) || (*p < '0') || (*p > '9')) {
+			return NULL;
+		}
+		for(p++; (p < end) && (((*p >= '0') && (*p <= '9')) || (*p == '.')); p++) {
+			if(*p == '.') {
+				if(dot) {
+					return NULL;
+				}
+				dot = true;
+			}
+		}
+	}
+	return scalarTerm(p, end) ? p : NULL;
+}
+
+/* быстрый проход
+ * return:			true - json заведомо корректен для парсера, false - нужен точный проход
+ * Используется и при повторном разборе правленого контейнера (см. jsonReparse)
+*/
+bool jsonQuickCheck(const char *str, _jsonLen_t len)
+{
+	const char			*p = str, *end = str + len;
+	unsigned long long	obj[JSON_VALIDATE_NESTING / 64];	// стек контейнеров: бит - объект
+	int					level = 0;
+	bool				object, first;
+
+	p = skipSpace(str, p, end);
+	if((p == NULL) || (p == end) || ((*p != '{') && (*p != '['))) {
+		return false;
+	}
+	for(;;) {
+		// p - на значении
+		if((*p == '{') || (*p == '[')) {
+			if(level == JSON_VALIDATE_NESTING) {
+				return false;
+			}
+			object = (*p == '{');
+			if(object) {
+				obj[level >> 6] |= 1ULL << (level & 63);
+			} else {
+				obj[level >> 6] &= ~(1ULL << (level & 63));
+			}
+			level++;
+			p++;
+			first = true;
+		} else {
+			p = ((*p == '"') || (*p == '\'')) ? skipString(p, end, false) : skipScalar(p, end);
+			if(p == NULL) {
+				return false;
+			}
+			first = false;
+		}
+
+		// следующий элемент, закрытие контейнеров
+		for(;;) {
+			p = skipSpace(str, p, end);
+			if((p == NULL) || (p == end)) {
+				return false;
+			}
+			object = (obj[(level - 1) >> 6] >> ((level - 1) & 63)) & 1;
+			if(*p == (object ? '}' : ']')) {
+				p++;
+				level--;
+				if(level == 0) {
+					p = skipSpace(str, p, end);
+					return (p == end);
+				}
+				first = false;
+				continue;
+			}
+			if(!first) {
+				// после элемента - запятая (перед закрывающей скобкой допустима)
+				if(*p != ',') {
+					return false;
+				}
+				p = skipSpace(str, p + 1, end);
+				if((p == NULL) || (p == end)) {
+					return false;
+				}
+				if(*p == (object ? '}' : ']')) {
+					continue;
+				}
+			}
+			break;
+		}
+
+		if(object) {
+			// ключ: в кавычках или без
+			if((*p == '"') || (*p == '\'')) {
+				p = skipString(p, end, true);
+			} else {
+				if(keyDelim(*p)) {
+					return false;
+				}
+				while((p < end) && !keyDelim(*p)) {
+					p++;
+				}
+			}
+			if(p != NULL) {
+				p = skipSpace(str, p, end);
+			}
+			if((p == NULL) || (p == end) || (*p != ':')) {
+				return false;
+			}
+			p = skipSpace(str, p + 1, end);
+			if((p == NULL) || (p == end)) {
+				return false;
+			}
+		}
+		// значение не может начинаться с управляющего символа
+		switch(*p) {
+			case '}': case ']': case ':': case ',': case '/':
+				return false;
+		}
+	}
+}
+
+/* точный проход: ядро парсера в режиме событий без обработчиков, память - на стеке
+ * Стек родителей контекста подменяется локальным: уровень вложенности не больше номера слота,
+ * поэтому при нехватке слотов разбор заканчивается (JSON_ERR_NO_MEMORY) раньше, чем стек переполнится
+*/
+static int exactCheck(const char *str, _jsonLen_t len, _jsonCtx_t *ctx)
+{
+	static const _jsonSax_t	none = {0};
+	_jsonToken_t		slots[JSON_VALIDATE_SLOTS];
+	_jsonOff_t			parent[JSON_VALIDATE_SLOTS + 2], *ctxParent = ctx->parent;
+	int					parentCount = ctx->parentCount, res;
+	_jsonArena_t		arena;
+	_jsonObj_t			doc;
+	_jsonParseState_t	st;
+
+	jsonArenaInit(&arena, slots, sizeof(slots));
+	jsonDocInit(&doc, &arena);
+	doc.sax = &none;
+	doc.saxPending = -1;
+	ctx->parent = parent;
+	ctx->parentCount = JSON_VALIDATE_SLOTS + 2;
+	res = jsonParseBegin(&doc, &st, str, JSON_VALIDATE_TOKENS, ctx);
+	if(res == 0) {
+		res = jsonParseRun(&doc, &st, str, len, true, ctx);
+	}
+	ctx->parent = ctxParent;
+	ctx->parentCount = parentCount;
+	jsonDocFree(&doc);
+	return res;
+}
+
+// проверка json'а (контекст потока по умолчанию), см. jsonValidate_r
+int jsonValidate(const char *str, _jsonLen_t len)
+{
+	return jsonValidate_r(str, len, jsonDefaultCtx());
+}
+
+/* проверка json'а без разбора в токены
+ * str, len			json (len == 0 - до завершающего нуля)
+ * ctx				контекст для ошибки (см. jsonParser_r)
+ * return:			0 - json корректен, 1 - invalid json (ошибка - как у jsonParser)
+*/
+int jsonValidate_r(const char *str, _jsonLen_t len, _jsonCtx_t *ctx)
+{
+	if(len == 0) {
+		len = strlen(str);
+	}
+	if(len > (_jsonLen_t)JSON_OFF_MAX) {
+		setError(ctx, 1, 1, '.', JSON_ERR_NO_MEMORY);
+		return 1;
+	}
+	if(jsonQuickCheck(str, len)) {
+		return 0;
+	}
+	return exactCheck(str, len, ctx);
+}
@@ -0,0 +1,227 @@
+/* serializer for dirty json parser
+ * Avinfors, O.Nikitin
+ *
+ * Упоротость и отвага!
+*/
+
+/* Сериализация документа без рекурсии и без дозаписи в растущий буфер
+ * Массив токенов уже лежит в порядке обхода дерева (родитель, затем потомки), поэтому документ
+ * выводится одним линейным проходом по массиву: открытые контейнеры закрываются по ссылкам parent,
+ * стек не нужен. Проход выполняется дважды: первый считает точный размер результата, второй пишет
+ * в буфер, распределённый один раз (или в буфер клиента)
+ *
+ * Режимы (_jsonWriteOpt_t):
+ *  indent == 0		компактный вывод: {"a":1,"b":[1,2]}
+ *  indent > 0		с отступами; при indent == 2 и пробелах результат совпадает с jsonAsString
+ * Ключи и строковые значения выводятся в двойных кавычках (в строках из одинарных кавычек экранируется "),
+ * остальной текст токенов - как в исходном json'е
+*/
+
+#include "json.h"
+
+// контейнер, в котором лежит токен (значение ключа - в объекте ключа)
+static inline _jsonOff_t containerOf(_jsonObj_t *jsonObj, _jsonOff_t id)
+{
+	_jsonOff_t	parent = (jsonObj->token + id)->parent;
+
+	return ((jsonObj->token + parent)->type == JSON_KEY) ? (jsonObj->token + parent)->parent : parent;
+}
+
+/* строка в двойных кавычках
+ * Строка в одинарных кавычках может содержать " - они экранируются, остальной текст (в т.ч. готовые
+ * escape-последовательности) копируется как есть
+*/
+static inline __attribute__ ((always_inline))
+size_t putString(_jsonObj_t *jsonObj, _jsonToken_t *token, char *out, bool write)
+{
+	const char	*p = jsonObj->json + token->start, *end, *run;
+	size_t		pos = 0, n;
+
+	// токен, оставшийся открытым в конце json'а (end < start) - пустая строка
+	end = (token->end > token->start) ? jsonObj->json + token->end : p;
+
+	if(write) {
+		out[pos] = '"';
+	}
+	pos++;
+	if((token->start == 0) || (*(p - 1) != '\'')) {
+		if(write) {
+			memcpy(out + pos, p, end - p);
+		}
+		pos += end - p;
+	} else {
+		while(p < end) {
+			// участок без " и \ копируется целиком
+			for(run = p; (run < end) && (*run != '"') && (*run != '\\'); run++);
+			if(write) {
+				memcpy(out + pos, p, run - p);
+			}
+			pos += run - p;
+			if(run == end) {
+				break;
+			}
+			// готовая escape-последовательность - как есть, " - с экранированием
+			n = ((*run == '\\') && (run + 1 < end)) ? 2 : 1;
+			if(write) {
+				if(*run == '"') {
+					out[pos] = '\\';
+				}
+				memcpy(out + pos + (*run == '"'), run, n);
+			}
+			pos += n + (*run == '"');
+			p = run + n;
+		}
+	}
+	if(write) {
+		out[pos] = '"';
+	}
+	return pos + 1;
+}
+
+/* проход по документу
+ * out == NULL - только подсчёт размера. Ф-ция встраивается в оба места вызова с константным write,
+ * поэтому проверки write в цикле исчезают
+*/
+static inline __attribute__ ((always_inline))
+size_t writeDoc(_jsonObj_t *jsonObj, int indent, char indentChar, char *out, bool write)
+{
+	_jsonToken_t	*token;
+	_jsonOff_t		i, n, cur = 0, parent, len;
+	size_t			pos = 0;
+	int				depth = 0;
+
+#define PUT(c)			do { if(write) { out[pos] = (c); } pos++; } while(0)
+#define PUTN(s, n)		do { if(write) { memcpy(out + pos, (s), (n)); } pos += (n); } while(0)
+#define PAD(n)			do { if(write) { memset(out + pos, indentChar, (n)); } pos += (n); } while(0)
+#define CLOSE(c)		do {																	\
+							depth--;															\
+							if(indent > 0) {													\
+								if(jsonTokenFChild(jsonObj, jsonObj->token + (c)) != 0) {		\
+									PUT('\n');													\
+								}																\
+								PAD(depth * indent);											\
+							}																	\
+							PUT(((jsonObj->token + (c))->type == JSON_OBJECT) ? '}' : ']');		\
+						} while(0)
+
+	// пустой корневой контейнер ({} или []) парсер оставляет с count == 0
+	n = jsonObj->count;
+	if((n == 0) && (jsonObj->token != NULL) && ((jsonObj->token->type == JSON_OBJECT) || (jsonObj->token->type == JSON_ARRAY))) {
+		n = 1;
+	}
+	if(n == 0) {
+		return 0;
+	}
+	for(i=0; i<n; i++) {
+		token = jsonObj->token + i;
+		if(i > 0) {
+			parent = containerOf(jsonObj, i);
+			// закрытие контейнеров, в которых токен уже не лежит
+			while((cur != parent) && (depth > 0)) {
+				CLOSE(cur);
+				cur = containerOf(jsonObj, cur);
+			}
+			// разделитель перед элементом (значение ключа идёт сразу за ключом)
+			if((jsonObj->token + token->parent)->type != JSON_KEY) {
+				if(i != parent + 1) {
+					PUT(',');
+					if(indent > 0) {
+						PUT('\n');
+					}
+				}
+				if(indent > 0) {
+					PAD(depth * indent);
+				}
+			}
+		}
+
+		// токен, оставшийся открытым в конце json'а ([1] /x), имеет end < start - выводится пустым
+		len = (token->end > token->start) ? token->end - token->start : 0;
+		switch(token->type) {
+			case JSON_OBJECT:
+			case JSON_ARRAY:
+				PUT((token->type == JSON_OBJECT) ? '{' : '[');
+				if(indent > 0) {
+					PUT('\n');
+				}
+				cur = i;
+				depth++;
+				break;
+			case JSON_KEY:
+				pos += putString(jsonObj, token, write ? out + pos : NULL, write);
+				PUT(':');
+				if(indent > 0) {
+					PUT(' ');
+				}
+				break;
+			case JSON_VALUE:
+				if(token->valueType == JSON_VALUE_STRING) {
+					pos += putString(jsonObj, token, write ? out + pos : NULL, write);
+				} else {
+					PUTN(jsonObj->json + token->start, len);
+				}
+				break;
+		}
+	}
+	while(depth > 0) {
+		CLOSE(cur);
+		cur = containerOf(jsonObj, cur);
+	}
+	if(indent > 0) {
+		PUT('\n');
+	}
+	return pos;
+
+#undef PUT
+#undef PUTN
+#undef PAD
+#undef CLOSE
+}
+
+/* точный размер результата (без завершающего нуля)
+ * opt				параметры, NULL - компактный вывод
+*/
+size_t jsonWriteSize(_jsonObj_t *jsonObj, const _jsonWriteOpt_t *opt)
+{
+	return writeDoc(jsonObj, (opt != NULL) ? opt->indent : 0, ' ', NULL, false);
+}
+
+/* сериализация в буфер клиента
+ * buff				буфер не менее jsonWriteSize() + 1 байт (результат завершается нулём)
+ * return:			длина результата
+*/
+size_t jsonWriteTo(_jsonObj_t *jsonObj, const _jsonWriteOpt_t *opt, char *buff)
+{
+	size_t	len = writeDoc(jsonObj, (opt != NULL) ? opt->indent : 0, ((opt != NULL) && (opt->indentChar != 0)) ? opt->indentChar : ' ', buff, true);
+
+	buff[len] = 0;
+	return len;
+}
+
+// сериализация в новый буфер (контекст потока по умолчанию), см. jsonWrite_r
+char* jsonWrite(_jsonObj_t *jsonObj, const _jsonWriteOpt_t *opt, size_t *len)
+{
+	return jsonWrite_r(jsonObj, opt, len, jsonDefaultCtx());
+}
+
+/* сериализация в новый буфер (одно распределение памяти)
+ * len				OUT длина результата (может быть NULL)
+ * ctx				контекст для статистики (см. jsonStats_r)
+ * return:			строка (освобождается free) или NULL - не хватило памяти
+*/
+char* jsonWrite_r(_jsonObj_t *jsonObj, const _jsonWriteOpt_t *opt, size_t *len, _jsonCtx_t *ctx)
+{
+	JSON_STATS_START(t);
+	size_t	size = jsonWriteSize(jsonObj, opt);
+	char	*buff = (char*)malloc(size + 1);
+
+	if(buff == NULL) {
+		return NULL;
+	}
+	size = jsonWriteTo(jsonObj, opt, buff);
+	JSON_STATS_PHASE(ctx, JSON_STATS_WRITE, t);
+	if(len != NULL) {
+		*len = size;
+	}
+	return buff;
+}
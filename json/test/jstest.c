@@ -3,9 +3,12 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
+#include <ctype.h>
+#include <stdarg.h>
 #include <linux/limits.h>
 
 #include "../lib/json/json.h"
+#include "../lib/json/jsonScan.h"
 
 // ID ошибки, номер теста (начинается с 1), признак ошибки в тесте, строка, столбец
 int test[100][5] = {
@@ -45,6 +48,29 @@ int testCount = 29;
 
 int readFile(const char *fName, char **json);
 void runAllTests();
+void runValidateTests();
+void runEditTests();
+void runReparseTests();
+void runSnapshotTests();
+void runCacheTests();
+void runStatsTests();
+void runBindTests();
+void runWriteTests();
+void runTranscodeTests();
+void runNumberTests();
+void runStreamTests();
+void runEscapeTests();
+void runPathTests();
+void runCursorTests();
+void runScanTests();
+void runArenaTests();
+void runViewTests();
+void runIndexTests();
+void runBatchTests();
+void runFileTests();
+void runCompactTests();
+void runSaxTests();
+void runExtractTests();
 
 int main(int argc, char **argv) {
 	(void)(argc);
@@ -54,6 +80,29 @@ int main(int argc, char **argv) {
 	int				res;
 
 runAllTests();
+runValidateTests();
+runEditTests();
+runReparseTests();
+runSnapshotTests();
+runCacheTests();
+runStatsTests();
+runBindTests();
+runWriteTests();
+runTranscodeTests();
+runNumberTests();
+runStreamTests();
+runEscapeTests();
+runPathTests();
+runCursorTests();
+runScanTests();
+runArenaTests();
+runViewTests();
+runIndexTests();
+runBatchTests();
+runFileTests();
+runCompactTests();
+runSaxTests();
+runExtractTests();
 
 	//if(readFile("./test/0/test_02.js", &js) > 0) {
 	//if(readFile("./reg-contract-creditor-1.json", &js) > 0) {
@@ -146,6 +195,1530 @@ void runAllTests()
 	}
 }
 
+// jsonValidate: тот же ответ и та же ошибка (код, строка, столбец), что у jsonParser, на всех тестах 0..6
+void runValidateTests()
+{
+	char			fName[PATH_MAX];
+	_jsonObj_t		*jsonObj;
+	_jsonErr_t		err;
+	_jsonCtx_t		ctx;
+	char			*js;
+	int				res, vRes, n, i, len, depth;
+
+	for (int errId=0; errId<=6; errId++) {
+		for (int n=1; n<100; n++) {
+			sprintf(fName, "./test/%d/test_%d%d.js", errId, errId, n);
+			if(access(fName, R_OK) != 0) {
+				continue;
+			}
+			if(readFile(fName, &js) == 0) {
+				continue;
+			}
+			res = jsonParser(js, &jsonObj, 0);
+			err = *getLastError();
+			clearFlatJsonObj(&jsonObj);
+			vRes = jsonValidate(js, 0);
+
+			if((res == vRes) && ((res == 0) ||
+				((err.code == getLastError()->code) && (err.line == getLastError()->line) && (err.col == getLastError()->col))))
+			{
+				printf("VALIDATE ERR ID: %d  Test: %d    Ok\n", errId, n);
+			} else {
+				printf("VALIDATE ERR ID: %d  Test: %d    FAIL!\n", errId, n);
+				printf("Parser: %d Line: %d, Col: %d  Validate: %d Line: %d, Col: %d\n", res, err.line, err.col, vRes, getLastError()->line, getLastError()->col);
+			}
+			free(js);
+		}
+	}
+
+	// глубже стека точного прохода: корректный json принимается, как у jsonParser
+	js = (char*)malloc(10 * 70000 + 1);
+	for(n=0, vRes=0; n<3; n++) {
+		depth = (n == 0) ? 257 : ((n == 1) ? 1000 : 60000);
+		len = 0;
+		for(i=0; i<depth; i++) {
+			len += sprintf(js + len, (i % 3 == 2) ? "[" : ((i % 2) ? "{a: " : "{\"a\":"));
+		}
+		len += sprintf(js + len, "1");
+		for(i=depth-1; i>=0; i--) {
+			js[len++] = (i % 3 == 2) ? ']' : '}';
+		}
+		js[len] = 0;
+		// свой контекст: стек родителей контекста потока не разрастается (см. runStatsTests)
+		jsonCtxInit(&ctx);
+		res = jsonParser_r(js, &jsonObj, 0, &ctx);
+		clearFlatJsonObj(&jsonObj);
+		if((res != 0) || (jsonValidate_r(js, 0, &ctx) != 0)) {
+			vRes = 1;
+		}
+		jsonCtxFree(&ctx);
+	}
+	free(js);
+	printf("VALIDATE DEEP %s\n", (vRes == 0) ? "Ok" : "FAIL!");
+}
+
+// правки: без правок вывод совпадает с исходным json'ом, с правками - разбирается и содержит их
+void runEditTests()
+{
+	_jsonObj_t		*jsonObj = NULL, *editObj = NULL;
+	_jsonBatchDoc_t	*docs;
+	char			*js, *out;
+	size_t			len;
+	bool			ok;
+
+	if(readFile("./test/contract-hypothec-1.json", &js) == 0) {
+		return;
+	}
+	if(jsonParser(js, &jsonObj, 0) != 0) {
+		printf("EDIT    FAIL!\n");
+		free(js);
+		return;
+	}
+	out = jsonEditWrite(jsonObj, &len);
+	ok = (out != NULL) && (len == strlen(js)) && (memcmp(out, js, len) == 0);
+	free(out);
+
+	ok = ok && jsonEditSetInt(jsonObj, xPath("version", jsonObj), 2) &&
+		jsonEditSetString(jsonObj, xPath("type", jsonObj), "contract \"test\"", 0) &&
+		jsonEditInsert(jsonObj, xPathNode("journals", jsonObj), "extra", 0, "[1, 2]", 0) &&
+		jsonEditRemove(jsonObj, xPathNode("derivation", jsonObj));
+	out = ok ? jsonEditWrite(jsonObj, &len) : NULL;
+	ok = (out != NULL) && (jsonParser(out, &editObj, 0) == 0) &&
+		(getJsonInt("version", editObj) == 2) && (xPathNode("derivation", editObj) == NULL) &&
+		(xPathNode("journals.extra", editObj) != NULL) && (xPathNode("journals.main", editObj) != NULL);
+	if(editObj != NULL) {
+		clearFlatJsonObj(&editObj);
+	}
+	clearFlatJsonObj(&jsonObj);
+	free(out);
+	free(js);
+
+	// документ пакета без нуля в конце: вывод правок и повторный разбор - только в пределах документа
+	js = strdup("{\"a\":1}\n{\"b\":2}\n");
+	ok = ok && (jsonParseBatch(js, 0, 1, &docs) == 2) && (docs[0].res == 0) &&
+		jsonEditSetInt(docs[0].obj, xPath("a", docs[0].obj), 5);
+	out = ok ? jsonEditWrite(docs[0].obj, &len) : NULL;
+	ok = ok && (out != NULL) && (strcmp(out, "{\"a\":5}") == 0) && (docs[1].obj->len == 7) &&
+		(jsonReparse(docs[1].obj, 5, 1, "33", 2) == 0) && (strcmp(docs[1].obj->json, "{\"b\":33}") == 0);
+	free(out);
+	jsonBatchFree(&docs, 2);
+	free(js);
+
+	// буфер ровно по длине json'а
+	js = (char*)malloc(7);
+	memcpy(js, "{a: 10}", 7);
+	ok = ok && (jsonParser(js, &jsonObj, 7) == 0) && jsonEditSetInt(jsonObj, xPath("a", jsonObj), 7);
+	out = ok ? jsonEditWrite(jsonObj, &len) : NULL;
+	ok = ok && (out != NULL) && (strcmp(out, "{a: 7}") == 0) && (len == 6);
+	free(out);
+	if(jsonObj != NULL) {
+		clearFlatJsonObj(&jsonObj);
+	}
+	free(js);
+	printf("EDIT    %s\n", ok ? "Ok" : "FAIL!");
+}
+
+// повторный разбор после правки текста: токены совпадают с полным разбором нового текста
+void runReparseTests()
+{
+	const char		*edits[][2] = {{"HYPOTHEC_POLICY_BLANK", "HYPOTHEC_BLANK"}, {"version: 1", "version: 12"}, {"main: 'hypothecList'", "main: 'x', extra: [1, {a: 2}]"}};
+	_jsonObj_t		*jsonObj = NULL, *fullObj = NULL;
+	char			*js;
+	const char		*p;
+	int				i, n;
+	bool			ok;
+
+	if(readFile("./test/contract-hypothec-1.json", &js) == 0) {
+		return;
+	}
+	ok = (jsonParser(js, &jsonObj, 0) == 0);
+	for(n=0; ok && (n < (int)(sizeof(edits) / sizeof(edits[0]))); n++) {
+		p = strstr(jsonObj->json, edits[n][0]);
+		ok = (p != NULL) && (jsonReparse(jsonObj, p - jsonObj->json, strlen(edits[n][0]), edits[n][1], strlen(edits[n][1])) == 0) &&
+			(jsonParser((char*)jsonObj->json, &fullObj, 0) == 0) && (fullObj->count == jsonObj->count);
+		for(i=0; ok && (i < jsonObj->count); i++) {
+			ok = ((jsonObj->token + i)->start == (fullObj->token + i)->start) && ((jsonObj->token + i)->end == (fullObj->token + i)->end) &&
+				((jsonObj->token + i)->parent == (fullObj->token + i)->parent) && ((jsonObj->token + i)->nextToken == (fullObj->token + i)->nextToken);
+		}
+		if(fullObj != NULL) {
+			clearFlatJsonObj(&fullObj);
+		}
+	}
+	ok = ok && (getJsonInt("version", jsonObj) == 12) && (xPathNode("journals.extra", jsonObj) != NULL);
+	printf("REPARSE %s\n", ok ? "Ok" : "FAIL!");
+	clearFlatJsonObj(&jsonObj);
+	free(js);
+}
+
+// снимок: загруженный документ совпадает с разобранным, испорченный снимок не загружается
+void runSnapshotTests()
+{
+	const char		*fName = "./jstest.snap";
+	_jsonObj_t		*jsonObj = NULL, *snapObj = NULL;
+	_jsonBatchDoc_t	*docs;
+	char			*s1, *s2, *js;
+	int				fh;
+	bool			ok;
+
+	ok = (jsonParseFile("./test/contract-hypothec-1.json", &jsonObj) == 0) && (jsonSnapshotSave(jsonObj, fName) == 0) &&
+		(jsonSnapshotLoad(fName, &snapObj) == 0) && (snapObj->count == jsonObj->count) && (strcmp(snapObj->json, jsonObj->json) == 0) &&
+		(memcmp(snapObj->token, jsonObj->token, sizeof(_jsonToken_t) * jsonObj->count) == 0);
+	if(ok) {
+		s1 = getJsonStr("reports.defaultType", jsonObj);
+		s2 = getJsonStr("reports.defaultType", snapObj);
+		ok = (s1 != NULL) && (s2 != NULL) && (strcmp(s1, s2) == 0);
+		free(s1);
+		free(s2);
+	}
+	if(snapObj != NULL) {
+		clearFlatJsonObj(&snapObj);
+	}
+	// порча json'а в снимке
+	fh = open(fName, O_WRONLY);
+	if((fh >= 0) && (lseek(fh, -16, SEEK_END) > 0)) {
+		ok = ok && (write(fh, "#", 1) == 1);
+	}
+	if(fh >= 0) {
+		close(fh);
+	}
+	ok = ok && (jsonSnapshotLoad(fName, &snapObj) == 1) && (getLastError()->code == JSON_ERR_SNAPSHOT) && (snapObj == NULL);
+
+	// документ пакета: в снимок - только он, без следующих документов
+	js = strdup("{\"a\":1}\n{\"b\":2}\n");
+	ok = ok && (jsonParseBatch(js, 0, 1, &docs) == 2) && (jsonSnapshotSave(docs[0].obj, fName) == 0) &&
+		(jsonSnapshotLoad(fName, &snapObj) == 0) && (snapObj->len == 7) && (strcmp(snapObj->json, "{\"a\":1}") == 0) &&
+		(snapObj->count == docs[0].obj->count) && (getJsonInt("a", snapObj) == 1);
+	jsonBatchFree(&docs, 2);
+	free(js);
+	if(snapObj != NULL) {
+		clearFlatJsonObj(&snapObj);
+	}
+	printf("SNAPSHOT %s\n", ok ? "Ok" : "FAIL!");
+	unlink(fName);
+	if(jsonObj != NULL) {
+		clearFlatJsonObj(&jsonObj);
+	}
+}
+
+// кэш: повторный json не разбирается, ошибочный не кэшируется, лишнее вытесняется
+void runCacheTests()
+{
+	_jsonCache_t		*cache = jsonCacheInit(0, JSON_CACHE_CLOCK | JSON_CACHE_INDEX);
+	_jsonCacheStats_t	stats;
+	_jsonObj_t			*doc1, *doc2;
+	char				*js;
+	size_t				size;
+	bool				ok;
+
+	if(readFile("./test/contract-hypothec-1.json", &js) == 0) {
+		jsonCacheFree(&cache);
+		return;
+	}
+	doc1 = jsonCacheGet(cache, js, 0);
+	doc2 = jsonCacheGet(cache, js, 0);
+	ok = (doc1 != NULL) && (doc1 == doc2) && (getJsonInt("version", doc1) == 1) && (jsonCacheGet(cache, "{bad", 0) == NULL);
+	jsonCacheRelease(cache, doc1);
+	jsonCacheRelease(cache, doc2);
+	jsonCacheStats(cache, &stats);
+	ok = ok && (stats.hits == 1) && (stats.misses == 2) && (stats.entries == 1);
+	jsonCacheFree(&cache);
+
+	// объём - на один большой документ: второй вытесняет первый (давно не запрошенный)
+	// цена записи зависит от сборки (размер токена), поэтому сперва измеряется
+	cache = jsonCacheInit(0, JSON_CACHE_LRU);
+	jsonCacheRelease(cache, jsonCacheGet(cache, js, 0));
+	jsonCacheStats(cache, &stats);
+	size = stats.bytes + stats.bytes / 2;
+	jsonCacheFree(&cache);
+
+	cache = jsonCacheInit(size, JSON_CACHE_LRU);
+	jsonCacheRelease(cache, jsonCacheGet(cache, js, 0));
+	jsonCacheRelease(cache, jsonCacheGet(cache, "{a: 1}", 0));
+	jsonCacheStats(cache, &stats);
+	ok = ok && (stats.evictions == 0) && (stats.entries == 2);
+	js[strlen(js) - 2] = ' ';
+	jsonCacheRelease(cache, jsonCacheGet(cache, js, 0));
+	jsonCacheStats(cache, &stats);
+	ok = ok && (stats.evictions == 1) && (stats.entries == 2) && (stats.bytes <= size);
+	jsonCacheFree(&cache);
+
+	// кэш без индекса: ленивый поиск по общему документу индекс не строит
+	cache = jsonCacheInit(0, JSON_CACHE_LRU);
+	doc1 = jsonCacheGet(cache, "{a: 1, b: [10, 20]}", 0);
+	ok = ok && (doc1 != NULL) && doc1->shared && (jsonIndexKey(doc1, doc1->token, "b", 1) != NULL) &&
+		(jsonIndexAt(doc1, xPathNode("b", doc1), 1) != NULL) && (doc1->index == NULL);
+	jsonCacheRelease(cache, doc1);
+	printf("CACHE   %s\n", ok ? "Ok" : "FAIL!");
+	jsonCacheFree(&cache);
+	free(js);
+}
+
+// статистика: без JSON_STATS её нет, со статистикой - счётчики разбора, поиска и сериализации
+void runStatsTests()
+{
+	const _jsonStats_t	*st = jsonStats(), *ctxSt;
+	_jsonObj_t			*jsonObj;
+	_jsonCtx_t			ctx;
+	char				js[] = "{a: {b: [1, 2, {c: 3}]}, // comment\n d: 'x' /* c */}";
+	char				*s;
+	bool				ok = true;
+	int					i;
+	unsigned long long	n = 0;
+
+	if(st == NULL) {
+		printf("STATS   Ok (disabled)\n");
+		return;
+	}
+	jsonStatsReset();
+	if(jsonParser(js, &jsonObj, 0) != 0) {
+		printf("STATS   FAIL!\n");
+		return;
+	}
+	s = getJsonStr("d", jsonObj);
+	free(s);
+	s = jsonWrite(jsonObj, NULL, NULL);
+	free(s);
+	clearFlatJsonObj(&jsonObj);
+	for(i=0; i<JSON_STATS_BUCKETS; i++) {
+		n += st->lookupHist[i];
+	}
+	ok = (st->parses == 1) && (st->bytes == strlen(js)) && (st->tokens == 12) && (st->tokensExpected == 64) &&
+		(st->reallocs == 0) && (st->maxNesting == 4) && (st->commentBytes == strlen("// comment") + strlen("/* c */")) &&
+		(st->calls[JSON_STATS_PARSE] == 1) && (st->calls[JSON_STATS_LOOKUP] == 1) && (n == 1) && (st->calls[JSON_STATS_WRITE] == 1);
+
+	// маленькая оценка: массив токенов расширяется
+	jsonStatsReset();
+	ok = ok && (jsonParser("[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[1]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]", &jsonObj, 0) == 0);
+	if(ok) {
+		clearFlatJsonObj(&jsonObj);
+	}
+	ok = ok && (st->tokens == 70) && (st->reallocs == 1) && (st->maxNesting == 69) && (st->parentReallocs > 0);
+	jsonObj = NULL;
+	ok = ok && (jsonParser("{a: }", &jsonObj, 0) != 0) && (st->errors == 1) && (st->parses == 1);
+	if(jsonObj != NULL) {
+		clearFlatJsonObj(&jsonObj);
+	}
+
+	// незакрытый комментарий и разбор без jsonDocParse байты комментариев не меняют
+	jsonStatsReset();
+	jsonObj = NULL;
+	ok = ok && (jsonParser("{\"a\":1 /* x", &jsonObj, 0) != 0);
+	if(jsonObj != NULL) {
+		clearFlatJsonObj(&jsonObj);
+	}
+	ok = ok && (jsonValidate("{a: 1 /* x */}", 0) == 0) && (st->commentBytes == 0);
+
+	// поиск, индекс и сериализация с контекстом - в его счётчики, контекст потока не трогают
+	jsonStatsReset();
+	jsonCtxInit(&ctx);
+	ctxSt = jsonStats_r(&ctx);
+	ok = ok && (jsonParser_r(js, &jsonObj, 0, &ctx) == 0) && (xPathNode_r("a.b", jsonObj, &ctx) != NULL) &&
+		jsonBuildIndex_r(jsonObj, &ctx);
+	s = ok ? jsonWrite_r(jsonObj, NULL, NULL, &ctx) : NULL;
+	ok = ok && (s != NULL) && (ctxSt->parses == 1) && (ctxSt->calls[JSON_STATS_LOOKUP] == 1) && (ctxSt->calls[JSON_STATS_INDEX] == 1) &&
+		(ctxSt->calls[JSON_STATS_WRITE] == 1) && (st->parses == 0) && (st->calls[JSON_STATS_LOOKUP] == 0) &&
+		(st->calls[JSON_STATS_INDEX] == 0) && (st->calls[JSON_STATS_WRITE] == 0);
+	free(s);
+	if(jsonObj != NULL) {
+		clearFlatJsonObj(&jsonObj);
+	}
+	jsonCtxFree(&ctx);
+	printf("STATS   %s\n", ok ? "Ok" : "FAIL!");
+}
+
+// привязка к структурам: reports.list - массив структур, проверка типов и обязательных полей
+typedef struct {
+	char		code[64];
+	char		name[128];
+	_jsonView_t	desc;
+	char		type[16];
+} report_t;
+
+typedef struct {
+	char		defaultType[16];
+	report_t	list[8];
+	int			listCount;
+} reports_t;
+
+typedef struct {
+	int			version;
+	char		type[32];
+	bool		passport;
+	double		limit;
+	reports_t	reports;
+} document_t;
+
+static const _jsonBind_t reportBind[] = {
+	JSON_BIND(report_t, code, "code", JSON_BIND_STRING, JSON_BIND_REQUIRED),
+	JSON_BIND(report_t, name, "name", JSON_BIND_STRING, 0),
+	JSON_BIND(report_t, desc, "desc", JSON_BIND_VIEW, 0),
+	JSON_BIND(report_t, type, "type", JSON_BIND_STRING, 0),
+	JSON_BIND_END
+};
+
+static const _jsonBind_t reportsBind[] = {
+	JSON_BIND(reports_t, defaultType, "defaultType", JSON_BIND_STRING, 0),
+	JSON_BIND_LIST(reports_t, list, listCount, "list", reportBind, 0),
+	JSON_BIND_END
+};
+
+static const _jsonBind_t documentBind[] = {
+	JSON_BIND(document_t, type, "type", JSON_BIND_STRING, JSON_BIND_REQUIRED),
+	JSON_BIND(document_t, version, "version", JSON_BIND_INT, JSON_BIND_REQUIRED),
+	JSON_BIND_STRUCT(document_t, reports, "reports", reportsBind, 0),
+	JSON_BIND_END
+};
+
+void runBindTests()
+{
+	static const _jsonBind_t badType[] = {
+		JSON_BIND(document_t, type, "version", JSON_BIND_STRING, 0),
+		JSON_BIND_END
+	};
+	static const _jsonBind_t missing[] = {
+		JSON_BIND(document_t, limit, "limit", JSON_BIND_DOUBLE, JSON_BIND_REQUIRED),
+		JSON_BIND_END
+	};
+	static const _jsonBind_t scalars[] = {
+		JSON_BIND(document_t, version, "v", JSON_BIND_INT, 0),
+		JSON_BIND(document_t, passport, "p", JSON_BIND_BOOL, 0),
+		JSON_BIND(document_t, limit, "l", JSON_BIND_DOUBLE, 0),
+		JSON_BIND(document_t, type, "t", JSON_BIND_STRING, 0),
+		JSON_BIND_END
+	};
+	_jsonObj_t		*jsonObj;
+	document_t		doc;
+	char			js[] = "{t: 'a\\'b', l: 2.5, p: true, v: -7, x: [1]}", big[] = "{v: 9999999999}";
+	bool			ok;
+
+	if(jsonParseFile("./test/contract-hypothec-1.json", &jsonObj) != 0) {
+		printf("BIND    FAIL!\n");
+		return;
+	}
+	memset(&doc, 0, sizeof(doc));
+	ok = (jsonBind(jsonObj, NULL, documentBind, &doc) == 0) && (strcmp(doc.type, "documentTemplate") == 0) &&
+		(doc.version == 1) && (strcmp(doc.reports.defaultType, "pdf") == 0) && (doc.reports.listCount == 5) &&
+		(strcmp(doc.reports.list[0].code, "HYPOTHEC_POLICY") == 0) && (strcmp(doc.reports.list[3].type, "file") == 0) &&
+		(doc.reports.list[0].type[0] == 0) && (doc.reports.list[4].desc.len == (_jsonOff_t)strlen("Вывод на печать формы cчета на оплату"));
+	ok = ok && (jsonBind(jsonObj, "reports", reportsBind, &doc.reports) == 0) && (doc.reports.listCount == 5);
+	ok = ok && (jsonBind(jsonObj, NULL, badType, &doc) == 1) && (getLastError()->code == JSON_ERR_BIND_TYPE) && (getLastError()->line == 6);
+	ok = ok && (jsonBind(jsonObj, NULL, missing, &doc) == 1) && (getLastError()->code == JSON_ERR_BIND_MISSING);
+	ok = ok && (jsonBind(jsonObj, "journals.main", reportsBind, &doc) == 1) && (getLastError()->code == JSON_ERR_BIND_TYPE);
+	clearFlatJsonObj(&jsonObj);
+
+	// скаляры; число, не помещающееся в int
+	ok = ok && (jsonParser(js, &jsonObj, 0) == 0) && (jsonBind(jsonObj, "", scalars, &doc) == 0) && (doc.version == -7) &&
+		doc.passport && (doc.limit == 2.5) && (strcmp(doc.type, "a'b") == 0);
+	if(jsonObj != NULL) {
+		clearFlatJsonObj(&jsonObj);
+	}
+	ok = ok && (jsonParser(big, &jsonObj, 0) == 0) && (jsonBind(jsonObj, "", scalars, &doc) == 1) &&
+		(getLastError()->code == JSON_ERR_BIND_OVERFLOW);
+	if(jsonObj != NULL) {
+		clearFlatJsonObj(&jsonObj);
+	}
+	printf("BIND    %s\n", ok ? "Ok" : "FAIL!");
+}
+
+// сериализация: токен, оставшийся открытым в конце json'а (end < start), выводится пустым
+void runWriteTests()
+{
+	// json, отступ, символ отступа, результат
+	const struct {
+		const char	*json;
+		int			indent;
+		char		indentChar;
+		const char	*out;
+	} cases[] = {
+		{"[1] /x", 0, 0, "[1,\"\"]"},
+		{"[\"a\"] /}", 0, 0, "[\"a\",\"\"]"},
+		{"{a: 1, 'b': [true, null, -2.5], c: {d: 'x'}, // c\n e: \"y\", /* z */ f: -0}", 0, 0,
+			"{\"a\":1,\"b\":[true,null,-2.5],\"c\":{\"d\":\"x\"},\"e\":\"y\",\"f\":-0}"},
+		{"{s: 'say \"hi\"', t: 'a\\\\nb', u: \"q\\\"\"}", 0, 0, "{\"s\":\"say \\\"hi\\\"\",\"t\":\"a\\\\nb\",\"u\":\"q\\\"\"}"},
+		{"{a: [], b: {}, c: [[]]}", 0, 0, "{\"a\":[],\"b\":{},\"c\":[[]]}"},
+		{"[]", 0, 0, "[]"},
+		{"{}", 0, 0, "{}"},
+		{"{a: [1, {}], b: 'x'}", 1, '\t', "{\n\t\"a\": [\n\t\t1,\n\t\t{\n\t\t}\n\t],\n\t\"b\": \"x\"\n}\n"},
+		{"{a: [1, {}], b: 'x'}", 4, 0, "{\n    \"a\": [\n        1,\n        {\n        }\n    ],\n    \"b\": \"x\"\n}\n"}
+	};
+	_jsonObj_t		*jsonObj = NULL, *backObj = NULL;
+	_jsonWriteOpt_t	opt;
+	char			*out, *s, *js = NULL;
+	size_t			len;
+	int				n;
+	bool			ok = true;
+
+	for(n=0; ok && (n < (int)(sizeof(cases) / sizeof(cases[0]))); n++) {
+		opt = (_jsonWriteOpt_t){cases[n].indent, cases[n].indentChar};
+		ok = (jsonParser((char*)cases[n].json, &jsonObj, 0) == 0);
+		out = ok ? jsonWrite(jsonObj, (cases[n].indent > 0) ? &opt : NULL, &len) : NULL;
+		ok = (out != NULL) && (len == strlen(cases[n].out)) && (strcmp(out, cases[n].out) == 0) &&
+			((s = jsonAsString(jsonObj)) != NULL) && (strlen(s) == jsonWriteSize(jsonObj, &(_jsonWriteOpt_t){2, ' '}));
+		free(out);
+		if(jsonObj != NULL) {
+			clearFlatJsonObj(&jsonObj);
+		}
+	}
+
+	// компактный вывод разбирается обратно в то же дерево
+	ok = ok && (readFile("./test/contract-hypothec-1.json", &js) > 0) && (jsonParser(js, &jsonObj, 0) == 0);
+	out = ok ? jsonWrite(jsonObj, NULL, &len) : NULL;
+	ok = ok && (out != NULL) && (len == jsonWriteSize(jsonObj, NULL)) && (jsonParser(out, &backObj, 0) == 0) &&
+		(backObj->count == jsonObj->count);
+	s = ok ? getJsonStr("reports.defaultType", backObj) : NULL;
+	ok = ok && (s != NULL) && (strcmp(s, "pdf") == 0);
+	free(s);
+	if(backObj != NULL) {
+		clearFlatJsonObj(&backObj);
+	}
+	if(jsonObj != NULL) {
+		clearFlatJsonObj(&jsonObj);
+	}
+	free(out);
+	free(js);
+	printf("WRITE   %s\n", ok ? "Ok" : "FAIL!");
+}
+
+// строгий json (RFC 8259): проверка результата jsonToStrict
+static const char* strictWs(const char *p)
+{
+	while((*p == ' ') || (*p == '\t') || (*p == '\r') || (*p == '\n')) {
+		p++;
+	}
+	return p;
+}
+
+static const char* strictValue(const char *p, int depth)
+{
+	const char	*s;
+
+	p = strictWs(p);
+	if(depth > 512) {
+		return NULL;
+	}
+	if(*p == '"') {
+		for(p++; *p != '"'; p++) {
+			if((unsigned char)*p < 0x20) {
+				return NULL;
+			}
+			if(*p == '\\') {
+				p++;
+				if(*p == 'u') {
+					for(s = p + 1; s < p + 5; s++) {
+						if(!isxdigit((unsigned char)*s)) {
+							return NULL;
+						}
+					}
+					p += 4;
+				} else if(strchr("\"\\/bfnrt", *p) == NULL || (*p == 0)) {
+					return NULL;
+				}
+			}
+		}
+		return p + 1;
+	}
+	if((*p == '{') || (*p == '[')) {
+		char	close = (*p == '{') ? '}' : ']';
+
+		p = strictWs(p + 1);
+		if(*p == close) {
+			return p + 1;
+		}
+		for(;;) {
+			if(close == '}') {
+				p = strictWs(p);
+				if((*p != '"') || ((p = strictValue(p, depth + 1)) == NULL)) {
+					return NULL;
+				}
+				p = strictWs(p);
+				if(*p++ != ':') {
+					return NULL;
+				}
+			}
+			if((p = strictValue(p, depth + 1)) == NULL) {
+				return NULL;
+			}
+			p = strictWs(p);
+			if(*p == close) {
+				return p + 1;
+			}
+			if(*p++ != ',') {
+				return NULL;
+			}
+		}
+	}
+	if((strncmp(p, "true", 4) == 0) || (strncmp(p, "null", 4) == 0)) {
+		return p + 4;
+	}
+	if(strncmp(p, "false", 5) == 0) {
+		return p + 5;
+	}
+	// -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+	s = p;
+	if(*p == '-') {
+		p++;
+	}
+	if(*p == '0') {
+		p++;
+	} else if((*p >= '1') && (*p <= '9')) {
+		while(isdigit((unsigned char)*p)) p++;
+	} else {
+		return NULL;
+	}
+	if(*p == '.') {
+		if(!isdigit((unsigned char)*++p)) {
+			return NULL;
+		}
+		while(isdigit((unsigned char)*p)) p++;
+	}
+	if((*p == 'e') || (*p == 'E')) {
+		p++;
+		if((*p == '+') || (*p == '-')) {
+			p++;
+		}
+		if(!isdigit((unsigned char)*p)) {
+			return NULL;
+		}
+		while(isdigit((unsigned char)*p)) p++;
+	}
+	return (p > s) ? p : NULL;
+}
+
+static bool isStrict(const char *js)
+{
+	const char	*p = strictValue(js, 0);
+
+	return (p != NULL) && (*strictWs(p) == 0);
+}
+
+typedef struct {
+	char		buff[1 << 18];
+	size_t		len;
+} tcOut_t;
+
+static int tcSink(void *arg, const char *buff, size_t len)
+{
+	tcOut_t		*out = (tcOut_t*)arg;
+
+	if(out->len + len >= sizeof(out->buff)) {
+		return 1;
+	}
+	memcpy(out->buff + out->len, buff, len);
+	out->len += len;
+	out->buff[out->len] = 0;
+	return 0;
+}
+
+/* строгий json из "грязного": результат проходит строгую проверку, порции по байту дают тот же результат,
+ * нарушения структуры и грамматики чисел - ошибка
+*/
+void runTranscodeTests()
+{
+	const char			*good[][2] = {{"{a:\"x\\y\"}", "{\"a\":\"x\\\\y\"}"}, {"[007, 1., -0.5, 1e5, 2.e-3]", "[7, 1.0, -0.5, 1e5, 2.0e-3]"},
+		{"{a:1 b:'it\\'s' c:[1,],}", "{\"a\":1, \"b\":\"it's\", \"c\":[1]}"}, {"{a\\b: \"\\u00e9\"}", "{\"a\\\\b\": \"\\u00e9\"}"}};
+	const char			*bad[][2] = {{"{\"a\": \"b\": \"c\": 1}", "\006"}, {"{\"a\", [1]}", "\006"}, {"{a}", "\006"}, {"{a:}", "\006"},
+		{"{:1}", "\006"}, {"[1,,2]", "\006"}, {"[,1]", "\006"}, {"[1] [2]", "\006"}, {"{[1]:2}", "\006"}, {"{a b:1}", "\006"},
+		{"[1-2]", "\005"}, {"[.5]", "\005"}, {"[-]", "\005"}, {"[1e]", "\005"}, {"[1.2.3]", "\005"}, {"[1true]", "\005"},
+		{"[\"\\u00g9\"]", "\005"}, {"", "\003"}, {"[1", "\003"}};
+	static tcOut_t		out;
+	_jsonTranscode_t	*tc;
+	char				fName[PATH_MAX], *js, *s;
+	size_t				len, k;
+	unsigned int		seed = 1;
+	int					n, errId;
+	bool				ok = true;
+
+	for(n=0; ok && (n < (int)(sizeof(good) / sizeof(good[0]))); n++) {
+		s = jsonToStrict(good[n][0], strlen(good[n][0]), &len);
+		ok = (s != NULL) && (strcmp(s, good[n][1]) == 0) && isStrict(s);
+		free(s);
+	}
+	for(n=0; ok && (n < (int)(sizeof(bad) / sizeof(bad[0]))); n++) {
+		ok = (jsonToStrict(bad[n][0], strlen(bad[n][0]), &len) == NULL) && (getLastError()->code == bad[n][1][0]);
+	}
+
+	// тестовые файлы: целиком и по байту
+	for(errId=0; ok && (errId<=6); errId++) {
+		for(n=1; ok && (n<100); n++) {
+			sprintf(fName, "./test/%d/test_%d%d.js", errId, errId, n);
+			if((access(fName, R_OK) != 0) || (readFile(fName, &js) == 0)) {
+				continue;
+			}
+			s = jsonToStrict(js, strlen(js), &len);
+			out.len = 0;
+			out.buff[0] = 0;
+			tc = jsonTranscodeInit(tcSink, &out);
+			for(k=0; (k < strlen(js)) && (jsonTranscodeFeed(tc, js + k, 1) == 0); k++);
+			ok = (jsonTranscodeFinish(tc) == 0) == (s != NULL);
+			ok = ok && ((s == NULL) || (isStrict(s) && (len == out.len) && (memcmp(s, out.buff, len) == 0)));
+			jsonTranscodeFree(&tc);
+			free(s);
+			free(js);
+		}
+	}
+
+	// случайная порча документа: всё, что преобразовано, - строгий json
+	if(ok && (readFile("./test/contract-hypothec-1.json", &js) > 0)) {
+		len = strlen(js);
+		for(n=0; ok && (n<2000); n++) {
+			char	*m = strdup(js);
+
+			for(k=0; k<3; k++) {
+				seed = seed * 1103515245 + 12345;
+				m[(seed >> 8) % len] = "{}[]:,\"'/\\-.+eE0159atnu* \n"[(seed >> 20) % 26];
+			}
+			s = jsonToStrict(m, len, NULL);
+			ok = (s == NULL) || isStrict(s);
+			free(s);
+			free(m);
+		}
+		free(js);
+	}
+	printf("TRANSCODE %s\n", ok ? "Ok" : "FAIL!");
+}
+
+/* числа: флаги переполнения и потери точности, быстрый путь Клингера и strtod;
+ * getJsonInt, getJsonNumber и jsonCursorInt не создают кеш документа
+*/
+void runNumberTests()
+{
+	char				js[] = "{a: 9999999999999999, b: 9999944444446666699999.666666, c: 100000000000000000000000, d: 123.456, "
+							"e: -9223372036854775808, f: 1234567890123456789012345678901234567890123456789012345678901234567890.5}";
+	_jsonObj_t			*jsonObj;
+	_jsonCursor_t		cursor;
+	_jsonNum_t			num, cached;
+	const char			*p;
+	int					pass;
+	bool				ok;
+
+	if(jsonParser(js, &jsonObj, 0) != 0) {
+		printf("NUMBER  FAIL!\n");
+		return;
+	}
+	// без кеша, затем из кеша (jsonDecodeNumbers) - те же значения
+	for(pass=0, ok=true; ok && (pass<2); pass++) {
+		ok = (getJsonInt("a", jsonObj) == 9999999999999999LL) && getJsonNumber("a", jsonObj, &num) &&
+			(num.flags == (JSON_NUM_DECODED | JSON_NUM_PRECISION_LOSS)) && (num.d == 1e16);
+		ok = ok && getJsonNumber("b", jsonObj, &num) && (num.i == LLONG_MAX) &&
+			(num.flags == (JSON_NUM_DECODED | JSON_NUM_INT_OVERFLOW | JSON_NUM_PRECISION_LOSS)) &&
+			(num.d == strtod("9999944444446666699999.666666", NULL));
+		// 10^23 не точен в double: 10^18 * 10^5 - быстрый путь, одно корректно округлённое умножение
+		ok = ok && getJsonNumber("c", jsonObj, &num) && (num.flags == (JSON_NUM_DECODED | JSON_NUM_INT_OVERFLOW)) && (num.d == 1e23);
+		ok = ok && getJsonNumber("d", jsonObj, &num) && (num.flags == JSON_NUM_DECODED) && (num.d == 123.456) && (num.i == 123);
+		ok = ok && getJsonNumber("e", jsonObj, &num) && (num.i == LLONG_MIN) && !(num.flags & JSON_NUM_INT_OVERFLOW);
+		// длиннее буфера на стеке (64 символа) - strtod по копии
+		p = strstr(js, "f: ") + 3;
+		ok = ok && getJsonNumber("f", jsonObj, &num) && (num.d == strtod(p, NULL)) && (num.flags & JSON_NUM_INT_OVERFLOW);
+		jsonCursorInit(&cursor, jsonObj);
+		ok = ok && jsonCursorKey(&cursor, "e", 1) && (jsonCursorInt(&cursor) == LLONG_MIN);
+		jsonNumberDecode("-0.5", 4, &num);
+		ok = ok && (num.d == -0.5) && !getJsonNumber("", jsonObj, &num);
+		if(pass == 0) {
+			ok = ok && (jsonObj->num == NULL) && jsonDecodeNumbers(jsonObj) && (jsonObj->num != NULL);
+		}
+	}
+	ok = ok && (jsonTokenNumber(jsonObj, xPath("a", jsonObj)) != NULL) && getJsonNumber("a", jsonObj, &cached) &&
+		(cached.i == 9999999999999999LL);
+	clearFlatJsonObj(&jsonObj);
+	printf("NUMBER  %s\n", ok ? "Ok" : "FAIL!");
+}
+
+// одинаковые деревья токенов (поля сравниваются по одному: в битовых полях токена бывает мусор)
+static bool sameTokens(_jsonObj_t *a, _jsonObj_t *b)
+{
+	_jsonOff_t		i;
+	bool			ok = (a->count == b->count);
+
+	for(i=0; ok && (i < a->count); i++) {
+		ok = ((a->token + i)->start == (b->token + i)->start) && ((a->token + i)->end == (b->token + i)->end) &&
+			((a->token + i)->parent == (b->token + i)->parent) && ((a->token + i)->type == (b->token + i)->type) &&
+			((a->token + i)->valueType == (b->token + i)->valueType) && ((a->token + i)->escaped == (b->token + i)->escaped);
+	}
+	return ok;
+}
+
+/* разбор по частям порциями по step байт (step == 0 - случайного размера 1..97)
+ * return:			совпадают ли результат, ошибка и токены с jsonParser
+*/
+static bool streamSame(const char *js, int step, unsigned int *seed)
+{
+	_jsonObj_t		*jsonObj = NULL, *streamObj = NULL;
+	_jsonStream_t	*stream = jsonStreamInit();
+	_jsonCtx_t		ctx;
+	_jsonErr_t		err;
+	size_t			len = strlen(js), pos, n;
+	int				res, sRes;
+	bool			ok;
+
+	// свой контекст: незакрытый комментарий в конце - ошибка без описания, как и у потока
+	jsonCtxInit(&ctx);
+	res = jsonParser_r((char*)js, &jsonObj, 0, &ctx);
+	err = ctx.error;
+	jsonCtxFree(&ctx);
+	for(pos=0; pos<len; pos+=n) {
+		*seed = *seed * 1103515245 + 12345;
+		n = (step > 0) ? (size_t)step : 1 + (*seed >> 16) % 97;
+		if(n > len - pos) {
+			n = len - pos;
+		}
+		if(jsonStreamFeed(stream, js + pos, n) != 0) {
+			break;
+		}
+	}
+	sRes = jsonStreamFinish(stream, &streamObj);
+	ok = (res == sRes);
+	if(ok && (res != 0)) {
+		ok = (err.code == jsonStreamError(stream)->code) && (err.line == jsonStreamError(stream)->line) && (err.col == jsonStreamError(stream)->col);
+	} else if(ok) {
+		ok = sameTokens(jsonObj, streamObj);
+	}
+	jsonStreamFree(&stream);
+	if(streamObj != NULL) {
+		clearFlatJsonObj(&streamObj);
+	}
+	if(jsonObj != NULL) {
+		clearFlatJsonObj(&jsonObj);
+	}
+	return ok;
+}
+
+// разбор по частям: по байту и порциями случайного размера - тот же результат, что у jsonParser, на всех тестах
+void runStreamTests()
+{
+	// границы порций внутри строк, escape-последовательностей и комментариев
+	const char		*inline_[] = {"{a: 'x\\'y', /* c * / */ b: \"q\\\"w\" // z\n, c: [1, -2.5, true]}", "{a: 'x\\'y", "[1, /* c", "{a: 1 // c"};
+	char			fName[PATH_MAX], *js;
+	unsigned int	seed = 7;
+	int				errId, n, k;
+	bool			ok = true;
+
+	for(n=0; ok && (n < (int)(sizeof(inline_) / sizeof(inline_[0]))); n++) {
+		ok = streamSame(inline_[n], 1, &seed) && streamSame(inline_[n], 0, &seed);
+	}
+	for(errId=0; ok && (errId<=6); errId++) {
+		for(n=1; ok && (n<100); n++) {
+			sprintf(fName, "./test/%d/test_%d%d.js", errId, errId, n);
+			if((access(fName, R_OK) != 0) || (readFile(fName, &js) == 0)) {
+				continue;
+			}
+			ok = streamSame(js, 1, &seed);
+			for(k=0; ok && (k<4); k++) {
+				ok = streamSame(js, 0, &seed);
+			}
+			if(!ok) {
+				printf("STREAM  %s\n", fName);
+			}
+			free(js);
+		}
+	}
+	if(ok && (readFile("./test/contract-hypothec-1.json", &js) > 0)) {
+		ok = streamSame(js, 1, &seed) && streamSame(js, 0, &seed);
+		free(js);
+	}
+	printf("STREAM  %s\n", ok ? "Ok" : "FAIL!");
+}
+
+/* признак escaped: строки без '\\' отдаются как есть, с ним - декодируются (jsonUnescape)
+ * значения - в порядке токенов: текст, ожидаемый escaped, результат декодирования
+*/
+void runEscapeTests()
+{
+	const char		*expect[][2] = {{"0", "abc"}, {"0", "x y"}, {"1", "a\"b\n\xC3\xA9\\x"}, {"1", "it's \xD0\x96"},
+		{"1", "\xF0\x9F\x98\x80/"}, {"1", "qz"}, {"0", ""}, {"1", "k\"ey"}};
+	char			js[] = "[\"abc\", 'x y', \"a\\\"b\\n\\u00e9\\\\x\", 'it\\'s \\u0416', \"\\ud83d\\ude00\\/\", 'q\\z', '', {\"k\\\"ey\": 1}]";
+	char			buff[64], arenaBuff[256];
+	_jsonObj_t		*jsonObj;
+	_jsonToken_t	*token;
+	_jsonArena_t	arena;
+	_jsonView_t		view;
+	_jsonOff_t		i, len;
+	int				n = 0;
+	bool			ok;
+
+	if(jsonParser(js, &jsonObj, 0) != 0) {
+		printf("ESCAPE  FAIL!\n");
+		return;
+	}
+	jsonArenaInit(&arena, arenaBuff, sizeof(arenaBuff));
+	for(i=0, ok=true; ok && (i < jsonObj->count); i++) {
+		token = jsonObj->token + i;
+		if(((token->type != JSON_VALUE) && (token->type != JSON_KEY)) || (token->valueType != JSON_VALUE_STRING)) {
+			continue;
+		}
+		len = jsonTokenString(jsonObj, token, buff, sizeof(buff));
+		ok = (n < (int)(sizeof(expect) / sizeof(expect[0]))) && (token->escaped == (unsigned int)(expect[n][0][0] - '0')) &&
+			(len == (_jsonOff_t)strlen(expect[n][1])) && (strcmp(buff, expect[n][1]) == 0);
+		// без escape-последовательностей - указатель в исходный json, с ними - копия в арене
+		ok = ok && (jsonTokenText(jsonObj, token, NULL, &view) == !token->escaped) && jsonTokenText(jsonObj, token, &arena, &view) &&
+			(view.len == len) && (memcmp(view.ptr, expect[n][1], len) == 0) && ((view.ptr == jsonObj->json + token->start) == !token->escaped);
+		n++;
+	}
+	ok = ok && (n == (int)(sizeof(expect) / sizeof(expect[0])));
+	clearFlatJsonObj(&jsonObj);
+	printf("ESCAPE  %s\n", ok ? "Ok" : "FAIL!");
+}
+
+// скомпилированные пути: ключи, номера, [*] и .*, ключи в кавычках, ошибки синтаксиса и слишком большой номер
+void runPathTests()
+{
+	const char		*bad[] = {"", "a..b", "a.", ".a", "a[", "a[x]", "a['b", "a[1]b", "a[99999999999]", "a[2147483648]"};
+	char			js[] = "{'a.b': {c: [10, 20, {d: 1}]}, e: {f: 1, g: [2, 3]}, \"x[1]\": 4}";
+	_jsonObj_t		*jsonObj = NULL, *arrObj = NULL;
+	_jsonPath_t		*path;
+	_jsonToken_t	*res[8];
+	_jsonView_t		view;
+	int				n;
+	bool			ok = true;
+
+	for(n=0; ok && (n < (int)(sizeof(bad) / sizeof(bad[0]))); n++) {
+		ok = (jsonPathCompile(bad[n]) == NULL);
+	}
+	ok = ok && (jsonParser(js, &jsonObj, 0) == 0) && (jsonParser("[{a: 1}, {a: 2}]", &arrObj, 0) == 0);
+
+	path = ok ? jsonPathCompile("['a.b'].c[2].d") : NULL;
+	ok = (path != NULL) && (jsonPathExec(path, jsonObj, res, 8) == 1) && jsonTokenView(jsonObj, res[0], &view) &&
+		(view.len == 1) && (*view.ptr == '1');
+	jsonPathFree(path);
+	path = ok ? jsonPathCompile("[\"a.b\"].c[*]") : NULL;
+	ok = (path != NULL) && (jsonPathExec(path, jsonObj, NULL, 0) == 3) && (jsonPathExec(path, jsonObj, res, 2) == 2) &&
+		jsonTokenView(jsonObj, res[1], &view) && (view.len == 2) && (memcmp(view.ptr, "20", 2) == 0);
+	jsonPathFree(path);
+	// .* - значения объекта в порядке документа, номер за концом массива и у не-массива - ничего
+	path = ok ? jsonPathCompile("e.*") : NULL;
+	ok = (path != NULL) && (jsonPathExec(path, jsonObj, res, 8) == 2) && (res[1]->type == JSON_ARRAY);
+	jsonPathFree(path);
+	path = ok ? jsonPathCompile("e.g[2147483647]") : NULL;
+	ok = (path != NULL) && (jsonPathExec(path, jsonObj, res, 8) == 0) && (jsonPathFirst(path, jsonObj) == NULL);
+	jsonPathFree(path);
+	path = ok ? jsonPathCompile("['x[1]']") : NULL;
+	ok = (path != NULL) && (jsonPathFirst(path, jsonObj) != NULL) && jsonTokenView(jsonObj, jsonPathFirst(path, jsonObj), &view) &&
+		(*view.ptr == '4');
+	jsonPathFree(path);
+	path = ok ? jsonPathCompile("[1].a") : NULL;
+	ok = (path != NULL) && (jsonPathExec(path, arrObj, res, 8) == 1) && jsonTokenView(arrObj, res[0], &view) && (*view.ptr == '2');
+	jsonPathFree(path);
+
+	// путь по реальному документу: код каждого отчёта
+	if(jsonObj != NULL) {
+		clearFlatJsonObj(&jsonObj);
+	}
+	path = ok ? jsonPathCompile("reports.list[*].code") : NULL;
+	ok = (path != NULL) && (jsonParseFile("./test/contract-hypothec-1.json", &jsonObj) == 0) && (jsonPathExec(path, jsonObj, res, 8) == 5) &&
+		jsonTokenView(jsonObj, res[0], &view) && (view.len == (_jsonOff_t)strlen("HYPOTHEC_POLICY")) && (memcmp(view.ptr, "HYPOTHEC_POLICY", view.len) == 0);
+	jsonPathFree(path);
+	path = ok ? jsonPathCompile("reports.list[3].code") : NULL;
+	ok = (path != NULL) && (jsonPathFirst(path, jsonObj) == res[3]);
+	jsonPathFree(path);
+	if(jsonObj != NULL) {
+		clearFlatJsonObj(&jsonObj);
+	}
+	if(arrObj != NULL) {
+		clearFlatJsonObj(&arrObj);
+	}
+	printf("PATH    %s\n", ok ? "Ok" : "FAIL!");
+}
+
+// курсор: перемещения по дереву, неудачный шаг не сдвигает курсор, обход reports.list копиями курсора
+void runCursorTests()
+{
+	char			js[] = "{a: [1, 2.5, {b: 'x'}], c: {d: -3}}";
+	_jsonObj_t		*jsonObj;
+	_jsonCursor_t	cur, saved, list, item, field;
+	_jsonView_t		view;
+	int				n = 0;
+	bool			ok;
+
+	if(jsonParser(js, &jsonObj, 0) != 0) {
+		printf("CURSOR  FAIL!\n");
+		return;
+	}
+	jsonCursorInit(&cur, jsonObj);
+	ok = !jsonCursorParent(&cur) && (jsonCursorToken(&cur) == jsonObj->token) &&
+		jsonCursorChild(&cur) && (jsonCursorToken(&cur)->type == JSON_KEY) &&
+		jsonCursorChild(&cur) && (jsonCursorToken(&cur)->type == JSON_ARRAY) &&
+		jsonCursorChild(&cur) && (jsonCursorInt(&cur) == 1) &&
+		jsonCursorNext(&cur) && (jsonCursorDouble(&cur) == 2.5L) && jsonCursorNext(&cur) && (jsonCursorToken(&cur)->type == JSON_OBJECT);
+	saved = cur;
+	ok = ok && !jsonCursorNext(&cur) && (cur.id == saved.id) && !jsonCursorAt(&cur, 0) && (cur.id == saved.id) &&
+		!jsonCursorKey(&cur, "z", 1) && (cur.id == saved.id);
+	ok = ok && jsonCursorKey(&cur, "b", 1) && jsonCursorView(&cur, &view) && (view.valueType == JSON_VALUE_STRING) &&
+		(view.len == 1) && (*view.ptr == 'x') && (jsonCursorInt(&cur) == 0);
+	// вверх: значение - ключ - объект - массив - ключ a
+	ok = ok && jsonCursorParent(&cur) && (jsonCursorToken(&cur)->type == JSON_KEY) && jsonCursorParent(&cur) && (cur.id == saved.id) &&
+		jsonCursorParent(&cur) && (jsonCursorToken(&cur)->type == JSON_ARRAY) && jsonCursorParent(&cur) && (jsonCursorToken(&cur)->type == JSON_KEY);
+	// с ключа - поиск в его значении; номер элемента
+	ok = ok && jsonCursorAt(&cur, 1) && (jsonCursorDouble(&cur) == 2.5L) && !jsonCursorAt(&cur, 3);
+	jsonCursorInit(&cur, jsonObj);
+	ok = ok && jsonCursorKey(&cur, "c", 1) && jsonCursorKey(&cur, "d", 1) && (jsonCursorInt(&cur) == -3) && !jsonCursorChild(&cur);
+	clearFlatJsonObj(&jsonObj);
+
+	ok = ok && (jsonParseFile("./test/contract-hypothec-1.json", &jsonObj) == 0);
+	if(ok) {
+		jsonCursorInit(&list, jsonObj);
+		ok = jsonCursorKey(&list, "reports", 7) && jsonCursorKey(&list, "list", 4);
+		for(item=list, ok=ok && jsonCursorChild(&item); ok; ok=jsonCursorNext(&item)) {
+			field = item;
+			if(!jsonCursorKey(&field, "code", 4) || !jsonCursorView(&field, &view)) {
+				break;
+			}
+			n++;
+		}
+		ok = (n == 5);
+		clearFlatJsonObj(&jsonObj);
+	}
+	printf("CURSOR  %s\n", ok ? "Ok" : "FAIL!");
+}
+
+// структурный индекс: маски scalar, sse4.2 и avx2 совпадают (в т.ч. на хвосте), разбор с каждой реализацией даёт те же токены
+void runScanTests()
+{
+	const char		*impls[] = {"scalar", "sse4.2", "avx2"}, *alpha = "\"'\n\\ \t\r{}[]:,/*a";
+	char			buff[1000], prev[16], *js;
+	uint64_t		ref[(sizeof(buff) + JSON_SCAN_BLOCK - 1) / JSON_SCAN_BLOCK][JSON_SCAN_CLASSES];
+	_jsonScan_t		scan;
+	_jsonObj_t		*refObj = NULL, *jsonObj = NULL;
+	_jsonLen_t		b;
+	unsigned int	seed = 3;
+	int				n, k;
+	bool			ok;
+
+	// случайные байты вперемешку со структурными символами
+	for(n=0; n<(int)sizeof(buff); n++) {
+		seed = seed * 1103515245 + 12345;
+		buff[n] = ((seed >> 16) & 1) ? alpha[(seed >> 17) % strlen(alpha)] : (char)(seed >> 20);
+	}
+	if(readFile("./test/contract-hypothec-1.json", &js) == 0) {
+		return;
+	}
+	strcpy(prev, jsonScanImpl());
+	for(k=0, ok=true; ok && (k < (int)(sizeof(impls) / sizeof(impls[0]))); k++) {
+		if(!jsonScanUse(impls[k])) {
+			continue;
+		}
+		jsonScanInit(&scan, buff, sizeof(buff));
+		for(b=0, n=0; ok && (b < sizeof(buff)); b+=JSON_SCAN_BLOCK, n++) {
+			jsonScanLoad(&scan, b);
+			if(k == 0) {
+				memcpy(ref[n], scan.mask, sizeof(scan.mask));
+			} else {
+				ok = (memcmp(ref[n], scan.mask, sizeof(scan.mask)) == 0);
+			}
+		}
+		ok = ok && (jsonParser(js, &jsonObj, 0) == 0);
+		if(ok && (k == 0)) {
+			refObj = jsonObj;
+		} else if(ok) {
+			ok = sameTokens(jsonObj, refObj);
+			clearFlatJsonObj(&jsonObj);
+		}
+	}
+	ok = ok && jsonScanUse(prev) && (strcmp(jsonScanImpl(), prev) == 0);
+	if(refObj != NULL) {
+		clearFlatJsonObj(&refObj);
+	}
+	free(js);
+	printf("SCAN    %s\n", ok ? "Ok" : "FAIL!");
+}
+
+// арена: выравнивание, нехватка места, расширение последнего блока на месте, разбор документа в арене
+void runArenaTests()
+{
+	static char		buff[1 << 20];
+	_jsonArena_t	arena;
+	_jsonObj_t		doc, *jsonObj = NULL;
+	char			*a, *b, *c, *js;
+	size_t			used;
+	bool			ok;
+
+	jsonArenaInit(&arena, buff, 256);
+	a = (char*)jsonArenaAlloc(&arena, 10);
+	b = (char*)jsonArenaAlloc(&arena, 10);
+	ok = (a == buff) && (b == buff + 16) && (((size_t)b & 15) == ((size_t)buff & 15));
+	// последний блок растёт на месте, не последний - копируется
+	memcpy(a, "0123456789", 10);
+	ok = ok && (jsonArenaRealloc(&arena, b, 10, 100) == b) && (arena.used == 16 + 100);
+	c = (char*)jsonArenaRealloc(&arena, a, 10, 20);
+	ok = ok && (c == buff + 128) && (memcmp(c, "0123456789", 10) == 0);
+	// места нет: NULL, арена не меняется
+	used = arena.used;
+	ok = ok && (jsonArenaAlloc(&arena, 200) == NULL) && (jsonArenaRealloc(&arena, c, 20, 200) == NULL) && (arena.used == used);
+	ok = ok && (jsonArenaAlloc(&arena, 256 - 160) != NULL) && (jsonArenaAlloc(&arena, 1) == NULL);
+	jsonArenaReset(&arena);
+	ok = ok && (arena.used == 0) && (jsonArenaAlloc(&arena, 256) == buff);
+
+	// документ в арене: те же токены, что и через malloc; мало места - ошибка памяти; после сброса - повторный разбор
+	if(ok && (readFile("./test/contract-hypothec-1.json", &js) > 0)) {
+		ok = (jsonParser(js, &jsonObj, 0) == 0);
+		jsonArenaInit(&arena, buff, 1024);
+		jsonDocInit(&doc, &arena);
+		ok = ok && (jsonDocParse(&doc, js, 0, jsonDefaultCtx()) == 1) && (getLastError()->code == JSON_ERR_NO_MEMORY);
+		jsonDocFree(&doc);
+		jsonArenaInit(&arena, buff, sizeof(buff));
+		jsonDocInit(&doc, &arena);
+		ok = ok && (jsonDocParse(&doc, js, 0, jsonDefaultCtx()) == 0) && sameTokens(&doc, jsonObj) &&
+			((char*)doc.token >= buff) && ((char*)doc.token < buff + sizeof(buff));
+		jsonDocFree(&doc);
+		jsonArenaReset(&arena);
+		jsonDocInit(&doc, &arena);
+		ok = ok && (jsonDocParse(&doc, js, 0, jsonDefaultCtx()) == 0) && sameTokens(&doc, jsonObj) && ((char*)doc.token == buff);
+		jsonDocFree(&doc);
+		if(jsonObj != NULL) {
+			clearFlatJsonObj(&jsonObj);
+		}
+		free(js);
+	}
+	printf("ARENA   %s\n", ok ? "Ok" : "FAIL!");
+}
+
+// значения без копирования: view скаляров, исходный текст объектов и массивов (скобки в комментариях не мешают)
+void runViewTests()
+{
+	const char		*raw[][2] = {{"a", "{b: [1, {c: 2}] /* ] } */ , d: 'str'}"}, {"a.b", "[1, {c: 2}]"}, {"a.d", "str"}, {"e", "3.5"},
+		{"f", "[ ]"}, {"g", "{h: [[1], [2, [3]]] // ]\n}"}, {"g.h", "[[1], [2, [3]]]"}};
+	char			js[] = "{a: {b: [1, {c: 2}] /* ] } */ , d: 'str'}, e: 3.5, f: [ ], g: {h: [[1], [2, [3]]] // ]\n}}";
+	_jsonObj_t		*jsonObj;
+	_jsonView_t		view;
+	_jsonOff_t		start, end;
+	int				n;
+	bool			ok;
+
+	if(jsonParser(js, &jsonObj, 0) != 0) {
+		printf("VIEW    FAIL!\n");
+		return;
+	}
+	for(n=0, ok=true; ok && (n < (int)(sizeof(raw) / sizeof(raw[0]))); n++) {
+		ok = getJsonRaw(raw[n][0], jsonObj, &view) && (view.len == (int)strlen(raw[n][1])) && (memcmp(view.ptr, raw[n][1], view.len) == 0) &&
+			(view.ptr >= js) && (view.ptr < js + sizeof(js));
+	}
+	// view - только у скаляров
+	ok = ok && getJsonView("e", jsonObj, &view) && (view.type == JSON_VALUE) && (view.valueType == JSON_VALUE_FLOAT) && (view.len == 3) &&
+		getJsonView("a.d", jsonObj, &view) && (view.valueType == JSON_VALUE_STRING) && !getJsonView("a.b", jsonObj, &view) &&
+		!getJsonView("zz", jsonObj, &view) && !getJsonRaw("zz", jsonObj, &view);
+	ok = ok && (getJsonInt("e", jsonObj) == 3) && (getJsonDouble("e", jsonObj) == 3.5L);
+	ok = ok && jsonTokenSpan(jsonObj, jsonObj->token, &start, &end) && (start == 0) && (end == (_jsonOff_t)strlen(js));
+	clearFlatJsonObj(&jsonObj);
+	printf("VIEW    %s\n", ok ? "Ok" : "FAIL!");
+}
+
+/* индекс: поиск через хэш-таблицу (объект от 8 ключей) и через цепочку дают один и тот же токен,
+ * при повторяющихся ключах - первый; элемент массива по номеру, за концом - NULL
+*/
+void runIndexTests()
+{
+	char			js[2048], key[16];
+	_jsonObj_t		*jsonObj;
+	_jsonToken_t	*found[48], *arr[48], *token;
+	_jsonView_t		view;
+	int				n, len = 0, pass;
+	bool			ok;
+
+	len += sprintf(js + len, "{");
+	for(n=0; n<40; n++) {
+		len += sprintf(js + len, "k%d: %d, ", n, n);
+	}
+	len += sprintf(js + len, "k5: 'dup', arr: [");
+	for(n=0; n<40; n++) {
+		len += sprintf(js + len, "%s%d", (n > 0) ? ", " : "", n * 10);
+	}
+	sprintf(js + len, "], small: {x: 1, y: 2, x: 3}}");
+	if(jsonParser(js, &jsonObj, 0) != 0) {
+		printf("INDEX   FAIL!\n");
+		return;
+	}
+	// 0й проход - без индекса, 1й - с индексом (строится лениво jsonIndexKey)
+	for(pass=0, ok=true; ok && (pass<2); pass++) {
+		for(n=0; ok && (n<40); n++) {
+			sprintf(key, "k%d", n);
+			token = (pass == 0) ? jsonFindKey(jsonObj, jsonObj->token, key, strlen(key)) : jsonIndexKey(jsonObj, jsonObj->token, key, strlen(key));
+			ok = (token != NULL) && (token->type == JSON_KEY) && ((pass == 0) || (token == found[n]));
+			found[n] = token;
+		}
+		ok = ok && (getJsonInt("k5", jsonObj) == 5) && (jsonFindKey(jsonObj, jsonObj->token, "k40", 3) == NULL) &&
+			(jsonFindKey(jsonObj, jsonObj->token, "k", 1) == NULL) && (jsonFindKey(jsonObj, jsonObj->token, "k1", 2) == found[1]);
+		ok = ok && (jsonChildCount(jsonObj, xPathNode("arr", jsonObj)) == 40) && (jsonChildCount(jsonObj, jsonObj->token) == 43);
+		for(n=0; ok && (n<40); n++) {
+			token = jsonArrayAt(jsonObj, xPathNode("arr", jsonObj), n);
+			ok = (token != NULL) && jsonTokenView(jsonObj, token, &view) && (atoi(view.ptr) == n * 10) && ((pass == 0) || (token == arr[n]));
+			arr[n] = token;
+		}
+		ok = ok && (jsonArrayAt(jsonObj, xPathNode("arr", jsonObj), 40) == NULL) && (jsonArrayAt(jsonObj, jsonObj->token, 0) == NULL);
+		// маленький объект - без таблицы, повтор ключа - первый
+		token = jsonFindKey(jsonObj, xPathNode("small", jsonObj), "x", 1);
+		ok = ok && (token != NULL) && (jsonTokenFChild(jsonObj, token) != 0) &&
+			jsonTokenView(jsonObj, jsonObj->token + jsonTokenFChild(jsonObj, token), &view) && (*view.ptr == '1');
+		ok = ok && (jsonObj->index == NULL) == (pass == 0);
+	}
+	clearFlatJsonObj(&jsonObj);
+	printf("INDEX   %s\n", ok ? "Ok" : "FAIL!");
+}
+
+/* пакет документов: границы не сбиваются скобками в строках и комментариях, порядок сохраняется при любом
+ * числе потоков, у ошибочного документа - своя ошибка, мусор между документами - отдельный ошибочный документ
+*/
+void runBatchTests()
+{
+	static char			js[65536];
+	char				*copy;
+	_jsonBatchDoc_t		*docs;
+	int					n, k, count, len = 0, threads[] = {1, 4};
+	bool				ok = true;
+
+	for(n=0; n<500; n++) {
+		if(n == 100) {
+			len += sprintf(js + len, "{a: 1,\n b: }\n");
+		} else if(n == 200) {
+			len += sprintf(js + len, "garbage line\n");
+		} else if(n % 3 == 0) {
+			len += sprintf(js + len, "[%d, '] }', /* ] */ \"\\\"[\"]\n", n);
+		} else {
+			len += sprintf(js + len, "{n: %d, s: '{x}' // }\n}%s", n, (n % 2) ? "\n" : ", ");
+		}
+	}
+	sprintf(js + len, "{open: [1");
+	for(k=0; ok && (k < (int)(sizeof(threads) / sizeof(threads[0]))); k++) {
+		count = jsonParseBatch(js, 0, threads[k], &docs);
+		ok = (count == 501);
+		for(n=0; ok && (n<500); n++) {
+			if((n == 100) || (n == 200)) {
+				ok = (docs[n].res == 1) && (docs[n].obj == NULL) && ((n == 200) || (docs[n].error.line == 2));
+			} else if(n % 3 == 0) {
+				ok = (docs[n].res == 0) && jsonTokenView(docs[n].obj, docs[n].obj->token + 1, &(_jsonView_t){0}) &&
+					(atoi(docs[n].obj->json + (docs[n].obj->token + 1)->start) == n);
+			} else {
+				ok = (docs[n].res == 0) && (getJsonInt("n", docs[n].obj) == n) && (docs[n].obj->json == js + docs[n].start);
+			}
+		}
+		ok = ok && (docs[500].res == 1) && (docs[500].obj == NULL);
+		jsonBatchFree(&docs, count);
+		ok = ok && (docs == NULL);
+	}
+
+	// строки вне документов - мусорные документы; буфер ровно по длине, '/' последним символом
+	count = jsonBatchSplit("{\"a\":1}\n\"stray\"\n{\"b\":2}\n'x'", 27, &docs);
+	ok = ok && (count == 4) && (docs[1].len == 7) && (docs[3].start == 24) && (docs[3].len == 3);
+	jsonBatchFree(&docs, count);
+	copy = (char*)malloc(9);
+	memcpy(copy, "[1]\n[2] /", 9);
+	count = jsonBatchSplit(copy, 9, &docs);
+	ok = ok && (count == 3) && (docs[2].start == 8) && (docs[2].len == 1);
+	jsonBatchFree(&docs, count);
+	free(copy);
+	printf("BATCH   %s\n", ok ? "Ok" : "FAIL!");
+}
+
+/* разбор отображённого файла - те же токены, что у jsonParser; файл ровно в страницу (чтение за концом - из
+ * нулевой страницы); ширина смещений по JSON_OFFSET_64; порция потока, не помещающаяся в буфер, - ошибка
+*/
+void runFileTests()
+{
+	const char		*fName = "./jstest.page";
+	_jsonObj_t		*fileObj = NULL, *jsonObj = NULL;
+	_jsonStream_t	*stream;
+	_jsonCtx_t		ctx;
+	char			*js = NULL;
+	long			page = sysconf(_SC_PAGESIZE);
+	int				fh;
+	bool			ok;
+
+	ok = (readFile("./test/contract-hypothec-1.json", &js) > 0) && (jsonParser(js, &jsonObj, strlen(js)) == 0) &&
+		(jsonParseFile("./test/contract-hypothec-1.json", &fileObj) == 0) && (fileObj->map != NULL) &&
+		(strcmp(fileObj->json, js) == 0) && sameTokens(fileObj, jsonObj);
+	if(fileObj != NULL) {
+		clearFlatJsonObj(&fileObj);
+	}
+	if(jsonObj != NULL) {
+		clearFlatJsonObj(&jsonObj);
+	}
+	free(js);
+
+	js = (char*)malloc(page + 1);
+	memset(js, ' ', page);
+	js[page] = 0;
+	memcpy(js, "{a: [1, 2], b:", 14);
+	memcpy(js + page - 5, "true}", 5);
+	fh = open(fName, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	ok = ok && (fh >= 0) && (write(fh, js, page) == page);
+	if(fh >= 0) {
+		close(fh);
+	}
+	ok = ok && (jsonParser(js, &jsonObj, page) == 0) && (jsonParseFile(fName, &fileObj) == 0) && sameTokens(fileObj, jsonObj) &&
+		(xPathNode("b", fileObj) != NULL) && (strncmp(fileObj->json + xPathNode("b", fileObj)->start, "true", 4) == 0);
+	if(fileObj != NULL) {
+		clearFlatJsonObj(&fileObj);
+	}
+	if(jsonObj != NULL) {
+		clearFlatJsonObj(&jsonObj);
+	}
+	unlink(fName);
+	free(js);
+
+	jsonCtxInit(&ctx);
+	ok = ok && (jsonParseFile_r(fName, &fileObj, &ctx) == 1) && (fileObj == NULL) && (getLastError_r(&ctx)->code == JSON_ERR_FILE);
+	jsonCtxFree(&ctx);
+
+#ifdef JSON_OFFSET_64
+	ok = ok && (sizeof(_jsonOff_t) == 8) && (JSON_OFF_MAX == LLONG_MAX);
+#else
+	ok = ok && (sizeof(_jsonOff_t) == 4) && (JSON_OFF_MAX == INT_MAX);
+#endif
+	ok = ok && (sizeof(_jsonLen_t) == sizeof(_jsonOff_t));
+
+	stream = jsonStreamInit();
+	ok = ok && (jsonStreamFeed(stream, "[1, ", 4) == 0) && (jsonStreamFeed(stream, "", (_jsonLen_t)INT_MAX) == 1) &&
+		(jsonStreamError(stream)->code == JSON_ERR_NO_MEMORY);
+	jsonStreamFree(&stream);
+	printf("FILE    %s\n", ok ? "Ok" : "FAIL!");
+}
+
+/* дерево, восстановленное из parent/nextToken (как его видит JSON_COMPACT_TOKENS): первый потомок - через
+ * jsonTokenFChild, остальные - цепочкой nextToken, в порядке индексов
+*/
+static bool treeLinked(_jsonObj_t *jsonObj)
+{
+	_jsonOff_t		i, p, *last = (_jsonOff_t*)calloc(jsonObj->count + 1, sizeof(_jsonOff_t));
+	_jsonToken_t	*token;
+	bool			ok = (last != NULL);
+
+	for(i=1; ok && (i < jsonObj->count); i++) {
+		token = jsonObj->token + i;
+		p = token->parent;
+		ok = (jsonTokenId(jsonObj, token) == i) && (p >= 0) && (p < i) &&
+			((last[p] == 0) ? (jsonTokenFChild(jsonObj, jsonObj->token + p) == i) : ((jsonObj->token + last[p])->nextToken == i));
+		last[p] = i;
+	}
+	for(i=0; ok && (i < jsonObj->count); i++) {
+		ok = (last[i] == 0) ? (jsonTokenFChild(jsonObj, jsonObj->token + i) == 0) : ((jsonObj->token + last[i])->nextToken == 0);
+	}
+	free(last);
+	return ok;
+}
+
+// связность дерева в любой раскладке токена (после разбора и после jsonReparse), размер компактного токена
+void runCompactTests()
+{
+	_jsonObj_t		*jsonObj = NULL, *fullObj = NULL;
+	char			*js = NULL, small[] = "{a: {}, b: [[], [1, {c: []}]], d: 'x'}";
+	const char		*p;
+	bool			ok;
+
+	ok = (readFile("./test/contract-hypothec-1.json", &js) > 0) && (jsonParser(js, &jsonObj, 0) == 0) && treeLinked(jsonObj);
+	if(jsonObj != NULL) {
+		clearFlatJsonObj(&jsonObj);
+	}
+	free(js);
+
+	ok = ok && (jsonParser(small, &jsonObj, 0) == 0) && treeLinked(jsonObj) && (jsonTokenFChild(jsonObj, xPathNode("a", jsonObj)) == 0);
+	p = (jsonObj != NULL) ? strstr(jsonObj->json, "[]") : NULL;
+	ok = ok && (p != NULL) && (jsonReparse(jsonObj, p - jsonObj->json, 2, "[1, [2], {e: 3}]", 16) == 0) && treeLinked(jsonObj) &&
+		(jsonParser((char*)jsonObj->json, &fullObj, 0) == 0) && sameTokens(jsonObj, fullObj);
+	if(fullObj != NULL) {
+		clearFlatJsonObj(&fullObj);
+	}
+	if(jsonObj != NULL) {
+		clearFlatJsonObj(&jsonObj);
+	}
+
+#if defined(JSON_COMPACT_TOKENS) && !defined(JSON_OFFSET_64)
+	ok = ok && (sizeof(_jsonToken_t) == 20);
+#elif !defined(JSON_COMPACT_TOKENS) && !defined(JSON_OFFSET_64)
+	ok = ok && (sizeof(_jsonToken_t) == 32);
+#endif
+	printf("COMPACT %s\n", ok ? "Ok" : "FAIL!");
+}
+
+// журнал событий: одна запись на событие, закрывающая скобка сверяется с json'ом на месте
+typedef struct {
+	const char		*json;
+	char			*log;
+	size_t			len, size;
+	int				events, limit;			// limit > 0 - остановить разбор на событии limit
+	bool			ok;
+} saxLog_t;
+
+static bool saxPut(saxLog_t *sl, const char *fmt, ...)
+{
+	va_list		ap;
+	int			n;
+
+	va_start(ap, fmt);
+	n = vsnprintf(sl->log + sl->len, sl->size - sl->len, fmt, ap);
+	va_end(ap);
+	if((n < 0) || (sl->len + n >= sl->size)) {
+		sl->ok = false;
+	} else {
+		sl->len += n;
+	}
+	return (++sl->events != sl->limit);
+}
+
+static bool saxObjectStart(void *arg, _jsonOff_t pos) { return saxPut((saxLog_t*)arg, "{%lld ", (long long)pos); }
+static bool saxArrayStart(void *arg, _jsonOff_t pos) { return saxPut((saxLog_t*)arg, "[%lld ", (long long)pos); }
+
+static bool saxObjectEnd(void *arg, _jsonOff_t pos)
+{
+	saxLog_t	*sl = (saxLog_t*)arg;
+
+	sl->ok = sl->ok && (sl->json[pos] == '}');
+	return saxPut(sl, "} ");
+}
+
+static bool saxArrayEnd(void *arg, _jsonOff_t pos)
+{
+	saxLog_t	*sl = (saxLog_t*)arg;
+
+	sl->ok = sl->ok && (sl->json[pos] == ']');
+	return saxPut(sl, "] ");
+}
+
+static bool saxKey(void *arg, const char *json, const _jsonToken_t *token)
+{
+	return saxPut((saxLog_t*)arg, "k%lld:%lld:%d ", (long long)token->start, (long long)token->end, (int)token->escaped) && (json != NULL);
+}
+
+static bool saxValue(void *arg, const char *json, const _jsonToken_t *token)
+{
+	return saxPut((saxLog_t*)arg, "v%lld:%lld:%d:%d ", (long long)token->start, (long long)token->end, (int)token->valueType,
+		(int)token->escaped) && (json != NULL);
+}
+
+// тот же журнал обходом дерева jsonParser
+static void saxTree(saxLog_t *sl, _jsonObj_t *jsonObj, _jsonOff_t id)
+{
+	_jsonToken_t	*token = jsonObj->token + id;
+	_jsonOff_t		n;
+
+	switch(token->type) {
+		case JSON_OBJECT:
+		case JSON_ARRAY:
+			saxPut(sl, (token->type == JSON_OBJECT) ? "{%lld " : "[%lld ", (long long)token->start);
+			for(n = jsonTokenFChild(jsonObj, token); n != 0; n = (jsonObj->token + n)->nextToken) {
+				saxTree(sl, jsonObj, n);
+			}
+			saxPut(sl, (token->type == JSON_OBJECT) ? "} " : "] ");
+			break;
+		case JSON_KEY:
+			saxKey(sl, jsonObj->json, token);
+			if(jsonTokenFChild(jsonObj, token) != 0) {
+				saxTree(sl, jsonObj, jsonTokenFChild(jsonObj, token));
+			}
+			break;
+		default:
+			saxValue(sl, jsonObj->json, token);
+	}
+}
+
+/* события jsonParseSax - в порядке и с позициями токенов jsonParser; остановка обработчиком - ровно на его событии,
+ * без ошибки; ошибка json'а - та же, что у jsonParser, события до неё отправлены
+*/
+void runSaxTests()
+{
+	static char		log1[1 << 20], log2[1 << 20];
+	saxLog_t		tree = {0}, sax = {0};
+	_jsonSax_t		handlers = {NULL, saxObjectStart, saxObjectEnd, saxArrayStart, saxArrayEnd, saxKey, saxValue};
+	_jsonObj_t		*jsonObj = NULL;
+	_jsonCtx_t		ctx, ctx2;
+	char			*js = NULL, *docs[2], bad[] = "{a: [1, 'x\\n', {b: null}], c: {d: tru}}",
+					small[] = "[{a: {}, 'b\\'c': [[], -1.5, true]}, /* [ */ 'z', {}]";
+	int				n, events;
+	bool			ok;
+
+	ok = (readFile("./test/contract-hypothec-1.json", &js) > 0);
+	docs[0] = js;
+	docs[1] = small;
+	for(n=0; ok && (n < 2); n++) {
+		tree = (saxLog_t){docs[n], log1, 0, sizeof(log1), 0, 0, true};
+		sax = (saxLog_t){docs[n], log2, 0, sizeof(log2), 0, 0, true};
+		handlers.arg = &sax;
+		ok = (jsonParser(docs[n], &jsonObj, 0) == 0);
+		if(ok) {
+			saxTree(&tree, jsonObj, 0);
+			clearFlatJsonObj(&jsonObj);
+		}
+		ok = ok && (jsonParseSax(docs[n], 0, &handlers) == 0) && tree.ok && sax.ok && (tree.len == sax.len) &&
+			(memcmp(log1, log2, tree.len) == 0);
+	}
+	events = sax.events;
+
+	// остановка на событии 5: ошибки нет, событий ровно 5
+	sax = (saxLog_t){docs[1], log2, 0, sizeof(log2), 0, 5, true};
+	handlers.arg = &sax;
+	jsonCtxInit(&ctx);
+	ok = ok && (events > 5) && (jsonParseSax_r(docs[1], 0, &handlers, &ctx) == JSON_PARSE_STOP) && (sax.events == 5) &&
+		(getLastError_r(&ctx)->code == JSON_ERR_NO_ERROR);
+	jsonCtxFree(&ctx);
+	free(js);
+
+	sax = (saxLog_t){bad, log2, 0, sizeof(log2), 0, 0, true};
+	handlers.arg = &sax;
+	jsonCtxInit(&ctx);
+	jsonCtxInit(&ctx2);
+	ok = ok && (jsonParseSax_r(bad, 0, &handlers, &ctx) == 1) && (jsonParser_r(bad, &jsonObj, 0, &ctx2) == 1) &&
+		(getLastError_r(&ctx)->code == getLastError_r(&ctx2)->code) && (getLastError_r(&ctx)->line == getLastError_r(&ctx2)->line) &&
+		(getLastError_r(&ctx)->col == getLastError_r(&ctx2)->col) && (sax.events >= 8);
+	jsonCtxFree(&ctx);
+	jsonCtxFree(&ctx2);
+	if(jsonObj != NULL) {
+		clearFlatJsonObj(&jsonObj);
+	}
+	printf("SAX     %s\n", ok ? "Ok" : "FAIL!");
+}
+
+/* выборка без дерева - те же представления, что jsonPathFirst + jsonTokenView по полному разбору; пути с * и
+ * ненайденные - type == 0; повторный ключ - первый; после найденных путей документ не проверяется; ошибка на
+ * пройденном участке - с позицией
+*/
+void runExtractTests()
+{
+	const char		*list[] = {"type", "document.name", "selector.type.code", "version", "journals", "reports.list[3].code",
+						"reports.list[4]", "reports.logic", "plugins[1]", "blacklist.totals.premium", "nope", "reports.list[9]",
+						"reports.list[*].code", "plugins.x"};
+	_jsonPath_t		*paths[sizeof(list) / sizeof(list[0])];
+	_jsonView_t		res[sizeof(list) / sizeof(list[0])], view;
+	_jsonObj_t		*jsonObj = NULL;
+	_jsonToken_t	*token;
+	_jsonCtx_t		ctx;
+	char			*js = NULL, dup[] = "{a: 1, 'b\\n': 2, a: 3, c: [{d: true}]} ]]garbage";
+	int				n, found = 0, count = (int)(sizeof(list) / sizeof(list[0]));
+	bool			ok;
+
+	for(n=0; n<count; n++) {
+		paths[n] = jsonPathCompile(list[n]);
+	}
+	ok = (readFile("./test/contract-hypothec-1.json", &js) > 0) && (jsonParser(js, &jsonObj, 0) == 0);
+	ok = ok && (jsonExtract(jsonObj->json, 0, paths, count, res) == 10);
+	for(n=0; ok && (n<count); n++) {
+		token = (paths[n] != NULL) ? jsonPathFirst(paths[n], jsonObj) : NULL;
+		if((token == NULL) || (n == 12)) {
+			ok = (res[n].type == 0);
+			continue;
+		}
+		found++;
+		ok = jsonTokenView(jsonObj, token, &view) && (res[n].ptr == view.ptr) && (res[n].len == view.len) &&
+			(res[n].type == view.type) && (res[n].valueType == view.valueType);
+	}
+	ok = ok && (found == 10);
+	if(jsonObj != NULL) {
+		clearFlatJsonObj(&jsonObj);
+	}
+	free(js);
+	for(n=0; n<count; n++) {
+		jsonPathFree(paths[n]);
+	}
+
+	paths[0] = jsonPathCompile("a");
+	paths[1] = jsonPathCompile("b\\n");
+	paths[2] = jsonPathCompile("c[0].d");
+	ok = ok && (jsonExtract(dup, 0, paths, 3, res) == 3) && (res[0].len == 1) && (res[0].ptr[0] == '1') &&
+		(res[1].ptr == strchr(dup, '2')) && (res[2].valueType == JSON_VALUE_BOOL) && (strncmp(res[2].ptr, "true", res[2].len) == 0);
+	jsonCtxInit(&ctx);
+	ok = ok && (jsonExtract_r("{x: 1,\n c: [{d: }]}", 0, paths, 3, res, &ctx) == -1) && (getLastError_r(&ctx)->line == 2);
+	jsonCtxFree(&ctx);
+	for(n=0; n<3; n++) {
+		jsonPathFree(paths[n]);
+	}
+	printf("EXTRACT %s\n", ok ? "Ok" : "FAIL!");
+}
+
 int readFile(const char *fName, char **json)
 {
 	struct stat		fStat;
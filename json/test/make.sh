@@ -28,12 +28,34 @@ fi
 
 $CC ${__PARAM} \
 	-lrt \
+	-lpthread \
 	-I${PREFIX}/include \
 	$CPPFLAGS \
 	$CFLAGS \
 	$LDFLAGS \
 	-o $OUT ./$OUT.c \
 	../lib/json/json.c \
+	../lib/json/jsonScan.c \
+	../lib/json/jsonArena.c \
+	../lib/json/jsonIndex.c \
+	../lib/json/jsonPath.c \
+	../lib/json/jsonCursor.c \
+	../lib/json/jsonStream.c \
+	../lib/json/jsonBatch.c \
+	../lib/json/jsonFile.c \
+	../lib/json/jsonNumber.c \
+	../lib/json/jsonString.c \
+	../lib/json/jsonWrite.c \
+	../lib/json/jsonTranscode.c \
+	../lib/json/jsonSax.c \
+	../lib/json/jsonExtract.c \
+	../lib/json/jsonValidate.c \
+	../lib/json/jsonEdit.c \
+	../lib/json/jsonReparse.c \
+	../lib/json/jsonSnapshot.c \
+	../lib/json/jsonCache.c \
+	../lib/json/jsonStats.c \
+	../lib/json/jsonBind.c \
 	../lib/string2/string2.c
 
 chmod 755 ./$OUT
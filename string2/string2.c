@@ -42,7 +42,7 @@ int strncat2(_string2_t **dst, const char *src, int srcLen, unsigned char fill)
 			buffLenInc = (srcLen > (*dst)->buffLenInc) ? srcLen : (*dst)->buffLenInc;
 			(*dst)->buffLenInc <<= 1;
 			(*dst)->buffLen += buffLenInc;
-			(*dst)->buff = (char*)realloc((*dst)->buff, (*dst)->buffLen);
+			(*dst)->buff = (char*)realloc((*dst)->buff, (*dst)->buffLen + 2);
 		}
 
 	if(fill == 0) {